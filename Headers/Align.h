@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+namespace utils {
+	// Rounds value up to a multiple of alignment, which must be a power of two.
+	inline uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+// Collects pipeline barriers and records them as a single command.
+//
+// Barriers are described with synchronization2 structures. On devices
+// without synchronization2 they are lowered to one vkCmdPipelineBarrier
+// call with the stage masks merged, so only stage and access bits that
+// exist in Vulkan 1.0 may be used.
+class BarrierBatch {
+// ------------------------
+// Private members
+// ------------------------
+private:
+	std::vector<VkMemoryBarrier2> MemoryBarriers;
+	std::vector<VkBufferMemoryBarrier2> BufferBarriers;
+	std::vector<VkImageMemoryBarrier2> ImageBarriers;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	void AddMemory(VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+		VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess);
+	void AddBuffer(const VkBufferMemoryBarrier2& barrier);
+	void AddImage(const VkImageMemoryBarrier2& barrier);
+	void AddImage(VkImage image, VkImageAspectFlags aspect,
+		VkImageLayout oldLayout, VkImageLayout newLayout,
+		VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+		VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess);
+
+	bool Empty() const;
+	void Clear();
+
+	void Flush(VkCommandBuffer commandBuffer, bool synchronization2);
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Standalone timing runs selected from the command line. Each one logs its
+// results and returns without creating a window or a device.
+namespace benchmarks {
+	// Times the per-frame entity passes over EntityStore against the same
+	// passes over edict_t-style records, plus create/destroy churn.
+	void RunEntityBenchmark(uint32_t entityCount);
+	// Times random traces through a BSP's hulls one at a time and as a
+	// batch on a WorkerPool, and checks that both give the same results.
+	void RunTraceBenchmark(const std::string& filename, uint32_t traceCount);
+	// Times SoundMixer on that many channels of Quake-rate sounds, mixed
+	// into a buffer rather than a device.
+	void RunMixerBenchmark(uint32_t channelCount);
+}
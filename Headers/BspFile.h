@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On-disk structures of Quake's BSP29 format (bspfile.h). Only the lumps
+// needed for collision and for cooking the level's geometry are kept.
+struct BspLump {
+	int32_t Offset;
+	int32_t Length;
+};
+
+// dplane_t. Type 0-2 are planes facing along X, Y or Z.
+struct BspPlane {
+	float Normal[3];
+	float Dist;
+	int32_t Type;
+};
+
+// dvertex_t.
+struct BspVertex {
+	float Point[3];
+};
+
+// dnode_t. A negative child -(n + 1) refers to leaf n.
+struct BspNode {
+	int32_t PlaneNum;
+	int16_t Children[2];
+	int16_t Mins[3];
+	int16_t Maxs[3];
+	uint16_t FirstFace;
+	uint16_t NumFaces;
+};
+
+// texinfo_t. Texture coordinates are dot(point, Vecs[n]) + Vecs[n][3].
+struct BspTexInfo {
+	float Vecs[2][4];
+	int32_t MipTex;
+	int32_t Flags;
+};
+
+// dface_t. A negative surfedge walks its edge backwards. LightOfs is -1
+// for faces without a lightmap.
+struct BspFace {
+	int16_t PlaneNum;
+	int16_t Side;
+	int32_t FirstEdge;
+	int16_t NumEdges;
+	int16_t TexInfo;
+	uint8_t Styles[4];
+	int32_t LightOfs;
+};
+
+// dclipnode_t. A negative child is a CONTENTS_* value.
+struct BspClipNode {
+	int32_t PlaneNum;
+	int16_t Children[2];
+};
+
+// dleaf_t.
+struct BspLeaf {
+	int32_t Contents;
+	int32_t VisOffset;
+	int16_t Mins[3];
+	int16_t Maxs[3];
+	uint16_t FirstMarkSurface;
+	uint16_t NumMarkSurfaces;
+	uint8_t AmbientLevel[4];
+};
+
+// dedge_t.
+struct BspEdge {
+	uint16_t V[2];
+};
+
+// miptex_t. Offsets to the four palettized mip levels are relative to the
+// start of the structure.
+struct BspMipTex {
+	char Name[16];
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Offsets[4];
+};
+
+// dmodel_t. Model 0 is the world, the rest are brush entities.
+struct BspModel {
+	float Mins[3];
+	float Maxs[3];
+	float Origin[3];
+	int32_t HeadNode[4];
+	int32_t VisLeafs;
+	int32_t FirstFace;
+	int32_t NumFaces;
+};
+
+class BspFile {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static const int32_t VERSION = 29;
+
+	static const uint32_t LUMP_ENTITIES = 0;
+	static const uint32_t LUMP_PLANES = 1;
+	static const uint32_t LUMP_TEXTURES = 2;
+	static const uint32_t LUMP_VERTEXES = 3;
+	static const uint32_t LUMP_NODES = 5;
+	static const uint32_t LUMP_TEXINFO = 6;
+	static const uint32_t LUMP_FACES = 7;
+	static const uint32_t LUMP_LIGHTING = 8;
+	static const uint32_t LUMP_CLIPNODES = 9;
+	static const uint32_t LUMP_LEAFS = 10;
+	static const uint32_t LUMP_EDGES = 12;
+	static const uint32_t LUMP_SURFEDGES = 13;
+	static const uint32_t LUMP_MODELS = 14;
+	static const uint32_t LUMP_COUNT = 15;
+
+	static const int32_t CONTENTS_EMPTY = -1;
+	static const int32_t CONTENTS_SOLID = -2;
+	static const int32_t CONTENTS_WATER = -3;
+	static const int32_t CONTENTS_SLIME = -4;
+	static const int32_t CONTENTS_LAVA = -5;
+	static const int32_t CONTENTS_SKY = -6;
+
+	// Sky and liquid surfaces: no lightmap.
+	static const int32_t TEX_SPECIAL = 1;
+
+	std::string Entities;
+	std::vector<BspPlane> Planes;
+	std::vector<BspNode> Nodes;
+	std::vector<BspClipNode> ClipNodes;
+	std::vector<BspLeaf> Leafs;
+	std::vector<BspModel> Models;
+	std::vector<BspVertex> Vertices;
+	std::vector<BspTexInfo> TexInfo;
+	std::vector<BspFace> Faces;
+	std::vector<BspEdge> Edges;
+	std::vector<int32_t> SurfEdges;
+	// dmiptexlump_t as stored: a count, offsets, then each miptex_t.
+	std::vector<uint8_t> MipTextures;
+	// 8-bit light samples that faces index with LightOfs.
+	std::vector<uint8_t> Lighting;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	void Load(const std::string& filename);
+	void Parse(const std::vector<char>& data);
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	template <typename T>
+	static void ReadLump(const std::vector<char>& data, const BspLump& lump, std::vector<T>& out);
+};
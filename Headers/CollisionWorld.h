@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "BspFile.h"
+#include "MathLib.h"
+#include "WorkerPool.h"
+
+// A line trace through one hull of one BSP model. Brush models are traced
+// in their own space, so the caller offsets Start and End by the entity's
+// origin.
+struct TraceRequest {
+	vec3_t Start;
+	vec3_t End;
+	// 0 is a point, 1 a player-sized box and 2 a shambler-sized box.
+	uint32_t Hull;
+	uint32_t Model;
+};
+
+// trace_t, less the entity.
+struct TraceResult {
+	float Fraction;
+	vec3_t EndPos;
+	vec3_t PlaneNormal;
+	float PlaneDist;
+	bool AllSolid;
+	bool StartSolid;
+	bool InOpen;
+	bool InWater;
+};
+
+// Quake's hull collision (SV_RecursiveHullCheck) over a loaded BSP.
+//
+// The node tree for hull 0 and the clipnodes shared by hulls 1 and 2 are
+// flattened into one array with each node's plane copied into it, so a
+// step of the walk touches a single 32-byte node instead of a node and a
+// plane. Nodes are renumbered depth-first from each model's head node,
+// which puts a node's front child directly after it.
+//
+// The world is immutable once built, so any number of threads may trace
+// through it at once.
+class CollisionWorld {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static const uint32_t HULL_COUNT = 3;
+	// How far impacts are pulled back towards the start, as in Quake.
+	static constexpr float DIST_EPSILON = 0.03125f;
+	// Traces per ParallelFor range in TraceBatch().
+	static const uint32_t TRACE_BATCH_GRAIN = 64;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	struct ClipNode {
+		float Normal[3];
+		float Dist;
+		int32_t Type;
+		// Node indices, or CONTENTS_* when negative.
+		int32_t Children[2];
+		int32_t Padding;
+	};
+	static_assert(sizeof(ClipNode) == 32, "ClipNode should stay half a cache line");
+
+	std::vector<ClipNode> Nodes;
+	std::vector<std::array<int32_t, HULL_COUNT>> HeadNodes;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	void Build(const BspFile& bsp);
+
+	uint32_t GetModelCount() const;
+	// The box a hull expands the world by, relative to the traced point.
+	static void GetHullBounds(uint32_t hull, vec3_t mins, vec3_t maxs);
+
+	// Hull and Model must be in range.
+	int32_t PointContents(const vec3_t point, uint32_t hull = 0, uint32_t model = 0) const;
+	void Trace(const TraceRequest& request, TraceResult& result) const;
+	// Resolves every request on the pool's threads and the caller's; results
+	// are in request order.
+	void TraceBatch(WorkerPool& pool, const TraceRequest* requests, TraceResult* results, uint32_t count) const;
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	int32_t HullPointContents(int32_t num, const vec3_t point) const;
+	bool RecursiveHullCheck(int32_t head, int32_t num, float p1f, float p2f, const vec3_t p1, const vec3_t p2,
+		TraceResult& trace) const;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "Log.h"
+#include "Utils.h"
+
+// Picks the 3D scene's render size each frame so the GPU holds a target
+// frame time.
+//
+// Each frame's command buffer is bracketed by timestamps, one pair per
+// frame in flight, read back once that slot comes round again. The
+// smoothed GPU time drives a scale applied to both axes of the full
+// extent. Pixel cost is roughly proportional to area, so each step aims
+// for the square root of the budget ratio, limited so a single spike
+// can't collapse the resolution.
+//
+// To avoid flickering between sizes, there is a dead band below the
+// budget where nothing changes. Going over budget drops the scale
+// straight away, while raising it needs a run of frames comfortably
+// under budget. After any change the controller waits for the new size
+// to show up in the readbacks before judging it, or the lag would make
+// it overshoot. The scale stays within MIN_SCALE and MAX_SCALE.
+//
+// Devices without timestamps on the graphics queue stay at full size.
+class DynamicResolution {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static constexpr float MIN_SCALE = 0.5f;
+	static constexpr float MAX_SCALE = 1.0f;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	// Fractions of the budget bounding the dead band.
+	static constexpr float RAISE_BELOW = 0.75f;
+	static constexpr float DROP_ABOVE = 1.0f;
+	// Where a step aims, leaving headroom under the budget.
+	static constexpr float AIM = 0.9f;
+	static constexpr float MAX_DROP = 0.85f;
+	static constexpr float MAX_RAISE = 1.05f;
+	static constexpr uint32_t RAISE_DELAY_FRAMES = 30;
+	// Frames in flight plus a few for the smoothing to catch up.
+	static constexpr uint32_t SETTLE_FRAMES = 8;
+	// Weight of the newest sample in the smoothed time.
+	static constexpr float SMOOTHING = 0.2f;
+
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	VkQueryPool Queries = VK_NULL_HANDLE;
+	std::vector<bool> Pending;
+	uint64_t TimestampMask = 0;
+	float TimestampPeriod = 1.0f;
+
+	VkExtent2D MaxExtent{ };
+	VkExtent2D RenderExtent{ };
+	float TargetMs = 0.0f;
+	float Scale = MAX_SCALE;
+	float SmoothedMs = 0.0f;
+	uint32_t FramesUnderBudget = 0;
+	uint32_t SettleFrames = 0;
+
+	uint64_t Samples = 0;
+	double TotalMs = 0.0;
+	double TotalScale = 0.0;
+	float LowestScale = MAX_SCALE;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	// queueFamily is where the timed command buffers are submitted.
+	void Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+		const VkAllocationCallbacks* allocator, uint32_t queueFamily,
+		uint32_t framesInFlight, VkExtent2D maxExtent, float targetMs);
+	void Destroy();
+
+	// Reads back the timing of the frame that last used this slot, which
+	// must have retired, and picks this frame's size.
+	void BeginFrame(uint32_t frame);
+	// Bracket everything the frame records. Both go outside render passes.
+	void WriteStart(VkCommandBuffer commandBuffer, uint32_t frame);
+	void WriteEnd(VkCommandBuffer commandBuffer, uint32_t frame);
+
+	VkExtent2D GetRenderExtent() const;
+	void Report() const;
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void Adjust(float gpuMs);
+	void UpdateExtent();
+};
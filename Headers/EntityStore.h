@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "MathLib.h"
+
+// Refers to an entity across removals. A handle whose entity has been
+// destroyed is detected by its generation and never aliases a newer one.
+struct EntityHandle {
+	uint32_t Slot = 0;
+	uint32_t Generation = 0;
+};
+
+// Quake's hot per-entity fields, stored struct-of-arrays.
+//
+// Live entities are packed densely at indices 0..Count()-1 and each
+// component lives in its own contiguous array, so a pass that reads only
+// bounds or only model and frame streams through just that data rather
+// than striding over whole edict_t-sized records. Destroy() swap-removes:
+// the last entity moves into the hole, which keeps the arrays dense but
+// means dense indices are only stable until the next Destroy(). Hold on to
+// EntityHandles and resolve them with IndexOf() instead.
+//
+// vec3 components are three consecutive floats per entity; the accessors
+// return them as vec3_t-compatible pointers.
+class EntityStore {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	// Dense, one entry (or three floats) per live entity.
+	std::vector<float> Origins;
+	std::vector<float> Angles;
+	std::vector<float> AbsMins;
+	std::vector<float> AbsMaxs;
+	std::vector<uint32_t> Models;
+	std::vector<uint32_t> Frames;
+	std::vector<uint32_t> Flags;
+	std::vector<uint32_t> DenseToSlot;
+
+	// Sparse, indexed by handle slot.
+	std::vector<uint32_t> SlotToDense;
+	std::vector<uint32_t> SlotGenerations;
+	std::vector<uint32_t> FreeSlots;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	void Reserve(uint32_t count);
+	void Clear();
+
+	// New entities start zeroed.
+	EntityHandle Create();
+	// Returns false if the handle was already stale.
+	bool Destroy(EntityHandle handle);
+
+	bool IsAlive(EntityHandle handle) const;
+	// Dense index of a live entity, or INVALID_INDEX.
+	uint32_t IndexOf(EntityHandle handle) const;
+	EntityHandle HandleAt(uint32_t index) const;
+	uint32_t Count() const;
+
+	float* Origin(uint32_t index) { return &Origins[index * 3]; }
+	float* Angle(uint32_t index) { return &Angles[index * 3]; }
+	float* AbsMin(uint32_t index) { return &AbsMins[index * 3]; }
+	float* AbsMax(uint32_t index) { return &AbsMaxs[index * 3]; }
+	uint32_t& Model(uint32_t index) { return Models[index]; }
+	uint32_t& Frame(uint32_t index) { return Frames[index]; }
+	uint32_t& Flag(uint32_t index) { return Flags[index]; }
+
+	const float* Origin(uint32_t index) const { return &Origins[index * 3]; }
+	const float* Angle(uint32_t index) const { return &Angles[index * 3]; }
+	const float* AbsMin(uint32_t index) const { return &AbsMins[index * 3]; }
+	const float* AbsMax(uint32_t index) const { return &AbsMaxs[index * 3]; }
+	uint32_t Model(uint32_t index) const { return Models[index]; }
+	uint32_t Frame(uint32_t index) const { return Frames[index]; }
+	uint32_t Flag(uint32_t index) const { return Flags[index]; }
+
+	// SV_LinkEdict's bounds update: absmin/absmax = origin + mins/maxs.
+	void Link(uint32_t index, const vec3_t mins, const vec3_t maxs);
+
+	// Appends the dense indices of entities whose bounds touch the frustum.
+	void CullBoxes(const float planes[6][4], std::vector<uint32_t>& visible) const;
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BarrierBatch.h"
+#include "Log.h"
+#include "Utils.h"
+
+// Copies presented frames to disk without stalling the render loop.
+//
+// A wanted frame is copied into one of a ring of persistently mapped
+// readback buffers as the last thing its command buffer does. The copy is
+// left alone until the frame has retired, found by the caller's existing
+// fence or timeline wait, and is then handed to a writer thread that
+// encodes it as a TGA. The render thread never waits on the GPU or the
+// disk: while every slot is still being copied or written, sequence frames
+// are dropped and counted, and screenshot requests carry over to the next
+// frame.
+//
+// Only 8-bit RGBA and BGRA images can be captured. Alpha is written as
+// opaque so captures of the same frame compare equal byte for byte.
+class FrameCapture {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	// Slots beyond one per frame in flight, giving the writer some slack.
+	static const uint32_t EXTRA_SLOTS = 2;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	enum class SlotState {
+		Free,
+		Copying,
+		Writing
+	};
+
+	struct Slot {
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+		const uint8_t* Mapped = nullptr;
+		SlotState State = SlotState::Free;
+		uint64_t Frame = 0;
+		std::vector<std::string> Paths;
+	};
+
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	VkExtent2D Extent{ };
+	bool SwapRedBlue = false;
+	bool Coherent = true;
+	// Empty until Init() finds a capturable format.
+	std::vector<Slot> Slots;
+
+	std::string ScreenshotDirectory;
+	uint32_t ScreenshotIndex = 0;
+	// Presses before the next captured frame share one screenshot.
+	bool ScreenshotPending = false;
+
+	std::string SequenceDirectory;
+	bool SequenceActive = false;
+	// 0 runs until StopSequence().
+	uint64_t SequenceLimit = 0;
+	uint64_t SequenceFrame = 0;
+
+	// Guards the slot states and the queue, shared with the writer.
+	std::mutex Mutex;
+	std::condition_variable WorkReady;
+	std::deque<uint32_t> Queue;
+	std::thread Writer;
+	bool Stopping = false;
+
+	uint64_t Captured = 0;
+	uint64_t Dropped = 0;
+	uint64_t Written = 0;
+	uint64_t WriteFailures = 0;
+	double WriteSeconds = 0.0;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	// The captured image must be usable as a transfer source. framesInFlight
+	// sizes the ring so steady continuous capture needs no drops.
+	void Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+		const VkAllocationCallbacks* allocator, VkFormat format, VkExtent2D extent,
+		uint32_t framesInFlight, const std::string& screenshotDirectory);
+	// Writes out every collected frame before returning. No frame that
+	// recorded a copy may still be in flight.
+	void Destroy();
+
+	bool IsAvailable() const;
+	// True while the next Record() would copy its frame.
+	bool IsPending() const;
+
+	// Saves the next frame as the first unused <directory>/quakeNNNN.tga.
+	void RequestScreenshot();
+	// Saves every frame from the next one on as <directory>/frame_NNNNNN.tga,
+	// numbered from the start of the sequence. A frameCount of 0 keeps going
+	// until StopSequence(). Dropped frames leave gaps in the numbering.
+	void StartSequence(const std::string& directory, uint64_t frameCount = 0);
+	void StopSequence();
+	// True once a limited sequence has covered all its frames and every
+	// captured one has been written.
+	bool SequenceFinished();
+
+	// Hands the copies of frames up to retiredFrame to the writer. Those
+	// frames must have completed on the GPU.
+	void Collect(uint64_t retiredFrame);
+	// Records the copy if this frame is wanted. The image must be in
+	// TRANSFER_SRC_OPTIMAL and already synchronised with its writes. The
+	// barrier making the copy visible to the host is added to barriers,
+	// which must be flushed before the command buffer ends.
+	void Record(VkCommandBuffer commandBuffer, VkImage image, uint64_t frame, BarrierBatch& barriers);
+
+	void Report();
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void CreateSlot(const VkPhysicalDevice& physicalDevice, Slot& slot, VkDeviceSize size);
+	std::string NextScreenshotPath();
+	void WriterLoop();
+	bool WriteTga(const std::string& path, const uint8_t* pixels);
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// VkAllocationCallbacks that keep the driver's host allocations out of the
+// global heap and make them visible.
+//
+// Command scope allocations only live for the duration of a single Vulkan
+// call, so they are bumped out of a fixed arena that rewinds whenever it
+// drains. Everything else comes from power-of-two size-class pools whose
+// blocks are recycled through free lists; requests too large for the
+// biggest class go to the heap. Live counts and byte totals are kept per
+// VkSystemAllocationScope and printed by Report().
+//
+// The driver may call back from any thread, so every entry point locks.
+// Objects must be destroyed with the same callbacks they were created with,
+// and the allocator must outlive the instance.
+class HostAllocator {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static const size_t ARENA_SIZE = 256 * 1024;
+	static const size_t MIN_BLOCK_SIZE = 32;
+	static const uint32_t POOL_CLASSES = 8;
+	static const uint32_t BLOCKS_PER_CHUNK = 64;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	static const uint32_t SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+	static const uint32_t ARENA_SOURCE = POOL_CLASSES;
+	static const uint32_t HEAP_SOURCE = POOL_CLASSES + 1;
+
+	// Stored directly in front of every pointer handed to the driver, since
+	// pfnFree gets nothing but the pointer.
+	struct Header {
+		void* Block;
+		size_t Size;
+		uint32_t Scope;
+		uint32_t Source;
+	};
+
+	struct ScopeStats {
+		uint64_t Allocations = 0;
+		uint64_t LiveCount = 0;
+		size_t LiveBytes = 0;
+		size_t PeakBytes = 0;
+		size_t InternalBytes = 0;
+	};
+
+	VkAllocationCallbacks Callbacks{ };
+	mutable std::mutex Mutex;
+
+	std::vector<uint8_t> Arena;
+	size_t ArenaOffset = 0;
+	uint64_t ArenaLive = 0;
+	size_t ArenaFrameBytes = 0;
+	size_t ArenaFramePeak = 0;
+	uint64_t ArenaOverflows = 0;
+
+	std::vector<void*> FreeBlocks[POOL_CLASSES];
+	std::vector<void*> Chunks;
+	uint64_t HeapAllocations = 0;
+
+	ScopeStats Stats[SCOPE_COUNT];
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	HostAllocator();
+	~HostAllocator();
+	HostAllocator(const HostAllocator&) = delete;
+	HostAllocator& operator=(const HostAllocator&) = delete;
+
+	const VkAllocationCallbacks* GetCallbacks() const;
+
+	// Starts the per-frame arena accounting.
+	void BeginFrame();
+	// Bytes the driver holds across every scope, internal ones included.
+	size_t GetLiveBytes() const;
+	void Report() const;
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	static VKAPI_ATTR void* VKAPI_CALL Allocate(void* userData, size_t size, size_t alignment,
+		VkSystemAllocationScope scope);
+	static VKAPI_ATTR void* VKAPI_CALL Reallocate(void* userData, void* original, size_t size,
+		size_t alignment, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void VKAPI_CALL Free(void* userData, void* memory);
+	static VKAPI_ATTR void VKAPI_CALL InternalAllocate(void* userData, size_t size,
+		VkInternalAllocationType type, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void VKAPI_CALL InternalFree(void* userData, size_t size,
+		VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+	void* AllocateLocked(size_t size, size_t alignment, VkSystemAllocationScope scope);
+	void FreeLocked(void* memory);
+	uint8_t* AllocateFromArena(size_t size, size_t alignment);
+	uint8_t* AllocateBlock(uint32_t sizeClass);
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "WorldGeometry.h"
+
+// On-disk layout of a cooked level (.vqp), written by QuakeCook.
+//
+// A header and section table are followed by sections, each starting on a
+// SECTION_ALIGNMENT boundary, holding arrays of exactly the structures the
+// renderer uploads. Every image is stored with its full mip chain back to
+// back and tightly packed, which is what UploadQueue::UploadImage takes,
+// so loading copies straight from the mapping into staging with no
+// conversion. All values are little-endian.
+//
+// SourceHash covers the source BSP, the palette and the format version.
+// The cooker compares it to skip maps that haven't changed.
+
+// Image and surface indices refer to the Images section.
+// NO_IMAGE marks a surface with no texture or no lightmap.
+static const uint32_t PACKAGE_NO_IMAGE = UINT32_MAX;
+
+enum class PackageSectionType : uint32_t {
+	Vertices,	// WorldVertex[]
+	Indices,	// uint32_t[], relative to each surface's VertexOffset
+	Surfaces,	// WorldSurface[], Texture and Lightmap index Images
+	Images,		// PackageImage[]
+	ImageData,	// texels referenced by Images
+	Count
+};
+
+enum class PackageImageFormat : uint32_t {
+	Rgba8,
+	R8
+};
+
+struct PackageHeader {
+	char Magic[4];
+	uint32_t Version;
+	uint64_t SourceHash;
+	uint64_t FileSize;
+	uint32_t SectionCount;
+	uint32_t Reserved;
+};
+
+struct PackageSection {
+	PackageSectionType Type;
+	uint32_t Reserved;
+	uint64_t Offset;
+	uint64_t Size;
+};
+
+struct PackageImage {
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t MipLevels;
+	PackageImageFormat Format;
+	// Relative to the start of the ImageData section.
+	uint64_t DataOffset;
+	uint64_t DataSize;
+};
+
+// A cooked level mapped read-only into memory. Open() checks the header,
+// the section table, that every surface and image lies within its section
+// and that every index lands on a vertex, but never reads the texel or
+// vertex pages themselves, so they are only faulted in as they are copied
+// to the GPU.
+class LevelPackage {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static constexpr char MAGIC[4] = { 'V', 'Q', 'P', 'K' };
+	static const uint32_t VERSION = 1;
+	static const uint64_t SECTION_ALIGNMENT = 4096;
+	// Start of each image within ImageData.
+	static const uint64_t IMAGE_ALIGNMENT = 16;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	const uint8_t* Data = nullptr;
+	uint64_t Size = 0;
+	const PackageSection* Sections[static_cast<uint32_t>(PackageSectionType::Count)] = { };
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	LevelPackage() = default;
+	~LevelPackage();
+	LevelPackage(const LevelPackage&) = delete;
+	LevelPackage& operator=(const LevelPackage&) = delete;
+
+	void Open(const std::string& filename);
+	void Close();
+
+	uint64_t GetSourceHash() const;
+
+	const WorldVertex* GetVertices(size_t& count) const;
+	const uint32_t* GetIndices(size_t& count) const;
+	const WorldSurface* GetSurfaces(size_t& count) const;
+	const PackageImage* GetImages(size_t& count) const;
+	const uint8_t* GetImageData(const PackageImage& image) const;
+
+	// FNV-1a, chained through seed.
+	static uint64_t Hash(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+	static uint32_t GetTexelSize(PackageImageFormat format);
+	// Bytes in a full chain of mipLevels levels, each tightly packed.
+	static uint64_t GetImageSize(uint32_t width, uint32_t height, uint32_t mipLevels, PackageImageFormat format);
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void Validate();
+	template <typename T>
+	const T* GetSection(PackageSectionType type, size_t& count) const;
+};
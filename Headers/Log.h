@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class LogSeverity : uint32_t {
+	Verbose,
+	Info,
+	Warning,
+	Error
+};
+
+// Process-wide log sink.
+//
+// Write() never blocks and never touches a stream: filtered messages are
+// rejected before any formatting, the rest are copied into a bounded
+// lock-free multi-producer ring and a background thread drains it, batching
+// output and flushing once per drain. When the ring is full the message is
+// dropped and counted rather than stalling the caller.
+//
+// A message ID of 0 means "untracked". Non-zero IDs (validation messages
+// use messageIdNumber) can be muted and are rate limited to MAX_REPEATS per
+// RATE_WINDOW_MS; the first message after a suppressed burst reports how
+// many repeats were swallowed.
+//
+// Messages written before Start() are queued and Stop() drains whatever is
+// left on the calling thread, so nothing is lost around startup or a crash
+// that unwinds to main.
+class Log {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static const uint32_t RING_SIZE = 512;
+	static const size_t MAX_MESSAGE = 1024;
+	static const uint32_t MAX_REPEATS = 8;
+	static const uint32_t RATE_WINDOW_MS = 1000;
+	static const uint32_t MAX_MUTED = 32;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	static void Start();
+	static void Stop();
+
+	static void SetMinSeverity(LogSeverity severity);
+	static LogSeverity GetMinSeverity();
+	static void Mute(int32_t messageId);
+
+	static void Write(LogSeverity severity, int32_t messageId, const char* text);
+#if defined(__GNUC__)
+	__attribute__((format(printf, 3, 4)))
+#endif
+	static void Writef(LogSeverity severity, int32_t messageId, const char* format, ...);
+};
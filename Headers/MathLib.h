@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cmath>
+#include <cstring>
+
+typedef float vec_t;
+typedef vec_t vec3_t[3];
+
+// Column-major 4x4 matrix, laid out the way GLSL expects a mat4.
+struct Mat4 {
+	float m[16];
+
+	static Mat4 Identity() {
+		Mat4 result{ };
+		result.m[0] = result.m[5] = result.m[10] = result.m[15] = 1.0f;
+		return result;
+	}
+};
+
+inline void VectorCopy(const vec3_t in, vec3_t out) {
+	out[0] = in[0];
+	out[1] = in[1];
+	out[2] = in[2];
+}
+
+inline vec_t DotProduct(const vec3_t a, const vec3_t b) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Angle indices, as in Quake.
+static const int PITCH = 0;
+static const int YAW = 1;
+static const int ROLL = 2;
+
+static const float M_PI_F = 3.14159265358979323846f;
+
+inline void AngleVectors(const vec3_t angles, vec3_t forward, vec3_t right, vec3_t up) {
+	float angle = angles[YAW] * (M_PI_F * 2.0f / 360.0f);
+	float sy = std::sin(angle);
+	float cy = std::cos(angle);
+	angle = angles[PITCH] * (M_PI_F * 2.0f / 360.0f);
+	float sp = std::sin(angle);
+	float cp = std::cos(angle);
+	angle = angles[ROLL] * (M_PI_F * 2.0f / 360.0f);
+	float sr = std::sin(angle);
+	float cr = std::cos(angle);
+
+	forward[0] = cp * cy;
+	forward[1] = cp * sy;
+	forward[2] = -sp;
+	right[0] = (-1.0f * sr * sp * cy + -1.0f * cr * -sy);
+	right[1] = (-1.0f * sr * sp * sy + -1.0f * cr * cy);
+	right[2] = -1.0f * sr * cp;
+	up[0] = (cr * sp * cy + -sr * -sy);
+	up[1] = (cr * sp * sy + -sr * cy);
+	up[2] = cr * cp;
+}
+
+// Interpolates along the shorter way round, so 350 -> 10 passes through 0.
+inline float LerpAngle(float from, float to, float frac) {
+	float delta = to - from;
+	if (delta > 180.0f) {
+		delta -= 360.0f;
+	}
+	else if (delta < -180.0f) {
+		delta += 360.0f;
+	}
+	return from + frac * delta;
+}
+
+inline Mat4 Mat4Multiply(const Mat4& a, const Mat4& b) {
+	Mat4 result{ };
+	for (int c = 0; c < 4; ++c) {
+		for (int r = 0; r < 4; ++r) {
+			float sum = 0.0f;
+			for (int k = 0; k < 4; ++k) {
+				sum += a.m[k * 4 + r] * b.m[c * 4 + k];
+			}
+			result.m[c * 4 + r] = sum;
+		}
+	}
+	return result;
+}
+
+// Vulkan clip space: x right, y down, depth 0..1. View space is x right,
+// y down, z forward, which is what ViewMatrix produces.
+inline Mat4 PerspectiveMatrix(float fovX, float aspect, float zNear, float zFar) {
+	float x = 1.0f / std::tan(fovX * (M_PI_F / 360.0f));
+	Mat4 result{ };
+	result.m[0] = x;
+	result.m[5] = x * aspect;
+	result.m[10] = zFar / (zFar - zNear);
+	result.m[11] = 1.0f;
+	result.m[14] = -zNear * zFar / (zFar - zNear);
+	return result;
+}
+
+// Quake world space (x forward, y left, z up at zero angles) to view space.
+inline Mat4 ViewMatrix(const vec3_t origin, const vec3_t angles) {
+	vec3_t forward, right, up;
+	AngleVectors(angles, forward, right, up);
+
+	Mat4 result = Mat4::Identity();
+	for (int c = 0; c < 3; ++c) {
+		result.m[c * 4 + 0] = right[c];
+		result.m[c * 4 + 1] = -up[c];
+		result.m[c * 4 + 2] = forward[c];
+	}
+	result.m[12] = -DotProduct(right, origin);
+	result.m[13] = DotProduct(up, origin);
+	result.m[14] = -DotProduct(forward, origin);
+	return result;
+}
+
+// Extracts the six frustum planes (nx, ny, nz, d), normals pointing inwards,
+// from a view-projection matrix with Vulkan's 0..w depth range.
+inline void ExtractFrustumPlanes(const Mat4& viewProj, float planes[6][4]) {
+	const float* m = viewProj.m;
+	for (int c = 0; c < 4; ++c) {
+		float row0 = m[c * 4 + 0];
+		float row1 = m[c * 4 + 1];
+		float row2 = m[c * 4 + 2];
+		float row3 = m[c * 4 + 3];
+		planes[0][c] = row3 + row0;
+		planes[1][c] = row3 - row0;
+		planes[2][c] = row3 + row1;
+		planes[3][c] = row3 - row1;
+		planes[4][c] = row2;
+		planes[5][c] = row3 - row2;
+	}
+
+	for (int i = 0; i < 6; ++i) {
+		float length = std::sqrt(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+		if (length > 0.0f) {
+			for (int c = 0; c < 4; ++c) {
+				planes[i][c] /= length;
+			}
+		}
+	}
+}
+
+// True when the box lies entirely behind one of the planes.
+inline bool BoxOutsideFrustum(const float planes[6][4], const vec3_t mins, const vec3_t maxs) {
+	for (int i = 0; i < 6; ++i) {
+		float x = planes[i][0] >= 0.0f ? maxs[0] : mins[0];
+		float y = planes[i][1] >= 0.0f ? maxs[1] : mins[1];
+		float z = planes[i][2] >= 0.0f ? maxs[2] : mins[2];
+		if (planes[i][0] * x + planes[i][1] * y + planes[i][2] * z + planes[i][3] < 0.0f) {
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class MetricType : uint32_t {
+	// Summed; reported per frame.
+	Counter,
+	// The latest value set.
+	Gauge,
+	// Every recorded value; reported as count, mean, percentiles and max.
+	Histogram
+};
+
+// Process-wide runtime telemetry for spotting regressions in long runs.
+//
+// Metrics are registered by name once, typically into a file-scope
+// constant, and updated through the returned ID. Updates go to a block
+// owned by the calling thread: plain relaxed loads and stores with no
+// shared cache lines, locks or atomic read-modify-writes, so they cost
+// about as much as incrementing a local. A thread's first update
+// allocates its block, so the audio callback and other threads that must
+// never allocate don't record.
+//
+// EndFrame() folds every thread's block into the frame's totals. Every
+// export interval those are appended to a file as one JSON line, and
+// every DISPLAY_INTERVAL_MS they are formatted as text for an overlay.
+// Histograms bucket values logarithmically, BUCKETS_PER_OCTAVE per power
+// of two, so percentiles are accurate to within a bucket.
+//
+// Names are lower case with digits and underscores, and end in the unit
+// where there is one ("fence_wait_ms").
+class Metrics {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static const uint32_t MAX_METRICS = 64;
+	static const uint32_t MAX_HISTOGRAMS = 16;
+	static const size_t MAX_NAME = 32;
+	static const uint32_t BUCKETS_PER_OCTAVE = 4;
+	// Buckets cover 2^MIN_EXPONENT (about 0.004) to 2^(MIN_EXPONENT + OCTAVES).
+	static const int32_t MIN_EXPONENT = -8;
+	static const uint32_t OCTAVES = 32;
+	static const uint32_t BUCKET_COUNT = BUCKETS_PER_OCTAVE * OCTAVES;
+	static const uint32_t DISPLAY_INTERVAL_MS = 500;
+	static const size_t MAX_OVERLAY_TEXT = 2048;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	// Any thread. Registering a name again returns the same ID; throws if
+	// the name is malformed, already registered as another type, or the
+	// registry is full.
+	static uint32_t Register(const char* name, MetricType type);
+
+	// Any thread.
+	static void Add(uint32_t counter, uint64_t amount = 1);
+	static void Set(uint32_t gauge, double value);
+	static void Record(uint32_t histogram, double value);
+
+	// The rest are for the thread that renders.
+	static void EndFrame();
+	// Appends a line to the file every intervalMs of frames, until
+	// StopExport() writes the last, partial interval and closes it.
+	static void StartExport(const std::string& filename, uint32_t intervalMs);
+	static void StopExport();
+	// One line per metric for the last display interval.
+	static const char* GetOverlayText();
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "MathLib.h"
+#include "PipelineTarget.h"
+#include "Shader.h"
+#include "Utils.h"
+
+// GPU layout of a particle, matching the std430 struct in particle.comp.
+struct Particle {
+	float Origin[3];
+	float Die;
+	float Velocity[3];
+	float Gravity;
+	float Color[4];
+};
+
+// Simulates Quake's particle effects and draws them as instanced quads.
+//
+// With a separate compute queue family, particles live in device-local
+// storage buffers that are ping-ponged per frame in flight: the compute
+// queue reads last frame's state, folds in newly spawned particles and
+// writes this frame's, while the graphics queue draws from it once the
+// compute semaphore signals. Without one, the same simulation runs on the
+// CPU over struct-of-arrays state with SIMD and is streamed through
+// host-visible instance buffers.
+//
+// Either way only the ring slots written since the system was last idle
+// are simulated and drawn, and once every particle spawned has died both
+// are skipped until the next spawn.
+class ParticleSystem {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static const uint32_t MAX_PARTICLES = 16384;
+	static const uint32_t MAX_SPAWN_PER_FRAME = 4096;
+
+	float Gravity = 800.0f;
+	float Size = 0.006f;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	struct ComputeStep {
+		float FrameTime;
+		float Gravity;
+		float Time;
+		uint32_t SpawnBase;
+		uint32_t SpawnCount;
+		uint32_t MaxParticles;
+		uint32_t ActiveCount;
+	};
+
+	struct DrawStep {
+		Mat4 ViewProj;
+		float Time;
+		float Size;
+	};
+
+	VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	uint32_t GraphicsFamily = 0;
+	uint32_t ComputeFamily = 0;
+	bool AsyncCompute = false;
+	VkQueue ComputeQueue = VK_NULL_HANDLE;
+	uint32_t FramesInFlight = 0;
+
+	Shader ComputeShader;
+	Shader DrawShader;
+	VkDescriptorSetLayout ComputeSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout ComputeLayout = VK_NULL_HANDLE;
+	VkPipeline ComputePipeline = VK_NULL_HANDLE;
+	VkPipelineLayout DrawLayout = VK_NULL_HANDLE;
+	VkPipeline DrawPipeline = VK_NULL_HANDLE;
+
+	VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> DescriptorSets;
+	VkCommandPool ComputeCommandPool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> ComputeCommandBuffers;
+	std::vector<VkSemaphore> ComputeFinishedSemaphores;
+
+	// One state buffer per frame in flight on the compute path, one
+	// instance buffer per frame in flight on the CPU path.
+	std::vector<VkBuffer> ParticleBuffers;
+	std::vector<VkDeviceMemory> ParticleMemory;
+	std::vector<Particle*> ParticleMapped;
+	std::vector<VkBuffer> SpawnBuffers;
+	std::vector<VkDeviceMemory> SpawnMemory;
+	std::vector<Particle*> SpawnMapped;
+
+	std::vector<Particle> PendingSpawns;
+	uint32_t SpawnCursor = 0;
+	// Ring slots 0..ActiveCount-1 have been spawned into since the system
+	// was last idle, and every particle dies by LatestDie.
+	uint32_t ActiveCount = 0;
+	float LatestDie = 0.0f;
+	// Instances this frame's Simulate() left for Draw(); 0 when idle.
+	uint32_t DrawCount = 0;
+
+	// CPU simulation state, struct-of-arrays for SIMD.
+	std::unique_ptr<float[]> OriginX, OriginY, OriginZ;
+	std::unique_ptr<float[]> VelocityX, VelocityY, VelocityZ;
+	std::unique_ptr<float[]> DieTime, GravityScale;
+	std::unique_ptr<float[]> Colors;
+
+	std::mt19937 Random;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	void Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+		const VkAllocationCallbacks* allocator,
+		uint32_t graphicsFamily, std::optional<uint32_t> computeFamily,
+		const PipelineTarget& target, uint32_t framesInFlight);
+	void Destroy();
+
+	bool HasAsyncCompute() const;
+
+	void Spawn(const Particle& particle);
+	void ParticleExplosion(const vec3_t origin, float time);
+	void TeleportSplash(const vec3_t origin, float time);
+
+	// Advances the simulation for the given frame slot. On the compute path
+	// this submits to the compute queue and appends the semaphore the
+	// graphics submit has to wait on. Does nothing while every particle is
+	// dead, and Draw() then draws nothing either.
+	void Simulate(uint32_t frame, float time, float frameTime,
+		std::vector<VkSemaphore>& waitSemaphores,
+		std::vector<VkPipelineStageFlags>& waitStages);
+	// Must be recorded inside the main render pass or rendering scope.
+	void Draw(VkCommandBuffer commandBuffer, uint32_t frame, const Mat4& viewProj, float time);
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void CreateBuffers();
+	void CreateDescriptors();
+	void CreateComputePipeline();
+	void CreateGraphicsPipeline(const PipelineTarget& target);
+	void CreateComputeCommands();
+
+	void SimulateCompute(uint32_t frame, float time, float frameTime,
+		std::vector<VkSemaphore>& waitSemaphores,
+		std::vector<VkPipelineStageFlags>& waitStages);
+	void SimulateCpu(uint32_t frame, float frameTime);
+	void GrowActiveRange(uint32_t spawnCount);
+};
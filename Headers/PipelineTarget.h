@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// The attachments a graphics pipeline renders into. On the render pass path
+// RenderPass is set; on the dynamic rendering path it is VK_NULL_HANDLE
+// and the formats are chained into the pipeline instead. Either format may
+// be VK_FORMAT_UNDEFINED, e.g. no colour for a depth-only pass. Pipelines
+// must rasterize at Samples.
+struct PipelineTarget {
+	VkRenderPass RenderPass = VK_NULL_HANDLE;
+	uint32_t Subpass = 0;
+	VkFormat ColorFormat = VK_FORMAT_UNDEFINED;
+	VkFormat DepthFormat = VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT;
+
+	// rendering must outlive the vkCreateGraphicsPipelines call.
+	void Apply(VkGraphicsPipelineCreateInfo& pipelineInfo, VkPipelineRenderingCreateInfo& rendering) const {
+		if (RenderPass != VK_NULL_HANDLE) {
+			pipelineInfo.renderPass = RenderPass;
+			pipelineInfo.subpass = Subpass;
+			return;
+		}
+
+		rendering = VkPipelineRenderingCreateInfo{ };
+		rendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+		rendering.colorAttachmentCount = ColorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+		rendering.pColorAttachmentFormats = &ColorFormat;
+		rendering.depthAttachmentFormat = DepthFormat;
+		rendering.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+
+		rendering.pNext = pipelineInfo.pNext;
+		pipelineInfo.pNext = &rendering;
+		pipelineInfo.renderPass = VK_NULL_HANDLE;
+		pipelineInfo.subpass = 0;
+	}
+};
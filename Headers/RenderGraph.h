@@ -0,0 +1,219 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "BarrierBatch.h"
+#include "PipelineTarget.h"
+
+typedef uint32_t RenderResource;
+
+// How a pass uses an image. Each one implies a layout, the stages and
+// accesses to synchronise against, and the usage flags the image needs.
+enum class RenderAccess : uint32_t {
+	ColorWrite,
+	// The single-sample target a multisampled ColorWrite resolves into.
+	ColorResolve,
+	DepthWrite,
+	// Depth tested but not written.
+	DepthRead,
+	// Sampled in a fragment shader.
+	ShaderRead,
+	// Copied from, e.g. for a readback.
+	TransferRead
+};
+
+// Describes a frame as a list of passes and the images they use, and
+// records it with the synchronisation worked out ahead of time.
+//
+// Passes run in the order they were added. Compile() drops passes whose
+// results nothing uses (anything writing an imported image, or marked with
+// SetSideEffects(), is used), then plans every layout transition and
+// dependency between the passes that remain. Execute() only has to look
+// the images up: each pass gets a single barrier batch, and the first one
+// also carries whatever the caller had already queued.
+//
+// Optional passes only read, and run only on frames they are enabled for
+// with SetOptionalPassesEnabled(). Compile() plans the barriers both with
+// and without them, so a frame that skips them pays for nothing, not even
+// a layout transition.
+//
+// Images created with CreateImage() belong to the graph and only hold data
+// within a frame. Those whose lifetimes do not overlap share memory, and
+// those used by a single pass never leave the tile and are backed by lazily
+// allocated memory where the device has it. Imported images, like the
+// swapchain, are provided each frame with SetImportedImage().
+//
+// Graphics passes use dynamic rendering on the modern path; on the 1.0
+// path Compile() creates a render pass for each and framebuffers are made
+// on first use. Either way the pass's pipelines come from
+// GetPipelineTarget(), so Compile() must run before they are created.
+class RenderGraph {
+// ------------------------
+// Private members
+// ------------------------
+private:
+	struct Access {
+		RenderResource Resource;
+		RenderAccess Type;
+		VkAttachmentLoadOp LoadOp;
+		VkClearValue ClearValue;
+		// ColorResolve only: the ColorWrite resolved from.
+		RenderResource ResolveSource;
+		// Filled in by Compile().
+		VkAttachmentStoreOp StoreOp;
+	};
+
+	struct PlannedBarrier {
+		RenderResource Resource;
+		VkImageLayout OldLayout;
+		VkImageLayout NewLayout;
+		VkPipelineStageFlags2 SrcStage;
+		VkAccessFlags2 SrcAccess;
+		VkPipelineStageFlags2 DstStage;
+		VkAccessFlags2 DstAccess;
+	};
+
+	struct Framebuffer {
+		std::vector<VkImageView> Views;
+		VkFramebuffer Handle;
+	};
+
+	struct Pass {
+		std::string Name;
+		std::function<void(VkCommandBuffer)> Record;
+		std::vector<Access> Accesses;
+		bool SideEffects = false;
+		bool Optional = false;
+		// Zero means the whole attachment.
+		VkExtent2D RenderArea{ };
+
+		// Filled in by Compile().
+		bool Culled = false;
+		bool Graphics = false;
+		VkExtent2D Extent{ };
+		std::vector<PlannedBarrier> Barriers;
+		// The plan for frames that skip the optional passes.
+		std::vector<PlannedBarrier> BarriersWithoutOptional;
+		VkRenderPass RenderPass = VK_NULL_HANDLE;
+		std::vector<Framebuffer> Framebuffers;
+	};
+
+	struct Resource {
+		std::string Name;
+		bool Imported = false;
+		VkFormat Format = VK_FORMAT_UNDEFINED;
+		VkExtent2D Extent{ };
+		VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT;
+		VkImage Image = VK_NULL_HANDLE;
+		VkImageView View = VK_NULL_HANDLE;
+
+		// Imported only.
+		VkImageLayout InitialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageLayout FinalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags2 InitialStage = 0;
+
+		// Filled in by Compile().
+		VkImageUsageFlags Usage = 0;
+		uint32_t FirstPass = 0;
+		uint32_t LastPass = 0;
+		bool Used = false;
+		bool Lazy = false;
+		// The image that used this one's memory last, possibly itself in the
+		// previous frame. Its last access is what the first use waits for.
+		RenderResource Previous = 0;
+		VkPipelineStageFlags2 LastStage = 0;
+		VkAccessFlags2 LastWriteAccess = 0;
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+	};
+
+	struct MemoryBlock {
+		std::vector<RenderResource> Resources;
+		VkDeviceSize Size = 0;
+		uint32_t TypeBits = 0;
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+	};
+
+	VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	bool ModernPath = false;
+
+	std::vector<Resource> Resources;
+	std::vector<Pass> Passes;
+	std::vector<MemoryBlock> MemoryBlocks;
+	std::vector<PlannedBarrier> FinalBarriers;
+	std::vector<PlannedBarrier> FinalBarriersWithoutOptional;
+	bool OptionalPassesEnabled = false;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	// modernPath selects dynamic rendering and synchronization2.
+	void Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+		const VkAllocationCallbacks* allocator, bool modernPath);
+	void Destroy();
+
+	// initialStage is what the image's first use has to wait for, such as
+	// the stage the swapchain acquire semaphore is waited on at. A
+	// finalLayout other than UNDEFINED marks the image as a frame output.
+	RenderResource ImportImage(const std::string& name, VkFormat format, VkExtent2D extent,
+		VkImageLayout initialLayout, VkImageLayout finalLayout, VkPipelineStageFlags2 initialStage);
+	RenderResource CreateImage(const std::string& name, VkFormat format, VkExtent2D extent,
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+	void SetImportedImage(RenderResource resource, VkImage image, VkImageView view);
+	// Changes a created image's size. Takes effect at the next Compile().
+	void ResizeImage(RenderResource resource, VkExtent2D extent);
+
+	uint32_t AddPass(const std::string& name, std::function<void(VkCommandBuffer)> record);
+	// Keeps a pass that writes nothing the frame outputs, e.g. one that
+	// only copies to a buffer.
+	void SetSideEffects(uint32_t pass);
+	// Makes a pass that only reads run just on frames with optional passes
+	// enabled. It is never culled.
+	void SetOptional(uint32_t pass);
+	// For every Execute() from now on. Off by default.
+	void SetOptionalPassesEnabled(bool enabled);
+	// Limits a graphics pass to the top-left area of its attachments from
+	// the next Execute() on, e.g. to render at a lower resolution without
+	// recompiling. Loads, stores and resolves only touch that area; the
+	// rest of each attachment is left undefined.
+	void SetRenderArea(uint32_t pass, VkExtent2D area);
+	void WriteColor(uint32_t pass, RenderResource resource, VkAttachmentLoadOp loadOp,
+		VkClearValue clearValue = VkClearValue{ });
+	void ResolveColor(uint32_t pass, RenderResource source, RenderResource target);
+	void WriteDepth(uint32_t pass, RenderResource resource, VkAttachmentLoadOp loadOp,
+		VkClearValue clearValue = VkClearValue{ });
+	void Read(uint32_t pass, RenderResource resource, RenderAccess type);
+
+	// Plans the frame and (re)creates the graph's images and render passes.
+	// Recompiling destroys the previous ones, so the device must be idle.
+	void Compile();
+	void Execute(VkCommandBuffer commandBuffer, BarrierBatch& barriers);
+
+	PipelineTarget GetPipelineTarget(uint32_t pass) const;
+	VkImage GetImage(RenderResource resource) const;
+	VkImageView GetImageView(RenderResource resource) const;
+	bool IsCulled(uint32_t pass) const;
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void AddAccess(uint32_t pass, const Access& access);
+	void ReleaseCompiled();
+	void CullPasses();
+	void PlanLifetimes();
+	void AllocateImages();
+	void PlanBarriers(bool withOptional);
+	void CreateRenderPass(Pass& pass);
+	void BeginPass(VkCommandBuffer commandBuffer, Pass& pass);
+	void EndPass(VkCommandBuffer commandBuffer);
+	VkFramebuffer GetFramebuffer(Pass& pass);
+	void AddBarrier(BarrierBatch& barriers, const PlannedBarrier& barrier) const;
+	uint32_t FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+};
@@ -22,9 +22,13 @@ public:
 private:
 	VkShaderModule Vert = VK_NULL_HANDLE;
 	VkShaderModule Frag = VK_NULL_HANDLE;
+	VkShaderModule Comp = VK_NULL_HANDLE;
+	// Kept so the modules are destroyed with the callbacks they were created with.
+	const VkAllocationCallbacks* Allocator = nullptr;
 
 	std::string vertFilename;
 	std::string fragFilename;
+	std::string compFilename;
 
 // ------------------------
 // Public methods
@@ -36,11 +40,13 @@ public:
 
 	VkShaderModule GetVert() const;
 	VkShaderModule GetFrag() const;
+	VkShaderModule GetComp() const;
 
 	void SetVertShaderFilename(const std::string& filename);
 	void SetFragShaderFilename(const std::string& filename);
+	void SetCompShaderFilename(const std::string& filename);
 
-	void CompileShader(const VkDevice& device);
+	void CompileShader(const VkDevice& device, const VkAllocationCallbacks* allocator);
 
 	void DestroyShader(const VkDevice& device);
 
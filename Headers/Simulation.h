@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "MathLib.h"
+#include "TripleBuffer.h"
+
+// What the client asks for each frame, like Quake's usercmd_t. The view
+// angles are owned by the client; the moves are in units per second.
+struct UserCommand {
+	vec3_t ViewAngles;
+	float ForwardMove;
+	float SideMove;
+	float UpMove;
+};
+
+// The simulation's state after one tick, as handed to the renderer.
+struct SimSnapshot {
+	uint64_t Tick;
+	// Seconds since Start() at the end of this tick. Skipped ticks still
+	// advance it, so it stays in step with the wall clock.
+	double Time;
+	vec3_t Origin;
+	vec3_t Velocity;
+};
+
+// Runs the game on its own thread at a fixed TICK_RATE, independent of the
+// render frame rate.
+//
+// Commands go in and snapshots come out through TripleBuffers, so neither
+// thread ever blocks on the other. The renderer keeps the last two
+// snapshots and draws one tick behind, interpolating between them; when
+// the simulation stalls the view holds on the newest snapshot instead of
+// extrapolating. A long stall is not caught up in full: at most
+// MAX_CATCHUP_TICKS run back to back before the clock is resynchronised.
+class Simulation {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	// Quake's sys_ticrate default of 0.05.
+	static const uint32_t TICK_RATE = 20;
+	static const uint32_t MAX_CATCHUP_TICKS = 5;
+
+	// Quake's default movement cvars.
+	static constexpr float MAX_SPEED = 320.0f;
+	static constexpr float ACCELERATE = 10.0f;
+	static constexpr float FRICTION = 4.0f;
+	static constexpr float STOP_SPEED = 100.0f;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	std::thread Thread;
+	std::atomic<bool> Running{ false };
+	std::chrono::steady_clock::time_point StartTime;
+
+	TripleBuffer<UserCommand> Commands;
+	TripleBuffer<SimSnapshot> Snapshots;
+
+	// Simulation thread only.
+	SimSnapshot State{ };
+	UserCommand Command{ };
+
+	// Render thread only.
+	SimSnapshot Previous{ };
+	SimSnapshot Current{ };
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	~Simulation();
+
+	void Start(const vec3_t origin, const vec3_t angles);
+	void Stop();
+
+	// Render thread.
+	void SubmitCommand(const UserCommand& command);
+	// Returns the view origin interpolated for the current time. The view
+	// angles are the client's own, so they are used as is, not lagged.
+	void SampleView(vec3_t origin);
+	uint64_t GetTick() const;
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void Run();
+	void Tick(float frameTime);
+	void Publish();
+	void Friction(float frameTime);
+	void Accelerate(const vec3_t wishDir, float wishSpeed, float frameTime);
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "MathLib.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+
+// Mono float PCM at its own rate. Data holds Length frames plus one guard
+// frame so resampling can always read a frame past the one it is on; call
+// SoundMixer::PadSample() once Data is filled.
+struct SoundSample {
+	std::vector<float> Data;
+	uint32_t Length = 0;
+	uint32_t Rate = 0;
+	// Frame the sound loops back to at its end, or -1 to play once.
+	int32_t LoopStart = -1;
+};
+
+// S_StartSound's arguments.
+struct SoundStart {
+	const SoundSample* Sample;
+	int32_t Entity;
+	// A sound on a non-zero channel replaces whatever that entity is
+	// playing on it; -1 replaces any of the entity's channels.
+	int32_t Channel;
+	vec3_t Origin;
+	// 0 to 1.
+	float Volume;
+	// One of the ATTN_ values; 0 is heard at full volume everywhere.
+	float Attenuation;
+};
+
+// Quake's dynamic sound mixing.
+//
+// The game thread starts and stops sounds through a SpscQueue and moves
+// the listener through a TripleBuffer; Mix() runs on the audio thread and
+// applies both before it mixes. Mix() never takes a lock or allocates:
+// channels and mix buffers are fixed arrays and samples are referenced,
+// not copied, so they must outlive the mixer's use of them.
+//
+// Each channel is resampled with linear interpolation and panned with
+// SND_Spatialize's distance and dot-product law, four output frames at a
+// time with SSE2, into planar float buffers that are clamped and
+// interleaved to 16-bit stereo at the end. A full mixer steals the channel
+// closest to finishing, as SND_PickChannel does; looping sounds and the
+// listener's own sounds are never stolen by others.
+class SoundMixer {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static const uint32_t MAX_CHANNELS = 128;
+	// Frames mixed per pass; longer requests are mixed in several passes.
+	static const uint32_t MIX_BLOCK = 256;
+	static const uint32_t COMMAND_QUEUE_SIZE = 256;
+
+	// Quake's attenuations and sound_nominal_clip_dist.
+	static constexpr float ATTN_NONE = 0.0f;
+	static constexpr float ATTN_NORM = 1.0f;
+	static constexpr float ATTN_IDLE = 2.0f;
+	static constexpr float ATTN_STATIC = 3.0f;
+	static constexpr float NOMINAL_CLIP_DISTANCE = 1000.0f;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	enum class CommandType : uint32_t {
+		Start,
+		Stop,
+		StopAll
+	};
+
+	struct Command {
+		CommandType Type;
+		SoundStart Start;
+	};
+
+	struct Listener {
+		vec3_t Origin;
+		vec3_t Right;
+		int32_t Entity;
+	};
+
+	struct Channel {
+		const SoundSample* Sample = nullptr;
+		// Fixed point 32.32, in sample frames.
+		uint64_t Position = 0;
+		uint64_t Step = 0;
+		int32_t Entity = 0;
+		int32_t EntityChannel = 0;
+		vec3_t Origin{ };
+		float Volume = 0.0f;
+		float DistanceScale = 0.0f;
+		float LeftVolume = 0.0f;
+		float RightVolume = 0.0f;
+	};
+
+	uint32_t OutputRate = 0;
+	SpscQueue<Command, COMMAND_QUEUE_SIZE> Commands;
+	TripleBuffer<Listener> ListenerUpdates;
+
+	// Game thread only.
+	uint64_t DroppedCommands = 0;
+
+	// Audio thread only.
+	Listener CurrentListener{ };
+	Channel Channels[MAX_CHANNELS];
+	alignas(16) float MixLeft[MIX_BLOCK];
+	alignas(16) float MixRight[MIX_BLOCK];
+
+	// Written by the audio thread, read by Report().
+	std::atomic<uint64_t> MixedFrames{ 0 };
+	std::atomic<uint64_t> StolenChannels{ 0 };
+	std::atomic<uint32_t> PeakChannels{ 0 };
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	// Call before the audio thread first calls Mix().
+	void Init(uint32_t outputRate);
+	uint32_t GetOutputRate() const;
+	// Sets the guard frame and drops a loop start outside the sample.
+	static void PadSample(SoundSample& sample);
+
+	// Game thread.
+	void StartSound(const SoundStart& start);
+	void StopSound(int32_t entity, int32_t channel);
+	void StopAllSounds();
+	// Sounds from the listener's own entity are not spatialised.
+	void SetListener(const vec3_t origin, const vec3_t angles, int32_t entity);
+
+	// Audio thread. Writes frames of interleaved 16-bit stereo.
+	void Mix(int16_t* out, uint32_t frames);
+
+	// Once the audio thread has stopped.
+	void Report() const;
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void PushCommand(const Command& command);
+	void ApplyCommands();
+	Channel* PickChannel(int32_t entity, int32_t entityChannel);
+	void Spatialize(Channel& channel) const;
+	void MixChannel(Channel& channel, uint32_t frames);
+	void WriteOutput(int16_t* out, uint32_t frames) const;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MathLib.h"
+#include "SoundMixer.h"
+
+// The SDL audio device and the sounds loaded for it.
+//
+// SDL calls the mixer from its own audio thread; every method here is for
+// the game thread. When no device can be opened the game runs silent:
+// sounds still load, and starting them does nothing.
+class SoundSystem {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static const int OUTPUT_RATE = 44100;
+	// About 12 ms at OUTPUT_RATE, which is also the mixing latency.
+	static const uint16_t DEVICE_FRAMES = 512;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	bool SubsystemStarted = false;
+	SDL_AudioDeviceID Device = 0;
+	SoundMixer Mixer;
+	// Owned here so their addresses stay put while channels play them.
+	std::vector<std::unique_ptr<SoundSample>> Samples;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	void Init();
+	void Destroy();
+	bool IsAvailable() const;
+
+	// Loads a Quake .wav: PCM, mono, 8 or 16 bits, looping from its cue
+	// point if it has one. forceLoop loops a sound without one from its
+	// start. Sounds stay loaded until Destroy().
+	const SoundSample* LoadSound(const std::string& filename, bool forceLoop = false);
+
+	void StartSound(const SoundStart& start);
+	void StopSound(int32_t entity, int32_t channel);
+	void StopAllSounds();
+	void SetListener(const vec3_t origin, const vec3_t angles, int32_t entity);
+
+	void Report() const;
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	static void SDLCALL Callback(void* userdata, Uint8* stream, int length);
+	static void ParseWav(const std::vector<char>& file, const std::string& filename, SoundSample& sample);
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Bounded lock-free single-producer, single-consumer FIFO.
+//
+// Unlike TripleBuffer every value pushed is delivered once, in order, so it
+// carries events rather than state. The storage is fixed at CAPACITY, a
+// power of two, and neither side ever waits or allocates: Push() fails when
+// the queue is full and Pop() fails when it is empty.
+template <typename T, uint32_t CAPACITY>
+class SpscQueue {
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	static const uint32_t MASK = CAPACITY - 1;
+
+	T Slots[CAPACITY]{ };
+	// Free-running counters; only the producer writes Tail and only the
+	// consumer writes Head. Kept on separate cache lines so the two sides
+	// don't bounce one line between them.
+	alignas(64) std::atomic<uint32_t> Head{ 0 };
+	alignas(64) std::atomic<uint32_t> Tail{ 0 };
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	// Producer.
+	bool Push(const T& value) {
+		const uint32_t tail = Tail.load(std::memory_order_relaxed);
+		if (tail - Head.load(std::memory_order_acquire) == CAPACITY) {
+			return false;
+		}
+		Slots[tail & MASK] = value;
+		Tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer.
+	bool Pop(T& value) {
+		const uint32_t head = Head.load(std::memory_order_relaxed);
+		if (head == Tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		value = Slots[head & MASK];
+		Head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "PipelineTarget.h"
+#include "Shader.h"
+#include "Utils.h"
+
+// Draws a block of text, such as Metrics::GetOverlayText(), in the
+// top-left corner of the target.
+//
+// The text is laid out on the CPU into a grid of COLUMNS by ROWS cells in
+// a host-visible buffer per frame in flight, and one fullscreen triangle,
+// scissored to the rows in use, looks each pixel's glyph up in a 3x5
+// font built into the fragment shader. Lower case prints as upper case;
+// anything else outside ASCII 32..95 prints as '?'.
+class StatsOverlay {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static const uint32_t COLUMNS = 60;
+	static const uint32_t ROWS = 20;
+	// Screen pixels per font pixel.
+	static const uint32_t SCALE = 2;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	struct OverlayStep {
+		int32_t Origin[2];
+		uint32_t Columns;
+		uint32_t Scale;
+	};
+
+	// A cell is a 3x5 glyph with a pixel of spacing, as in overlay.frag.
+	static const uint32_t CELL_WIDTH = 4;
+	static const uint32_t CELL_HEIGHT = 6;
+	static const int32_t MARGIN = 8;
+
+	VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	uint32_t FramesInFlight = 0;
+
+	Shader OverlayShader;
+	VkDescriptorSetLayout SetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> DescriptorSets;
+	VkPipelineLayout Layout = VK_NULL_HANDLE;
+	VkPipeline Pipeline = VK_NULL_HANDLE;
+
+	std::vector<VkBuffer> TextBuffers;
+	std::vector<VkDeviceMemory> TextMemory;
+	std::vector<char*> TextMapped;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	void Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+		const VkAllocationCallbacks* allocator, const PipelineTarget& target, uint32_t framesInFlight);
+	void Destroy();
+
+	// Rewrites the frame's grid, so the frame's previous use must have
+	// retired. Must be recorded inside the target's render pass or
+	// rendering scope; leaves the viewport and scissor set to the overlay.
+	void Draw(VkCommandBuffer commandBuffer, uint32_t frame, VkExtent2D extent, const char* text);
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void CreateBuffers();
+	void CreateDescriptors();
+	void CreatePipeline(const PipelineTarget& target);
+};
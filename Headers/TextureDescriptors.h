@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "Utils.h"
+
+// Per-draw texture selection, passed to the shaders as push constants.
+struct MaterialIndices {
+	uint32_t Texture;
+	uint32_t Lightmap;
+};
+
+// Owns the descriptors every world texture and lightmap is sampled through.
+//
+// With descriptor indexing, all registered images live in one large
+// update-after-bind, partially bound array that is bound once per command
+// buffer; draws select their texture and lightmap with MaterialIndices, so
+// consecutive draws with different materials need no descriptor set
+// changes. Without it, each texture/lightmap pair gets a small set
+// allocated from a per-frame pool that is reset when the frame slot is
+// reused.
+class TextureDescriptors {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static const uint32_t MAX_TEXTURES = 4096;
+	static const uint32_t MAX_MATERIALS_PER_FRAME = 1024;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	bool Bindless = false;
+	uint32_t Capacity = 0;
+
+	// Quake samples textures unfiltered and lightmaps bilinearly.
+	VkSampler NearestSampler = VK_NULL_HANDLE;
+	VkSampler LinearSampler = VK_NULL_HANDLE;
+	VkDescriptorSetLayout SetLayout = VK_NULL_HANDLE;
+
+	// Bindless path.
+	VkDescriptorPool GlobalPool = VK_NULL_HANDLE;
+	VkDescriptorSet GlobalSet = VK_NULL_HANDLE;
+	VkCommandBuffer BoundCommandBuffer = VK_NULL_HANDLE;
+
+	// Fallback path, one pool per frame in flight.
+	std::vector<VkDescriptorPool> FramePools;
+	std::vector<std::unordered_map<uint64_t, VkDescriptorSet>> FrameMaterials;
+	VkDescriptorSet BoundSet = VK_NULL_HANDLE;
+	// Layouts with different push constant ranges don't share set 0.
+	VkPipelineLayout BoundLayout = VK_NULL_HANDLE;
+
+	std::vector<VkImageView> Views;
+	std::vector<VkSampler> Samplers;
+	std::vector<uint32_t> FreeSlots;
+	// Released slots per frame slot, reusable once that slot comes round again.
+	std::vector<std::vector<uint32_t>> RetiredSlots;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	void Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+		const VkAllocationCallbacks* allocator, uint32_t framesInFlight, bool bindless);
+	void Destroy();
+
+	bool IsBindless() const;
+	VkDescriptorSetLayout GetSetLayout() const;
+
+	// Returns the index to pass in MaterialIndices. The view must stay
+	// alive until it is released and the frames using it have retired.
+	uint32_t Register(VkImageView view, VkFilter filter);
+	void Release(uint32_t index, uint32_t frame);
+
+	// Call once the frame slot's previous work has completed.
+	void BeginFrame(uint32_t frame);
+	// Binds whatever set the draw needs and returns the push constants for it.
+	MaterialIndices BindMaterial(VkCommandBuffer commandBuffer, VkPipelineLayout layout,
+		uint32_t frame, uint32_t texture, uint32_t lightmap);
+	// Bindless only: binds the whole array for shaders that pick their own
+	// indices, such as indirect draws.
+	void BindArray(VkCommandBuffer commandBuffer, VkPipelineLayout layout);
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void CreateSamplers();
+	void CreateBindlessSet(const VkPhysicalDevice& physicalDevice);
+	void CreateFramePools(uint32_t framesInFlight);
+	void WriteBindless(uint32_t index);
+	VkDescriptorImageInfo GetImageInfo(uint32_t index) const;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer, single-consumer handover of the latest value.
+//
+// The writer fills the back slot and publishes it by swapping it with the
+// middle slot; the reader takes the middle slot by swapping it with its
+// front slot. Neither side ever waits on the other, and the reader always
+// sees the most recently published value. Values published between two
+// reads are skipped, so this is for state, not for a stream of events.
+template <typename T>
+class TripleBuffer {
+// ------------------------
+// Private members
+// ------------------------
+private:
+	static const uint8_t INDEX_MASK = 0x3;
+	static const uint8_t FRESH_BIT = 0x4;
+
+	T Slots[3]{ };
+	// Owned by the writer and reader respectively.
+	uint8_t Back = 0;
+	uint8_t Front = 1;
+	alignas(64) std::atomic<uint8_t> Middle{ 2 };
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	// Writer: the slot to fill. It holds stale data, so overwrite it whole.
+	T& BeginWrite() {
+		return Slots[Back];
+	}
+
+	void Publish() {
+		Back = Middle.exchange(Back | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// Reader: returns true and switches Read() to the newest value if one
+	// has been published since the last call.
+	bool Acquire() {
+		if (!(Middle.load(std::memory_order_relaxed) & FRESH_BIT)) {
+			return false;
+		}
+		Front = Middle.exchange(Front, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+
+	const T& Read() const {
+		return Slots[Front];
+	}
+};
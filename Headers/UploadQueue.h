@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "BarrierBatch.h"
+#include "Utils.h"
+
+// Streams buffer and image data to the GPU through a persistently mapped
+// staging ring. When the device exposes a transfer-only queue family the
+// copies run there, asynchronously to rendering, and ownership of every
+// destination resource is released to the graphics family. The first frame
+// recorded after a batch is submitted acquires it and waits on the batch's
+// semaphore; frames with nothing new to consume wait on nothing.
+//
+// Destination buffers and images must be created with
+// VK_SHARING_MODE_EXCLUSIVE.
+class UploadQueue {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static const VkDeviceSize STAGING_SIZE = 64 * 1024 * 1024;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	struct Batch {
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		VkFence Fence = VK_NULL_HANDLE;
+		VkSemaphore Semaphore = VK_NULL_HANDLE;
+
+		std::vector<VkBufferMemoryBarrier2> BufferAcquires;
+		std::vector<VkImageMemoryBarrier2> ImageAcquires;
+
+		VkDeviceSize RingEnd = 0;
+		VkDeviceSize RingBytes = 0;
+
+		bool Submitted = false;
+		bool StagingReleased = false;
+		bool Acquired = false;
+		uint64_t AcquireFrame = 0;
+	};
+
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+	VkQueue Queue = VK_NULL_HANDLE;
+	uint32_t GraphicsFamily = 0;
+	uint32_t TransferFamily = 0;
+	bool Dedicated = false;
+
+	VkCommandPool CommandPool = VK_NULL_HANDLE;
+
+	VkBuffer StagingBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory StagingMemory = VK_NULL_HANDLE;
+	uint8_t* StagingMapped = nullptr;
+	VkDeviceSize RingHead = 0;
+	VkDeviceSize RingTail = 0;
+	VkDeviceSize RingUsed = 0;
+
+	std::optional<Batch> Recording;
+	std::deque<Batch> InFlight;
+
+	std::vector<VkCommandBuffer> FreeCommandBuffers;
+	std::vector<VkFence> FreeFences;
+	std::vector<VkSemaphore> FreeSemaphores;
+
+	std::mutex Lock;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	void Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+		const VkAllocationCallbacks* allocator, uint32_t graphicsFamily, std::optional<uint32_t> transferFamily);
+	void Destroy();
+
+	bool IsDedicated() const;
+
+	void UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+	// data holds every mip level back to back, each tightly packed.
+	void UploadImage(VkImage dst, VkExtent2D extent, uint32_t mipLevels,
+		uint32_t texelSize, const void* data);
+
+	void Flush();
+
+	// Adds the acquire half of every newly submitted batch to barriers,
+	// which the caller flushes before the first consumer.
+	void AcquireUploads(uint64_t frameNumber, BarrierBatch& barriers,
+		std::vector<VkSemaphore>& waitSemaphores,
+		std::vector<VkPipelineStageFlags>& waitStages);
+	void CollectFinished(uint64_t completedFrame);
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	Batch& BeginBatch();
+	void SubmitBatch();
+	VkDeviceSize AllocateStaging(VkDeviceSize size, VkDeviceSize alignment);
+	bool TryAllocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+	void RetireOldest();
+	void ReleaseFinishedStaging();
+};
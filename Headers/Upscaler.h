@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "PipelineTarget.h"
+#include "Shader.h"
+#include "Utils.h"
+
+// Stretches the part of an image the scene was rendered into over the
+// whole target with a bilinear fullscreen triangle.
+//
+// The source is a full-size image of which only the top-left area was
+// drawn this frame, so sampling is clamped half a texel inside that area
+// to keep filtering from reaching the stale pixels beyond it.
+class Upscaler {
+// ------------------------
+// Private members
+// ------------------------
+private:
+	struct UpscaleStep {
+		float UvScale[2];
+		float UvMax[2];
+	};
+
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+
+	Shader UpscaleShader;
+	VkSampler Sampler = VK_NULL_HANDLE;
+	VkDescriptorSetLayout SetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+	VkPipelineLayout Layout = VK_NULL_HANDLE;
+	VkPipeline Pipeline = VK_NULL_HANDLE;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	void Init(const VkDevice& device, const VkAllocationCallbacks* allocator, const PipelineTarget& target);
+	void Destroy();
+
+	// The source must be in SHADER_READ_ONLY_OPTIMAL when drawn. Updates
+	// the descriptor in place, so no frame using it may be in flight.
+	void SetSource(VkImageView view);
+	// Must be recorded inside the target's render pass or rendering scope.
+	void Draw(VkCommandBuffer commandBuffer, VkExtent2D sourceArea, VkExtent2D sourceExtent);
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void CreateDescriptors();
+	void CreatePipeline(const PipelineTarget& target);
+};
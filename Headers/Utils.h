@@ -22,6 +22,8 @@
 #include <vulkan/vulkan.h>
 
 #include <fstream>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace utils {
@@ -49,4 +51,103 @@ namespace utils {
 
 		return buffer;
 	}
+
+	inline uint32_t FindMemoryType(const VkPhysicalDevice& physicalDevice,
+		uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i) {
+			if ((typeFilter & (1 << i)) &&
+				(memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+
+		throw std::runtime_error("Failed to find suitable memory type!");
+	}
+
+	inline void CreateBuffer(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+		VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+		VkBuffer& buffer, VkDeviceMemory& memory, const VkAllocationCallbacks* allocator) {
+		VkBufferCreateInfo bufferInfo{ };
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (FunctionFailed(vkCreateBuffer(device, &bufferInfo, allocator, &buffer))) {
+			throw std::runtime_error("Failed to create buffer!");
+		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+		VkMemoryAllocateInfo allocInfo{ };
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memRequirements.size;
+		allocInfo.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+
+		if (FunctionFailed(vkAllocateMemory(device, &allocInfo, allocator, &memory))) {
+			throw std::runtime_error("Failed to allocate buffer memory!");
+		}
+
+		vkBindBufferMemory(device, buffer, memory, 0);
+	}
+
+	inline void CreateImage(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+		VkExtent2D extent, uint32_t mipLevels, VkFormat format, VkImageUsageFlags usage,
+		VkImage& image, VkDeviceMemory& memory, const VkAllocationCallbacks* allocator) {
+		VkImageCreateInfo imageInfo{ };
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { extent.width, extent.height, 1 };
+		imageInfo.mipLevels = mipLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = usage;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (FunctionFailed(vkCreateImage(device, &imageInfo, allocator, &image))) {
+			throw std::runtime_error("Failed to create image!");
+		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+		VkMemoryAllocateInfo allocInfo{ };
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memRequirements.size;
+		allocInfo.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		if (FunctionFailed(vkAllocateMemory(device, &allocInfo, allocator, &memory))) {
+			throw std::runtime_error("Failed to allocate image memory!");
+		}
+
+		vkBindImageMemory(device, image, memory, 0);
+	}
+
+	inline VkImageView CreateImageView(const VkDevice& device, VkImage image, VkFormat format,
+		VkImageAspectFlags aspect, uint32_t mipLevels, const VkAllocationCallbacks* allocator) {
+		VkImageViewCreateInfo viewInfo{ };
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.subresourceRange.aspectMask = aspect;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = mipLevels;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		VkImageView view;
+		if (FunctionFailed(vkCreateImageView(device, &viewInfo, allocator, &view))) {
+			throw std::runtime_error("Failed to create image view!");
+		}
+		return view;
+	}
 }
\ No newline at end of file
@@ -27,17 +27,38 @@
 #include <SDL2/SDL_vulkan.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <limits>
 #include <optional>
 #include <set>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
+#include "BarrierBatch.h"
+#include "DynamicResolution.h"
+#include "FrameCapture.h"
+#include "HostAllocator.h"
+#include "LevelPackage.h"
+#include "Log.h"
+#include "MathLib.h"
+#include "Metrics.h"
+#include "ParticleSystem.h"
+#include "PipelineTarget.h"
+#include "RenderGraph.h"
 #include "Shader.h"
+#include "Simulation.h"
+#include "SoundSystem.h"
+#include "StatsOverlay.h"
+#include "TextureDescriptors.h"
+#include "UploadQueue.h"
+#include "Upscaler.h"
 #include "Utils.h"
+#include "WorldRenderer.h"
 
 struct QueueFamilyIndicies;
 struct SwapChainSupportDetails;
@@ -49,7 +70,44 @@ class VulkanQuakeApp {
 public:
 	const uint32_t WIDTH = 1280;
 	const uint32_t HEIGHT = 720;
-	
+
+	static const int MAX_FRAMES_IN_FLIGHT = 2;
+	// Quake's entity numbers for the world and, in single player, the
+	// local player; sounds are keyed on them.
+	static const int32_t WORLD_ENTITY = 0;
+	static const int32_t PLAYER_ENTITY = 1;
+
+	// Stay on the Vulkan 1.0 render pass and fence path even when the
+	// device supports dynamic rendering, synchronization2 and timeline
+	// semaphores.
+	bool ForceLegacyPath = false;
+	// Samples per pixel for the main pass, lowered to what the device
+	// supports. 1 turns MSAA off.
+	uint32_t MsaaSamples = 4;
+	// Render world depth in its own pass first so the main pass shades
+	// each pixel once.
+	bool DepthPrepass = false;
+	// GPU frame time in milliseconds that dynamic resolution aims for. 0
+	// always renders the scene at the swapchain's size.
+	float DynamicResolutionMs = 0.0f;
+	// Cooked level (.vqp) to draw, from QuakeCook. Empty draws no world.
+	std::string LevelPath;
+	// Saves every frame to this directory from the start, for image
+	// comparisons. Empty leaves capture to F12 screenshots.
+	std::string CaptureDirectory;
+	// Quits once this many frames of the sequence are written. 0 captures
+	// until the window closes.
+	uint64_t CaptureFrames = 0;
+	// A .wav looped at the spawn point, to hear sounds placed around the
+	// view. Empty plays nothing.
+	std::string SoundPath;
+	// Appends frame metrics to this file as JSON lines every
+	// MetricsIntervalMs. Empty exports nothing.
+	std::string MetricsPath;
+	uint32_t MetricsIntervalMs = 1000;
+	// Draws the metrics over the top-left of the frame.
+	bool ShowStats = false;
+
 #ifdef NDEBUG
 	const bool EnableValidationLayers = false;
 #else
@@ -60,12 +118,32 @@ public:
 // Private members
 // ------------------------
 private:
+	// Declared first so it outlives every Vulkan object.
+	HostAllocator HostAllocations;
+	const VkAllocationCallbacks* Allocator = HostAllocations.GetCallbacks();
 	SDL_Window* Window;
 	VkInstance Instance;
 	VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+	uint32_t InstanceApiVersion = VK_API_VERSION_1_0;
+	uint32_t DeviceApiVersion = VK_API_VERSION_1_0;
 	VkPhysicalDeviceFeatures DeviceFeatures{ };
+	VkPhysicalDeviceVulkan12Features DeviceFeatures12{ };
+	VkPhysicalDeviceVulkan13Features DeviceFeatures13{ };
+	// Only used on Vulkan 1.1 devices exposing VK_EXT_descriptor_indexing.
+	VkPhysicalDeviceDescriptorIndexingFeatures DeviceIndexingFeatures{ };
+	// Dynamic rendering, synchronization2 and a timeline semaphore in place
+	// of the render pass, framebuffers and per-frame fences.
+	bool ModernPath = false;
+	bool DescriptorIndexing = false;
+	// GPU culling into indirect draws, compacted with drawIndirectCount.
+	bool IndirectWorld = false;
+	bool IndirectCountWorld = false;
+	VkFormat DepthFormat = VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits SampleCount = VK_SAMPLE_COUNT_1_BIT;
+	bool PipelineStatistics = false;
 	VkDevice Device;
 	VkQueue GraphicsQueue, PresentQueue;
+	UploadQueue Uploads;
 	VkSurfaceKHR Surface;
 	VkSwapchainKHR Swapchain;
 	std::vector<VkImage> SwapchainImages;
@@ -73,9 +151,73 @@ private:
 	VkExtent2D SwapchainExtent;
 	std::vector<VkImageView> SwapchainImageViews;
 	Shader CurrentShader;
-	VkRenderPass RenderPass;
+	RenderGraph Graph;
+	RenderResource Backbuffer = 0;
+	// Multisampled colour resolved into the backbuffer; unused without MSAA.
+	RenderResource SceneColor = 0;
+	RenderResource SceneDepth = 0;
+	uint32_t DepthPass = 0;
+	uint32_t MainPass = 0;
+	// Dynamic resolution only: the full-size image the scene is drawn into
+	// the top-left of, and the pass that stretches it over the backbuffer.
+	RenderResource SceneTarget = 0;
+	uint32_t UpscalePass = 0;
+	DynamicResolution Resolution;
+	Upscaler Upscale;
+	// Size the scene is drawn at this frame.
+	VkExtent2D RenderExtent{ };
+	// Only when the swapchain images can be copied from.
+	uint32_t CapturePass = 0;
+	bool SwapchainCapture = false;
+	FrameCapture Capture;
+	// Drawn in the upscale pass with dynamic resolution, so it stays at
+	// native resolution, and at the end of the main pass otherwise.
+	StatsOverlay Overlay;
 	VkPipelineLayout PipelineLayout;
 	VkPipeline GraphicsPipeline;
+	TextureDescriptors Textures;
+	std::vector<VkImage> TextureImages;
+	std::vector<VkDeviceMemory> TextureMemory;
+	std::vector<VkImageView> TextureViews;
+	uint32_t MissingTexture = 0;
+	uint32_t FullbrightLightmap = 0;
+	VkCommandPool CommandPool;
+	std::vector<VkCommandBuffer> CommandBuffers;
+	std::vector<VkSemaphore> ImageAvailableSemaphores;
+	std::vector<VkSemaphore> RenderFinishedSemaphores;
+	std::vector<VkFence> InFlightFences;
+	// Frame N signals N + 1 on the modern path.
+	VkSemaphore FrameTimeline = VK_NULL_HANDLE;
+	BarrierBatch FrameBarriers;
+	uint32_t CurrentFrame = 0;
+	uint64_t FrameNumber = 0;
+	WorldRenderer World;
+	ParticleSystem Particles;
+	Mat4 ViewProjection = Mat4::Identity();
+	Simulation Sim;
+	SoundSystem Sound;
+	// Client-side view angles, sent to the simulation with each command.
+	vec3_t ViewAngles = { 0.0f, 0.0f, 0.0f };
+	std::chrono::steady_clock::time_point StartTime;
+	std::chrono::steady_clock::time_point LastFrameTime;
+	float Time = 0.0f;
+	float FrameTime = 0.0f;
+	// CPU time from command buffer reset to the return of the submit.
+	uint64_t SubmitSamples = 0;
+	std::chrono::nanoseconds SubmitTotal{ 0 };
+	std::chrono::nanoseconds SubmitMax{ 0 };
+	// Fragment shader invocations in the main pass, one query per frame in
+	// flight, read back once the slot's frame has retired.
+	VkQueryPool StatisticsQueries = VK_NULL_HANDLE;
+	bool StatisticsPending[MAX_FRAMES_IN_FLIGHT] = { };
+	uint64_t StatisticsPixels[MAX_FRAMES_IN_FLIGHT] = { };
+	// The frame time of the frame each query measured.
+	float StatisticsFrameTime[MAX_FRAMES_IN_FLIGHT] = { };
+	uint64_t FragmentSamples = 0;
+	uint64_t FragmentTotal = 0;
+	uint64_t FragmentPixels = 0;
+	double FragmentPeak = 0.0;
+	double FragmentSeconds = 0.0;
 
 	// --------------------
 	// DATA
@@ -111,16 +253,49 @@ private:
 	void InitVulkan();
 	void CreateInstance();
 	void PickPhysicalDevice();
+	void SelectRenderPath();
+	void SelectDescriptorModel();
+	void SelectWorldPath();
+	void SelectAttachmentFormats();
 	void CreateLogicialDevice();
 	void CreateSurface();
 	void CreateSwapchain();
 	void CreateImageViews();
-	void CreateRenderPass();
+	void CreateRenderGraph();
+	void CreateTextureDescriptors();
 	void CreateGraphicsPipeline();
+	void CreateCommandPool();
+	void CreateCommandBuffers();
+	void CreateSyncObjects();
+	void CreateQueryPool();
+	void CreateUploadQueue();
+	void CreateDefaultTextures();
+	uint32_t CreateTexture(VkExtent2D extent, uint32_t mipLevels, VkFormat format, const void* pixels, VkFilter filter);
+	void CreateWorldRenderer();
+	void LoadLevel();
+	void CreateParticleSystem();
+	void CreateDynamicResolution();
+	void CreateFrameCapture();
+	void CreateStatsOverlay();
 	// Game Loop
 	void MainLoop();
+	void SendUserCommand();
+	void UpdateView();
+	void DrawFrame();
+	void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	void RecordDepthPrepass(VkCommandBuffer commandBuffer);
+	void RecordMainPass(VkCommandBuffer commandBuffer);
+	void RecordUpscalePass(VkCommandBuffer commandBuffer);
+	void RecordCapturePass(VkCommandBuffer commandBuffer);
+	void SetViewportAndScissor(VkCommandBuffer commandBuffer, VkExtent2D extent);
+	void CollectFrameStatistics();
+	void SubmitFrame(VkCommandBuffer commandBuffer,
+		const std::vector<VkSemaphore>& waitSemaphores,
+		const std::vector<VkPipelineStageFlags>& waitStages);
 	// Cleanup
 	void Cleanup();
+	void ReportSubmitTiming() const;
+	void ReportFillStatistics() const;
 
 	// ---------------
 	// Util methods
@@ -131,10 +306,12 @@ private:
 	bool IsDeviceSuitable(const VkPhysicalDevice& device) const;
 	QueueFamilyIndicies FindQueueFamilies(const VkPhysicalDevice& device) const;
 	bool CheckDeviceExtensionSupport(const VkPhysicalDevice& device) const;
+	bool HasDeviceExtension(const VkPhysicalDevice& device, const char* name) const;
 
 	SwapChainSupportDetails QuerySwapChainSupport(const VkPhysicalDevice& device) const;
 
 	std::vector<const char*> GetRequiredExtensions() const;
+	PipelineTarget GetPipelineTarget() const;
 
 	VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) const;
 	VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const;
@@ -162,7 +339,17 @@ private:
 		const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
 		void* pUserData) {
 
-		std::cerr << "Validation Layer: " << pCallbackData->pMessage << std::endl;
+		LogSeverity severity = LogSeverity::Verbose;
+		if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+			severity = LogSeverity::Error;
+		}
+		else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+			severity = LogSeverity::Warning;
+		}
+		else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) {
+			severity = LogSeverity::Info;
+		}
+		Log::Writef(severity, pCallbackData->messageIdNumber, "Validation Layer: %s", pCallbackData->pMessage);
 
 		return VK_FALSE;
 	}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads for data-parallel loops.
+//
+// ParallelFor() hands out ranges from a shared atomic cursor, so fast
+// threads take more work and no range is queued per thread. The calling
+// thread works on the loop as well, and the call returns only once every
+// range has finished. With no worker threads the loop runs inline. Only one
+// thread at a time may call ParallelFor().
+class WorkerPool {
+// ------------------------
+// Private members
+// ------------------------
+private:
+	struct Job {
+		const std::function<void(uint32_t, uint32_t)>* Body;
+		uint32_t Count;
+		uint32_t Grain;
+		std::atomic<uint32_t> Next{ 0 };
+		// Workers that have joined this job and not yet left it.
+		uint32_t Workers = 0;
+	};
+
+	std::vector<std::thread> Threads;
+	std::mutex Mutex;
+	std::condition_variable WorkReady;
+	std::condition_variable WorkDone;
+	Job* CurrentJob = nullptr;
+	uint64_t Generation = 0;
+	bool Running = false;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	~WorkerPool();
+
+	// A threadCount of 0 starts one thread per hardware thread, less one for
+	// the caller.
+	void Start(uint32_t threadCount = 0);
+	void Stop();
+	// Threads working on a loop, including the caller.
+	uint32_t GetThreadCount() const;
+
+	// Calls body(begin, end) over [0, count) in ranges of at most grain.
+	void ParallelFor(uint32_t count, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& body);
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void Run();
+	static void RunRanges(Job& job);
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// Level geometry as the world renderer consumes it. Kept free of Vulkan so
+// the level cooker can build it offline.
+struct WorldVertex {
+	float Position[3];
+	float TexCoord[2];
+	float LightmapCoord[2];
+};
+
+// GPU layout of a drawable surface (or cluster of surfaces sharing a
+// material), matching the std430 struct in cull.comp and world.vert.
+struct WorldSurface {
+	float Mins[3];
+	uint32_t FirstIndex;
+	float Maxs[3];
+	uint32_t IndexCount;
+	int32_t VertexOffset;
+	uint32_t Texture;
+	uint32_t Lightmap;
+	uint32_t Padding;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "BarrierBatch.h"
+#include "MathLib.h"
+#include "PipelineTarget.h"
+#include "Shader.h"
+#include "TextureDescriptors.h"
+#include "UploadQueue.h"
+#include "Utils.h"
+#include "WorldGeometry.h"
+
+// Draws the level's static geometry.
+//
+// On the GPU-driven path, surface bounds live in a storage buffer and a
+// compute pass frustum-culls them every frame, writing one
+// VkDrawIndexedIndirectCommand per surface. With drawIndirectCount the
+// visible commands are compacted and drawn with
+// vkCmdDrawIndexedIndirectCount; otherwise culled commands keep an
+// instanceCount of zero and every slot is submitted with
+// vkCmdDrawIndexedIndirect. Either way the CPU records the same handful of
+// commands however many surfaces are visible. Each command's firstInstance
+// is its surface index, which the vertex shader uses to fetch the
+// material, so this path needs bindless textures.
+//
+// Otherwise surfaces are culled on the CPU and drawn one by one with
+// per-draw material push constants.
+//
+// With a depth prepass, DrawDepth() lays down the world's depth first with
+// a vertex-only pipeline, and Draw() then tests EQUAL without writing, so
+// each pixel runs the textured fragment shader once however much geometry
+// overlaps it. Both use the same visible set, and world.vert's position is
+// invariant so the two passes produce identical depths.
+class WorldRenderer {
+// ------------------------
+// Private members
+// ------------------------
+private:
+	struct CullStep {
+		float Planes[6][4];
+		uint32_t SurfaceCount;
+		uint32_t Compact;
+	};
+
+	struct DrawStep {
+		Mat4 ViewProj;
+		MaterialIndices Material;
+	};
+
+	VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	uint32_t FramesInFlight = 0;
+	bool Indirect = false;
+	bool IndirectCount = false;
+	bool DepthPrepass = false;
+	uint32_t MaxDrawIndirectCount = 1;
+
+	Shader CullShader;
+	Shader DrawShader;
+	VkDescriptorSetLayout CullSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout CullLayout = VK_NULL_HANDLE;
+	VkPipeline CullPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout DrawLayout = VK_NULL_HANDLE;
+	// Per-draw push constant materials, and materials fetched per surface.
+	VkPipeline DrawPipeline = VK_NULL_HANDLE;
+	VkPipeline IndirectPipeline = VK_NULL_HANDLE;
+	// Prepass only. Vertex stage only, used for both draw paths.
+	VkPipeline DepthPipeline = VK_NULL_HANDLE;
+
+	VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> DescriptorSets;
+
+	VkBuffer VertexBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory VertexMemory = VK_NULL_HANDLE;
+	VkBuffer IndexBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory IndexMemory = VK_NULL_HANDLE;
+	VkBuffer SurfaceBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory SurfaceMemory = VK_NULL_HANDLE;
+	// One set of draw commands and count per frame in flight.
+	std::vector<VkBuffer> DrawBuffers;
+	std::vector<VkDeviceMemory> DrawMemory;
+	std::vector<VkBuffer> CountBuffers;
+	std::vector<VkDeviceMemory> CountMemory;
+
+	// Kept for the CPU path.
+	std::vector<WorldSurface> Surfaces;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	// prepassTarget enables the depth prepass; leave it empty to draw with
+	// an ordinary depth test and write.
+	void Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+		const VkAllocationCallbacks* allocator,
+		const TextureDescriptors& textures, const PipelineTarget& target,
+		const std::optional<PipelineTarget>& prepassTarget,
+		uint32_t framesInFlight, bool indirect, bool indirectCount);
+	void Destroy();
+
+	bool IsGpuDriven() const;
+
+	// Replaces the level geometry. Waits for the device to go idle, so it
+	// is only meant for level loads. Vertices and indices are copied
+	// straight into staging, so they can come from a mapped package.
+	void SetWorldGeometry(UploadQueue& uploads,
+		const WorldVertex* vertices, size_t vertexCount,
+		const uint32_t* indices, size_t indexCount,
+		const std::vector<WorldSurface>& surfaces);
+
+	// Records the culling dispatch. Must be outside any render pass.
+	void Cull(VkCommandBuffer commandBuffer, uint32_t frame, const Mat4& viewProj,
+		BarrierBatch& barriers, bool synchronization2);
+	// Must be recorded inside the prepass's render pass or rendering scope,
+	// before Draw() and with the same viewProj.
+	void DrawDepth(VkCommandBuffer commandBuffer, uint32_t frame, const Mat4& viewProj);
+	// Must be recorded inside the main render pass or rendering scope.
+	void Draw(VkCommandBuffer commandBuffer, uint32_t frame, const Mat4& viewProj,
+		TextureDescriptors& textures);
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void CreateDescriptors();
+	void CreateCullPipeline();
+	void CreateGraphicsPipelines(const TextureDescriptors& textures, const PipelineTarget& target,
+		const std::optional<PipelineTarget>& prepassTarget);
+	void DrawIndirect(VkCommandBuffer commandBuffer, uint32_t frame);
+	void WriteDescriptors();
+	void DestroyGeometry();
+};
@@ -0,0 +1,48 @@
+#version 450
+
+// The text grid, four characters to a uint, first character in the low
+// byte. Characters are ASCII 32..95.
+layout(std430, set = 0, binding = 0) readonly buffer OverlayText {
+	uint cells[];
+} text;
+
+// Matches StatsOverlay::OverlayStep.
+layout(push_constant) uniform OverlayStep {
+	ivec2 origin;
+	uint columns;
+	uint scale;
+} step;
+
+layout(location = 0) out vec4 outColor;
+
+// 3x5 pixel glyphs, rows top to bottom, the left pixel in the high bit.
+const uint GLYPHS[64] = uint[](
+	0x0000, 0x2482, 0x5a00, 0x5f7d, 0x3c9e, 0x52a5, 0x2aab, 0x2400,
+	0x1491, 0x4494, 0x0aa8, 0x05d0, 0x0014, 0x01c0, 0x0002, 0x12a4,
+	0x7b6f, 0x2c97, 0x73e7, 0x72cf, 0x5bc9, 0x79cf, 0x79ef, 0x7252,
+	0x7bef, 0x7bcf, 0x0410, 0x0414, 0x1511, 0x0e38, 0x4454, 0x72c2,
+	0x7be7, 0x2bed, 0x6bae, 0x3923, 0x6b6e, 0x79a7, 0x79a4, 0x396b,
+	0x5bed, 0x7497, 0x126a, 0x5bad, 0x4927, 0x5fed, 0x6b6d, 0x2b6a,
+	0x6ba4, 0x2b73, 0x6bad, 0x388e, 0x7492, 0x5b6f, 0x5b6a, 0x5bfd,
+	0x5aad, 0x5a92, 0x72a7, 0x3493, 0x4889, 0x6496, 0x2a00, 0x0007
+);
+
+// Each cell is the glyph plus a pixel of spacing right and below.
+const uvec2 CELL = uvec2(4, 6);
+
+void main() {
+	// The scissor keeps fragments inside the grid.
+	uvec2 pixel = uvec2(ivec2(gl_FragCoord.xy) - step.origin) / step.scale;
+	uvec2 cell = pixel / CELL;
+	uvec2 inCell = pixel % CELL;
+
+	uint index = cell.y * step.columns + cell.x;
+	uint character = (text.cells[index >> 2] >> ((index & 3u) * 8u)) & 0xffu;
+	uint glyph = GLYPHS[(character - 32u) & 63u];
+
+	bool lit = false;
+	if (inCell.x < 3u && inCell.y < 5u) {
+		lit = ((glyph >> (14u - inCell.y * 3u - inCell.x)) & 1u) != 0u;
+	}
+	outColor = lit ? vec4(1.0, 1.0, 0.6, 1.0) : vec4(0.0, 0.0, 0.0, 0.6);
+}
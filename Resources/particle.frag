@@ -0,0 +1,13 @@
+#version 450
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	if (dot(fragCoord, fragCoord) > 1.0) {
+		discard;
+	}
+	outColor = fragColor;
+}
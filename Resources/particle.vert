@@ -0,0 +1,34 @@
+#version 450
+
+layout(location = 0) in vec4 inOriginDie;
+layout(location = 1) in vec4 inColor;
+
+layout(push_constant) uniform Draw {
+	mat4 viewProj;
+	float time;
+	float size;
+} draw;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragCoord;
+
+vec2 corners[6] = vec2[](
+	vec2(-1.0, -1.0), vec2( 1.0, -1.0), vec2( 1.0,  1.0),
+	vec2(-1.0, -1.0), vec2( 1.0,  1.0), vec2(-1.0,  1.0)
+);
+
+void main() {
+	if (inOriginDie.w <= draw.time) {
+		// Dead particle: place it outside the clip volume.
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+		fragColor = vec4(0.0);
+		fragCoord = vec2(0.0);
+		return;
+	}
+
+	vec2 corner = corners[gl_VertexIndex];
+	vec4 center = draw.viewProj * vec4(inOriginDie.xyz, 1.0);
+	gl_Position = center + vec4(corner * draw.size, 0.0, 0.0);
+	fragColor = inColor;
+	fragCoord = corner;
+}
@@ -0,0 +1,17 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform sampler2D scene;
+
+// Matches Upscaler::UpscaleStep.
+layout(push_constant) uniform UpscaleStep {
+	vec2 uvScale;
+	vec2 uvMax;
+} step;
+
+layout(location = 0) in vec2 fragUv;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	outColor = texture(scene, min(fragUv * step.uvScale, step.uvMax));
+}
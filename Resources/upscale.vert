@@ -0,0 +1,9 @@
+#version 450
+
+layout(location = 0) out vec2 fragUv;
+
+// One triangle covering the screen, with uv 0..1 across the visible part.
+void main() {
+	fragUv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+	gl_Position = vec4(fragUv * 2.0 - 1.0, 0.0, 1.0);
+}
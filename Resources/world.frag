@@ -0,0 +1,31 @@
+#version 450
+
+// Compiled twice: with -DBINDLESS every texture and lightmap comes from one
+// descriptor array indexed by the material world.vert passes down; without
+// it the material's set holds just its texture and lightmap.
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+#else
+layout(set = 0, binding = 0) uniform sampler2D textures[2];
+#endif
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) in vec2 fragLightmapCoord;
+// x: texture index, y: lightmap index.
+layout(location = 2) flat in uvec2 fragMaterial;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+#ifdef BINDLESS
+	vec4 albedo = texture(textures[nonuniformEXT(fragMaterial.x)], fragTexCoord);
+	float light = texture(textures[nonuniformEXT(fragMaterial.y)], fragLightmapCoord).r;
+#else
+	vec4 albedo = texture(textures[0], fragTexCoord);
+	float light = texture(textures[1], fragLightmapCoord).r;
+#endif
+	// Quake lightmaps are overbright by a factor of two.
+	outColor = vec4(albedo.rgb * light * 2.0, 1.0);
+}
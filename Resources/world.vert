@@ -0,0 +1,51 @@
+#version 450
+
+// True for indirect draws, whose firstInstance is the surface index; false
+// when the CPU pushes each draw's material.
+layout(constant_id = 0) const bool SURFACE_MATERIALS = false;
+
+// Matches WorldSurface.
+struct Surface {
+	vec3 mins;
+	uint firstIndex;
+	vec3 maxs;
+	uint indexCount;
+	int vertexOffset;
+	uint textureIndex;
+	uint lightmapIndex;
+	uint padding;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Surfaces {
+	Surface surfaces[];
+};
+
+layout(push_constant) uniform DrawStep {
+	mat4 viewProj;
+	uvec2 material;
+} step;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in vec2 inLightmapCoord;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec2 fragLightmapCoord;
+layout(location = 2) flat out uvec2 fragMaterial;
+
+// The depth prepass and the EQUAL-tested colour pass must agree exactly.
+invariant gl_Position;
+
+void main() {
+	gl_Position = step.viewProj * vec4(inPosition, 1.0);
+	fragTexCoord = inTexCoord;
+	fragLightmapCoord = inLightmapCoord;
+
+	if (SURFACE_MATERIALS) {
+		Surface s = surfaces[gl_InstanceIndex];
+		fragMaterial = uvec2(s.textureIndex, s.lightmapIndex);
+	}
+	else {
+		fragMaterial = step.material;
+	}
+}
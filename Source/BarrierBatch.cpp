@@ -0,0 +1,137 @@
+#include "BarrierBatch.h"
+
+// ------------------------
+// Public methods
+// ------------------------
+void BarrierBatch::AddMemory(VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+	VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+	VkMemoryBarrier2 barrier{ };
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = srcStage;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstStageMask = dstStage;
+	barrier.dstAccessMask = dstAccess;
+	MemoryBarriers.push_back(barrier);
+}
+
+void BarrierBatch::AddBuffer(const VkBufferMemoryBarrier2& barrier) {
+	BufferBarriers.push_back(barrier);
+}
+
+void BarrierBatch::AddImage(const VkImageMemoryBarrier2& barrier) {
+	ImageBarriers.push_back(barrier);
+}
+
+void BarrierBatch::AddImage(VkImage image, VkImageAspectFlags aspect,
+	VkImageLayout oldLayout, VkImageLayout newLayout,
+	VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+	VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+	VkImageMemoryBarrier2 barrier{ };
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = srcStage;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstStageMask = dstStage;
+	barrier.dstAccessMask = dstAccess;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = aspect;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+	ImageBarriers.push_back(barrier);
+}
+
+bool BarrierBatch::Empty() const {
+	return MemoryBarriers.empty() && BufferBarriers.empty() && ImageBarriers.empty();
+}
+
+void BarrierBatch::Clear() {
+	MemoryBarriers.clear();
+	BufferBarriers.clear();
+	ImageBarriers.clear();
+}
+
+void BarrierBatch::Flush(VkCommandBuffer commandBuffer, bool synchronization2) {
+	if (Empty()) {
+		return;
+	}
+
+	if (synchronization2) {
+		VkDependencyInfo dependencyInfo{ };
+		dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependencyInfo.memoryBarrierCount = static_cast<uint32_t>(MemoryBarriers.size());
+		dependencyInfo.pMemoryBarriers = MemoryBarriers.data();
+		dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(BufferBarriers.size());
+		dependencyInfo.pBufferMemoryBarriers = BufferBarriers.data();
+		dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(ImageBarriers.size());
+		dependencyInfo.pImageMemoryBarriers = ImageBarriers.data();
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+		Clear();
+		return;
+	}
+
+	VkPipelineStageFlags srcStages = 0;
+	VkPipelineStageFlags dstStages = 0;
+
+	std::vector<VkMemoryBarrier> memoryBarriers;
+	for (const auto& b : MemoryBarriers) {
+		VkMemoryBarrier barrier{ };
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = static_cast<VkAccessFlags>(b.srcAccessMask);
+		barrier.dstAccessMask = static_cast<VkAccessFlags>(b.dstAccessMask);
+		memoryBarriers.push_back(barrier);
+		srcStages |= static_cast<VkPipelineStageFlags>(b.srcStageMask);
+		dstStages |= static_cast<VkPipelineStageFlags>(b.dstStageMask);
+	}
+
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+	for (const auto& b : BufferBarriers) {
+		VkBufferMemoryBarrier barrier{ };
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = static_cast<VkAccessFlags>(b.srcAccessMask);
+		barrier.dstAccessMask = static_cast<VkAccessFlags>(b.dstAccessMask);
+		barrier.srcQueueFamilyIndex = b.srcQueueFamilyIndex;
+		barrier.dstQueueFamilyIndex = b.dstQueueFamilyIndex;
+		barrier.buffer = b.buffer;
+		barrier.offset = b.offset;
+		barrier.size = b.size;
+		bufferBarriers.push_back(barrier);
+		srcStages |= static_cast<VkPipelineStageFlags>(b.srcStageMask);
+		dstStages |= static_cast<VkPipelineStageFlags>(b.dstStageMask);
+	}
+
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	for (const auto& b : ImageBarriers) {
+		VkImageMemoryBarrier barrier{ };
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = static_cast<VkAccessFlags>(b.srcAccessMask);
+		barrier.dstAccessMask = static_cast<VkAccessFlags>(b.dstAccessMask);
+		barrier.oldLayout = b.oldLayout;
+		barrier.newLayout = b.newLayout;
+		barrier.srcQueueFamilyIndex = b.srcQueueFamilyIndex;
+		barrier.dstQueueFamilyIndex = b.dstQueueFamilyIndex;
+		barrier.image = b.image;
+		barrier.subresourceRange = b.subresourceRange;
+		imageBarriers.push_back(barrier);
+		srcStages |= static_cast<VkPipelineStageFlags>(b.srcStageMask);
+		dstStages |= static_cast<VkPipelineStageFlags>(b.dstStageMask);
+	}
+
+	// Synchronization 1 does not accept empty stage masks.
+	if (srcStages == 0) {
+		srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	}
+	if (dstStages == 0) {
+		dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	}
+
+	vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0,
+		static_cast<uint32_t>(memoryBarriers.size()), memoryBarriers.data(),
+		static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+		static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	Clear();
+}
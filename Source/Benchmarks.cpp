@@ -0,0 +1,316 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "BspFile.h"
+#include "CollisionWorld.h"
+#include "EntityStore.h"
+#include "Log.h"
+#include "MathLib.h"
+#include "SoundMixer.h"
+#include "WorkerPool.h"
+
+namespace {
+	const uint32_t ITERATIONS = 200;
+	const uint32_t TRACE_ITERATIONS = 10;
+	const uint32_t ANIMATION_FRAMES = 8;
+	// Fraction of entities destroyed and recreated per churn iteration.
+	const uint32_t CHURN_DIVISOR = 10;
+	const float WORLD_EXTENT = 2048.0f;
+	const uint32_t MIXER_RATE = 44100;
+	const uint32_t MIXER_CALLBACK_FRAMES = 512;
+	const uint32_t MIXER_SECONDS = 60;
+	const uint32_t MIXER_SOUNDS = 8;
+
+	// Roughly the shape of Quake's edict_t with a typical progs entvars_t:
+	// the few fields the per-frame passes read sit between long runs of
+	// fields they never touch, so each entity costs several cache lines.
+	struct LegacyEdict {
+		bool Free;
+		void* Area[2];
+		int32_t NumLeafs;
+		int16_t LeafNums[16];
+		float Baseline[11];
+		float FreeTime;
+		float ModelIndex;
+		vec3_t AbsMin;
+		vec3_t AbsMax;
+		float LocalTime[3];
+		vec3_t Origin;
+		vec3_t OldOrigin;
+		vec3_t Velocity;
+		vec3_t Angles;
+		float Cold0[20];
+		float Frame;
+		float Cold1[40];
+		float Flags;
+		float Cold2[30];
+	};
+
+	double Seconds(std::chrono::steady_clock::duration duration) {
+		return std::chrono::duration<double>(duration).count();
+	}
+
+	template <typename Pass>
+	double TimePass(uint32_t iterations, Pass&& pass) {
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < iterations; ++i) {
+			pass();
+		}
+		return Seconds(std::chrono::steady_clock::now() - start) / iterations;
+	}
+
+	void Report(const char* name, double aos, double soa, uint32_t entityCount) {
+		Log::Writef(LogSeverity::Info, 0, "  %-8s edict %8.1f us (%5.2f ns/ent)  store %8.1f us (%5.2f ns/ent)  %.2fx",
+			name, aos * 1e6, aos * 1e9 / entityCount, soa * 1e6, soa * 1e9 / entityCount, soa > 0.0 ? aos / soa : 0.0);
+	}
+}
+
+void benchmarks::RunEntityBenchmark(uint32_t entityCount) {
+	std::mt19937 random(1996);
+	std::uniform_real_distribution<float> position(-WORLD_EXTENT, WORLD_EXTENT);
+	std::uniform_real_distribution<float> yaw(0.0f, 360.0f);
+	std::uniform_int_distribution<uint32_t> model(0, 3);
+
+	std::vector<LegacyEdict> edicts(entityCount);
+	EntityStore store;
+	store.Reserve(entityCount);
+	for (uint32_t i = 0; i < entityCount; ++i) {
+		vec3_t origin = { position(random), position(random), position(random) * 0.25f };
+		float angle = yaw(random);
+		uint32_t modelIndex = model(random);
+
+		LegacyEdict& edict = edicts[i];
+		edict = LegacyEdict{ };
+		VectorCopy(origin, edict.Origin);
+		edict.Angles[YAW] = angle;
+		edict.ModelIndex = static_cast<float>(modelIndex);
+
+		uint32_t index = store.IndexOf(store.Create());
+		VectorCopy(origin, store.Origin(index));
+		store.Angle(index)[YAW] = angle;
+		store.Model(index) = modelIndex;
+	}
+
+	// Player-sized boxes, as SV_LinkEdict would set from mins/maxs.
+	const vec3_t mins = { -16.0f, -16.0f, -24.0f };
+	const vec3_t maxs = { 16.0f, 16.0f, 32.0f };
+
+	const vec3_t viewOrigin = { 0.0f, 0.0f, 0.0f };
+	const vec3_t viewAngles = { 0.0f, 45.0f, 0.0f };
+	Mat4 viewProj = Mat4Multiply(PerspectiveMatrix(90.0f, 16.0f / 9.0f, 4.0f, 4096.0f), ViewMatrix(viewOrigin, viewAngles));
+	float planes[6][4];
+	ExtractFrustumPlanes(viewProj, planes);
+
+	// Keeps the optimiser from discarding the passes.
+	volatile uint64_t sink = 0;
+
+	double linkAos = TimePass(ITERATIONS, [&]() {
+		for (LegacyEdict& edict : edicts) {
+			for (int c = 0; c < 3; ++c) {
+				edict.AbsMin[c] = edict.Origin[c] + mins[c];
+				edict.AbsMax[c] = edict.Origin[c] + maxs[c];
+			}
+		}
+	});
+	double linkSoa = TimePass(ITERATIONS, [&]() {
+		const uint32_t count = store.Count();
+		for (uint32_t i = 0; i < count; ++i) {
+			store.Link(i, mins, maxs);
+		}
+	});
+
+	std::vector<uint32_t> visible;
+	visible.reserve(entityCount);
+	double cullAos = TimePass(ITERATIONS, [&]() {
+		visible.clear();
+		for (uint32_t i = 0; i < entityCount; ++i) {
+			if (!BoxOutsideFrustum(planes, edicts[i].AbsMin, edicts[i].AbsMax)) {
+				visible.push_back(i);
+			}
+		}
+		sink = sink + visible.size();
+	});
+	double cullSoa = TimePass(ITERATIONS, [&]() {
+		visible.clear();
+		store.CullBoxes(planes, visible);
+		sink = sink + visible.size();
+	});
+
+	double animateAos = TimePass(ITERATIONS, [&]() {
+		for (LegacyEdict& edict : edicts) {
+			if (edict.ModelIndex != 0.0f) {
+				edict.Frame = edict.Frame + 1.0f >= ANIMATION_FRAMES ? 0.0f : edict.Frame + 1.0f;
+			}
+		}
+	});
+	double animateSoa = TimePass(ITERATIONS, [&]() {
+		const uint32_t count = store.Count();
+		for (uint32_t i = 0; i < count; ++i) {
+			if (store.Model(i) != 0) {
+				uint32_t& frame = store.Frame(i);
+				frame = frame + 1 >= ANIMATION_FRAMES ? 0 : frame + 1;
+			}
+		}
+	});
+
+	// Destroys a random tenth of the store and refills it, resolving every
+	// victim through a handle as game code would.
+	std::vector<EntityHandle> victims;
+	double churn = TimePass(ITERATIONS, [&]() {
+		victims.clear();
+		for (uint32_t i = 0; i < entityCount / CHURN_DIVISOR; ++i) {
+			victims.push_back(store.HandleAt(random() % store.Count()));
+		}
+		uint32_t destroyed = 0;
+		for (const EntityHandle& handle : victims) {
+			destroyed += store.Destroy(handle) ? 1 : 0;
+		}
+		for (uint32_t i = 0; i < destroyed; ++i) {
+			uint32_t index = store.IndexOf(store.Create());
+			store.Origin(index)[0] = position(random);
+			store.Model(index) = 1;
+		}
+	});
+
+	Log::Writef(LogSeverity::Info, 0, "Entity benchmark: %u entities, %u iterations, %zu-byte edicts", entityCount, ITERATIONS,
+		sizeof(LegacyEdict));
+	Report("link", linkAos, linkSoa, entityCount);
+	Report("cull", cullAos, cullSoa, entityCount);
+	Report("animate", animateAos, animateSoa, entityCount);
+	Log::Writef(LogSeverity::Info, 0, "  churn    %u destroy/create per iteration: %.1f us (%llu visible checksum)",
+		entityCount / CHURN_DIVISOR, churn * 1e6, static_cast<unsigned long long>(sink));
+}
+
+void benchmarks::RunTraceBenchmark(const std::string& filename, uint32_t traceCount) {
+	BspFile bsp;
+	bsp.Load(filename);
+	CollisionWorld world;
+	world.Build(bsp);
+
+	// Segments of up to 1024 units starting anywhere inside the world bounds,
+	// spread over all three hulls.
+	const BspModel& worldModel = bsp.Models[0];
+	std::mt19937 random(1996);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::uniform_real_distribution<float> offset(-1024.0f, 1024.0f);
+	std::vector<TraceRequest> requests(traceCount);
+	for (uint32_t i = 0; i < traceCount; ++i) {
+		TraceRequest& request = requests[i];
+		for (int c = 0; c < 3; ++c) {
+			request.Start[c] = worldModel.Mins[c] + unit(random) * (worldModel.Maxs[c] - worldModel.Mins[c]);
+			request.End[c] = request.Start[c] + offset(random);
+		}
+		request.Hull = i % CollisionWorld::HULL_COUNT;
+		request.Model = 0;
+	}
+
+	std::vector<TraceResult> serial(traceCount);
+	double serialTime = TimePass(TRACE_ITERATIONS, [&]() {
+		for (uint32_t i = 0; i < traceCount; ++i) {
+			world.Trace(requests[i], serial[i]);
+		}
+	});
+
+	WorkerPool pool;
+	pool.Start();
+	std::vector<TraceResult> batched(traceCount);
+	double batchTime = TimePass(TRACE_ITERATIONS, [&]() {
+		world.TraceBatch(pool, requests.data(), batched.data(), traceCount);
+	});
+	uint32_t threads = pool.GetThreadCount();
+	pool.Stop();
+
+	uint32_t hits = 0;
+	uint32_t mismatches = 0;
+	for (uint32_t i = 0; i < traceCount; ++i) {
+		hits += serial[i].Fraction < 1.0f ? 1 : 0;
+		mismatches += std::memcmp(&serial[i], &batched[i], sizeof(TraceResult)) != 0 ? 1 : 0;
+	}
+
+	Log::Writef(LogSeverity::Info, 0, "Trace benchmark: %s, %u nodes in %zu bytes of clipnodes, %u traces, %u hit",
+		filename.c_str(), static_cast<uint32_t>(bsp.Nodes.size() + bsp.ClipNodes.size()),
+		bsp.Nodes.size() * sizeof(BspNode) + bsp.ClipNodes.size() * sizeof(BspClipNode), traceCount, hits);
+	Log::Writef(LogSeverity::Info, 0, "  serial   %8.1f us (%6.1f ns/trace)", serialTime * 1e6, serialTime * 1e9 / traceCount);
+	Log::Writef(LogSeverity::Info, 0, "  batched  %8.1f us (%6.1f ns/trace) on %u threads, %.2fx",
+		batchTime * 1e6, batchTime * 1e9 / traceCount, threads, batchTime > 0.0 ? serialTime / batchTime : 0.0);
+	if (mismatches > 0) {
+		Log::Writef(LogSeverity::Error, 0, "  %u batched traces differ from the serial ones", mismatches);
+	}
+}
+
+void benchmarks::RunMixerBenchmark(uint32_t channelCount) {
+	channelCount = channelCount < SoundMixer::MAX_CHANNELS ? channelCount : SoundMixer::MAX_CHANNELS;
+	std::mt19937 random(1996);
+	std::uniform_real_distribution<float> noise(-0.25f, 0.25f);
+	std::uniform_real_distribution<float> position(-SoundMixer::NOMINAL_CLIP_DISTANCE, SoundMixer::NOMINAL_CLIP_DISTANCE);
+
+	// One to two seconds of 11 kHz tone and noise each. Even sounds loop,
+	// like ambients; odd ones play once, like weapons and monsters.
+	std::vector<SoundSample> samples(MIXER_SOUNDS);
+	for (uint32_t i = 0; i < MIXER_SOUNDS; ++i) {
+		SoundSample& sample = samples[i];
+		sample.Rate = 11025;
+		sample.Length = sample.Rate + i * sample.Rate / MIXER_SOUNDS;
+		sample.LoopStart = i % 2 == 0 ? 0 : -1;
+		sample.Data.resize(sample.Length);
+		for (uint32_t n = 0; n < sample.Length; ++n) {
+			sample.Data[n] = 0.5f * std::sin(n * (i + 1) * 0.05f) + noise(random);
+		}
+		SoundMixer::PadSample(sample);
+	}
+
+	SoundMixer mixer;
+	mixer.Init(MIXER_RATE);
+	std::vector<SoundStart> starts(channelCount);
+	for (uint32_t i = 0; i < channelCount; ++i) {
+		SoundStart& start = starts[i];
+		start.Sample = &samples[i % MIXER_SOUNDS];
+		start.Entity = static_cast<int32_t>(i) + 2;
+		start.Channel = 1;
+		start.Origin[0] = position(random);
+		start.Origin[1] = position(random);
+		start.Origin[2] = position(random) * 0.25f;
+		start.Volume = 0.5f;
+		start.Attenuation = SoundMixer::ATTN_IDLE * 0.25f;
+		mixer.StartSound(start);
+	}
+
+	// The listener turns and the one-shot sounds restart on their own
+	// channels as they would in a fight, so every callback also applies
+	// commands and respatialises.
+	const uint32_t callbacks = MIXER_SECONDS * MIXER_RATE / MIXER_CALLBACK_FRAMES;
+	const uint32_t restarts = std::max(channelCount / 16, 1u);
+	std::vector<int16_t> output(MIXER_CALLBACK_FRAMES * 2);
+	vec3_t listenerOrigin = { 0.0f, 0.0f, 0.0f };
+	vec3_t listenerAngles = { 0.0f, 0.0f, 0.0f };
+	uint64_t checksum = 0;
+	uint32_t next = 1;
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t c = 0; c < callbacks; ++c) {
+		listenerAngles[YAW] = std::fmod(c * 2.0f, 360.0f);
+		mixer.SetListener(listenerOrigin, listenerAngles, 1);
+		for (uint32_t r = 0; r < restarts && channelCount > 1; ++r) {
+			mixer.StartSound(starts[next]);
+			next = next + 2 < channelCount ? next + 2 : 1;
+		}
+		mixer.Mix(output.data(), MIXER_CALLBACK_FRAMES);
+		checksum += static_cast<uint16_t>(output[c % output.size()]);
+	}
+	double seconds = Seconds(std::chrono::steady_clock::now() - start);
+
+	const double perCallback = seconds / callbacks;
+	const double channelFrames = static_cast<double>(callbacks) * MIXER_CALLBACK_FRAMES * channelCount;
+	Log::Writef(LogSeverity::Info, 0, "Mixer benchmark: %u channels of 11025 Hz sounds into %u Hz, %u %u-frame callbacks",
+		channelCount, MIXER_RATE, callbacks, MIXER_CALLBACK_FRAMES);
+	Log::Writef(LogSeverity::Info, 0, "  %.1f us per callback of %.1f ms (%.2f ns per channel-frame), %.0fx real time (checksum %llu)",
+		perCallback * 1e6, MIXER_CALLBACK_FRAMES * 1e3 / MIXER_RATE, channelFrames > 0.0 ? seconds * 1e9 / channelFrames : 0.0,
+		seconds > 0.0 ? MIXER_SECONDS / seconds : 0.0, static_cast<unsigned long long>(checksum));
+	mixer.Report();
+}
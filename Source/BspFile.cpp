@@ -0,0 +1,75 @@
+#include "BspFile.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "Utils.h"
+
+static_assert(sizeof(BspPlane) == 20, "BspPlane must match dplane_t");
+static_assert(sizeof(BspNode) == 24, "BspNode must match dnode_t");
+static_assert(sizeof(BspClipNode) == 8, "BspClipNode must match dclipnode_t");
+static_assert(sizeof(BspLeaf) == 28, "BspLeaf must match dleaf_t");
+static_assert(sizeof(BspModel) == 64, "BspModel must match dmodel_t");
+static_assert(sizeof(BspVertex) == 12, "BspVertex must match dvertex_t");
+static_assert(sizeof(BspTexInfo) == 40, "BspTexInfo must match texinfo_t");
+static_assert(sizeof(BspFace) == 20, "BspFace must match dface_t");
+static_assert(sizeof(BspEdge) == 4, "BspEdge must match dedge_t");
+static_assert(sizeof(BspMipTex) == 40, "BspMipTex must match miptex_t");
+
+// ------------------------
+// Public methods
+// ------------------------
+void BspFile::Load(const std::string& filename) {
+	Parse(utils::readFile(filename));
+}
+
+void BspFile::Parse(const std::vector<char>& data) {
+	int32_t version;
+	BspLump lumps[LUMP_COUNT];
+	if (data.size() < sizeof(version) + sizeof(lumps)) {
+		throw std::runtime_error("Failed to parse BSP file, header is truncated!");
+	}
+	std::memcpy(&version, data.data(), sizeof(version));
+	std::memcpy(lumps, data.data() + sizeof(version), sizeof(lumps));
+	if (version != VERSION) {
+		throw std::runtime_error("Failed to parse BSP file, version is not 29!");
+	}
+
+	ReadLump(data, lumps[LUMP_PLANES], Planes);
+	ReadLump(data, lumps[LUMP_NODES], Nodes);
+	ReadLump(data, lumps[LUMP_CLIPNODES], ClipNodes);
+	ReadLump(data, lumps[LUMP_LEAFS], Leafs);
+	ReadLump(data, lumps[LUMP_MODELS], Models);
+	ReadLump(data, lumps[LUMP_VERTEXES], Vertices);
+	ReadLump(data, lumps[LUMP_TEXINFO], TexInfo);
+	ReadLump(data, lumps[LUMP_FACES], Faces);
+	ReadLump(data, lumps[LUMP_EDGES], Edges);
+	ReadLump(data, lumps[LUMP_SURFEDGES], SurfEdges);
+	ReadLump(data, lumps[LUMP_TEXTURES], MipTextures);
+	ReadLump(data, lumps[LUMP_LIGHTING], Lighting);
+
+	std::vector<char> entities;
+	ReadLump(data, lumps[LUMP_ENTITIES], entities);
+	Entities.assign(entities.data(), strnlen(entities.data(), entities.size()));
+
+	if (Models.empty()) {
+		throw std::runtime_error("Failed to parse BSP file, it has no world model!");
+	}
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+template <typename T>
+void BspFile::ReadLump(const std::vector<char>& data, const BspLump& lump, std::vector<T>& out) {
+	if (lump.Offset < 0 || lump.Length < 0 ||
+		static_cast<size_t>(lump.Offset) + static_cast<size_t>(lump.Length) > data.size() ||
+		lump.Length % sizeof(T) != 0) {
+		throw std::runtime_error("Failed to parse BSP file, lump is out of bounds!");
+	}
+
+	out.resize(lump.Length / sizeof(T));
+	if (!out.empty()) {
+		std::memcpy(out.data(), data.data() + lump.Offset, lump.Length);
+	}
+}
@@ -0,0 +1,263 @@
+#include "CollisionWorld.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "Log.h"
+
+// Which source array a flattened node came from.
+static const uint32_t SOURCE_NODES = 0;
+static const uint32_t SOURCE_CLIPNODES = 1;
+
+// clip_mins and clip_maxs from Mod_LoadBrushModel.
+static const float HULL_MINS[CollisionWorld::HULL_COUNT][3] = {
+	{ 0.0f, 0.0f, 0.0f }, { -16.0f, -16.0f, -24.0f }, { -32.0f, -32.0f, -24.0f }
+};
+static const float HULL_MAXS[CollisionWorld::HULL_COUNT][3] = {
+	{ 0.0f, 0.0f, 0.0f }, { 16.0f, 16.0f, 32.0f }, { 32.0f, 32.0f, 64.0f }
+};
+
+// ------------------------
+// Public methods
+// ------------------------
+void CollisionWorld::Build(const BspFile& bsp) {
+	Nodes.clear();
+	HeadNodes.clear();
+
+	// Hull 0 walks the render nodes, whose leaf children are resolved to
+	// their contents as Mod_MakeHull0 does; hulls 1 and 2 share the
+	// clipnodes. Both map their source indices to flattened ones here.
+	std::vector<int32_t> nodeRemap(bsp.Nodes.size(), -1);
+	std::vector<int32_t> clipRemap(bsp.ClipNodes.size(), -1);
+	std::vector<std::pair<uint32_t, int32_t>> sources;
+	std::vector<int32_t> stack;
+
+	auto flatten = [&](uint32_t source, int32_t head) -> int32_t {
+		std::vector<int32_t>& remap = source == SOURCE_NODES ? nodeRemap : clipRemap;
+		if (head < 0) {
+			// A model that is a single leaf, such as an empty trigger.
+			return head;
+		}
+		if (static_cast<size_t>(head) >= remap.size()) {
+			throw std::runtime_error("Failed to build collision world, head node is out of range!");
+		}
+
+		stack.push_back(head);
+		while (!stack.empty()) {
+			int32_t num = stack.back();
+			stack.pop_back();
+			if (remap[num] >= 0) {
+				continue;
+			}
+			remap[num] = static_cast<int32_t>(sources.size());
+			sources.emplace_back(source, num);
+
+			const int16_t* children = source == SOURCE_NODES ? bsp.Nodes[num].Children : bsp.ClipNodes[num].Children;
+			// Pushed back to front so the front child is numbered next.
+			for (int32_t side = 1; side >= 0; --side) {
+				int32_t child = children[side];
+				if (child >= 0) {
+					if (static_cast<size_t>(child) >= remap.size()) {
+						throw std::runtime_error("Failed to build collision world, child node is out of range!");
+					}
+					stack.push_back(child);
+				}
+			}
+		}
+		return remap[head];
+	};
+
+	HeadNodes.resize(bsp.Models.size());
+	for (size_t model = 0; model < bsp.Models.size(); ++model) {
+		for (uint32_t hull = 0; hull < HULL_COUNT; ++hull) {
+			HeadNodes[model][hull] = flatten(hull == 0 ? SOURCE_NODES : SOURCE_CLIPNODES,
+				bsp.Models[model].HeadNode[hull]);
+		}
+	}
+
+	Nodes.resize(sources.size());
+	for (size_t i = 0; i < sources.size(); ++i) {
+		uint32_t source = sources[i].first;
+		int32_t num = sources[i].second;
+
+		int32_t planeNum = source == SOURCE_NODES ? bsp.Nodes[num].PlaneNum : bsp.ClipNodes[num].PlaneNum;
+		if (planeNum < 0 || static_cast<size_t>(planeNum) >= bsp.Planes.size()) {
+			throw std::runtime_error("Failed to build collision world, plane is out of range!");
+		}
+		const BspPlane& plane = bsp.Planes[planeNum];
+
+		ClipNode& node = Nodes[i];
+		node.Normal[0] = plane.Normal[0];
+		node.Normal[1] = plane.Normal[1];
+		node.Normal[2] = plane.Normal[2];
+		node.Dist = plane.Dist;
+		node.Type = plane.Type;
+		node.Padding = 0;
+
+		for (uint32_t side = 0; side < 2; ++side) {
+			if (source == SOURCE_NODES) {
+				int32_t child = bsp.Nodes[num].Children[side];
+				if (child >= 0) {
+					node.Children[side] = nodeRemap[child];
+				}
+				else {
+					size_t leaf = static_cast<size_t>(-1 - child);
+					if (leaf >= bsp.Leafs.size()) {
+						throw std::runtime_error("Failed to build collision world, leaf is out of range!");
+					}
+					node.Children[side] = bsp.Leafs[leaf].Contents;
+				}
+			}
+			else {
+				int32_t child = bsp.ClipNodes[num].Children[side];
+				node.Children[side] = child >= 0 ? clipRemap[child] : child;
+			}
+		}
+	}
+
+	Log::Writef(LogSeverity::Verbose, 0, "Collision world: %zu models, %zu nodes (%zu bytes)",
+		HeadNodes.size(), Nodes.size(), Nodes.size() * sizeof(ClipNode));
+}
+
+uint32_t CollisionWorld::GetModelCount() const {
+	return static_cast<uint32_t>(HeadNodes.size());
+}
+
+void CollisionWorld::GetHullBounds(uint32_t hull, vec3_t mins, vec3_t maxs) {
+	VectorCopy(HULL_MINS[hull], mins);
+	VectorCopy(HULL_MAXS[hull], maxs);
+}
+
+int32_t CollisionWorld::PointContents(const vec3_t point, uint32_t hull, uint32_t model) const {
+	return HullPointContents(HeadNodes[model][hull], point);
+}
+
+void CollisionWorld::Trace(const TraceRequest& request, TraceResult& result) const {
+	result = TraceResult{ };
+	result.Fraction = 1.0f;
+	result.AllSolid = true;
+	VectorCopy(request.End, result.EndPos);
+
+	int32_t head = HeadNodes[request.Model][request.Hull];
+	RecursiveHullCheck(head, head, 0.0f, 1.0f, request.Start, request.End, result);
+}
+
+void CollisionWorld::TraceBatch(WorkerPool& pool, const TraceRequest* requests, TraceResult* results,
+	uint32_t count) const {
+	pool.ParallelFor(count, TRACE_BATCH_GRAIN, [this, requests, results](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			Trace(requests[i], results[i]);
+		}
+	});
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+int32_t CollisionWorld::HullPointContents(int32_t num, const vec3_t point) const {
+	while (num >= 0) {
+		const ClipNode& node = Nodes[num];
+		float d = node.Type < 3 ? point[node.Type] - node.Dist : DotProduct(node.Normal, point) - node.Dist;
+		num = node.Children[d < 0.0f ? 1 : 0];
+	}
+	return num;
+}
+
+bool CollisionWorld::RecursiveHullCheck(int32_t head, int32_t num, float p1f, float p2f, const vec3_t p1, const vec3_t p2,
+	TraceResult& trace) const {
+	// Reached a leaf.
+	if (num < 0) {
+		if (num != BspFile::CONTENTS_SOLID) {
+			trace.AllSolid = false;
+			if (num == BspFile::CONTENTS_EMPTY) {
+				trace.InOpen = true;
+			}
+			else {
+				trace.InWater = true;
+			}
+		}
+		else {
+			trace.StartSolid = true;
+		}
+		return true;
+	}
+
+	const ClipNode& node = Nodes[num];
+	float t1;
+	float t2;
+	if (node.Type < 3) {
+		t1 = p1[node.Type] - node.Dist;
+		t2 = p2[node.Type] - node.Dist;
+	}
+	else {
+		t1 = DotProduct(node.Normal, p1) - node.Dist;
+		t2 = DotProduct(node.Normal, p2) - node.Dist;
+	}
+
+	if (t1 >= 0.0f && t2 >= 0.0f) {
+		return RecursiveHullCheck(head, node.Children[0], p1f, p2f, p1, p2, trace);
+	}
+	if (t1 < 0.0f && t2 < 0.0f) {
+		return RecursiveHullCheck(head, node.Children[1], p1f, p2f, p1, p2, trace);
+	}
+
+	// Put the crosspoint DIST_EPSILON units on the near side.
+	float frac = t1 < 0.0f ? (t1 + DIST_EPSILON) / (t1 - t2) : (t1 - DIST_EPSILON) / (t1 - t2);
+	frac = std::min(std::max(frac, 0.0f), 1.0f);
+
+	float midf = p1f + (p2f - p1f) * frac;
+	vec3_t mid;
+	for (int i = 0; i < 3; ++i) {
+		mid[i] = p1[i] + frac * (p2[i] - p1[i]);
+	}
+
+	int side = t1 < 0.0f ? 1 : 0;
+
+	// Move up to the node.
+	if (!RecursiveHullCheck(head, node.Children[side], p1f, midf, p1, mid, trace)) {
+		return false;
+	}
+
+	// Go past the node.
+	if (HullPointContents(node.Children[side ^ 1], mid) != BspFile::CONTENTS_SOLID) {
+		return RecursiveHullCheck(head, node.Children[side ^ 1], midf, p2f, mid, p2, trace);
+	}
+
+	// Never got out of the solid area.
+	if (trace.AllSolid) {
+		return false;
+	}
+
+	// The other side of the node is solid, so this is the impact point.
+	if (side == 0) {
+		VectorCopy(node.Normal, trace.PlaneNormal);
+		trace.PlaneDist = node.Dist;
+	}
+	else {
+		for (int i = 0; i < 3; ++i) {
+			trace.PlaneNormal[i] = -node.Normal[i];
+		}
+		trace.PlaneDist = -node.Dist;
+	}
+
+	// Back off until the point is out of the solid. Quake notes this
+	// "shouldn't really happen, but does occasionally".
+	while (HullPointContents(head, mid) == BspFile::CONTENTS_SOLID) {
+		frac -= 0.1f;
+		if (frac < 0.0f) {
+			trace.Fraction = midf;
+			VectorCopy(mid, trace.EndPos);
+			Log::Write(LogSeverity::Verbose, 0, "Trace backed up past its start");
+			return false;
+		}
+		midf = p1f + (p2f - p1f) * frac;
+		for (int i = 0; i < 3; ++i) {
+			mid[i] = p1[i] + frac * (p2[i] - p1[i]);
+		}
+	}
+
+	trace.Fraction = midf;
+	VectorCopy(mid, trace.EndPos);
+	return false;
+}
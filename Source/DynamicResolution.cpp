@@ -0,0 +1,149 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+// ------------------------
+// Public methods
+// ------------------------
+void DynamicResolution::Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+	const VkAllocationCallbacks* allocator, uint32_t queueFamily,
+	uint32_t framesInFlight, VkExtent2D maxExtent, float targetMs) {
+	Device = device;
+	Allocator = allocator;
+	MaxExtent = maxExtent;
+	TargetMs = targetMs;
+	Scale = MAX_SCALE;
+	UpdateExtent();
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+	uint32_t validBits = families[queueFamily].timestampValidBits;
+	if (validBits == 0) {
+		Log::Write(LogSeverity::Warning, 0, "Dynamic resolution unavailable: no timestamps on the graphics queue");
+		return;
+	}
+	TimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	TimestampPeriod = properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo poolInfo{ };
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = framesInFlight * 2;
+
+	if (utils::FunctionFailed(vkCreateQueryPool(Device, &poolInfo, Allocator, &Queries))) {
+		throw std::runtime_error("Failed to create timestamp query pool!");
+	}
+	Pending.assign(framesInFlight, false);
+
+	Log::Writef(LogSeverity::Info, 0, "Dynamic resolution: %.2f ms GPU target, %.0f%% to %.0f%% scale",
+		TargetMs, MIN_SCALE * 100.0f, MAX_SCALE * 100.0f);
+}
+
+void DynamicResolution::Destroy() {
+	vkDestroyQueryPool(Device, Queries, Allocator);
+	Queries = VK_NULL_HANDLE;
+}
+
+void DynamicResolution::BeginFrame(uint32_t frame) {
+	if (Queries == VK_NULL_HANDLE || !Pending[frame]) {
+		return;
+	}
+	Pending[frame] = false;
+
+	uint64_t timestamps[2];
+	if (vkGetQueryPoolResults(Device, Queries, frame * 2, 2, sizeof(timestamps), timestamps,
+		sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+		return;
+	}
+
+	uint64_t ticks = (timestamps[1] - timestamps[0]) & TimestampMask;
+	Adjust(static_cast<float>(ticks * TimestampPeriod / 1.0e6));
+}
+
+void DynamicResolution::WriteStart(VkCommandBuffer commandBuffer, uint32_t frame) {
+	if (Queries == VK_NULL_HANDLE) {
+		return;
+	}
+	vkCmdResetQueryPool(commandBuffer, Queries, frame * 2, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, Queries, frame * 2);
+}
+
+void DynamicResolution::WriteEnd(VkCommandBuffer commandBuffer, uint32_t frame) {
+	if (Queries == VK_NULL_HANDLE) {
+		return;
+	}
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, Queries, frame * 2 + 1);
+	Pending[frame] = true;
+}
+
+VkExtent2D DynamicResolution::GetRenderExtent() const {
+	return RenderExtent;
+}
+
+void DynamicResolution::Report() const {
+	if (Samples == 0) {
+		return;
+	}
+
+	Log::Writef(LogSeverity::Info, 0,
+		"Dynamic resolution: %.2f ms GPU avg against %.2f ms, %.0f%% scale avg, %.0f%% lowest over %llu frames",
+		TotalMs / Samples, TargetMs, TotalScale / Samples * 100.0, LowestScale * 100.0f,
+		static_cast<unsigned long long>(Samples));
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void DynamicResolution::Adjust(float gpuMs) {
+	SmoothedMs = SmoothedMs == 0.0f ? gpuMs : SmoothedMs + (gpuMs - SmoothedMs) * SMOOTHING;
+
+	// Time scales with area, so the linear scale moves by the square root.
+	float step = std::sqrt(TargetMs * AIM / std::max(SmoothedMs, 0.01f));
+	float previous = Scale;
+	if (SettleFrames > 0) {
+		--SettleFrames;
+	}
+	else if (SmoothedMs > TargetMs * DROP_ABOVE) {
+		Scale *= std::max(step, MAX_DROP);
+		FramesUnderBudget = 0;
+	}
+	else if (SmoothedMs < TargetMs * RAISE_BELOW) {
+		if (++FramesUnderBudget >= RAISE_DELAY_FRAMES) {
+			Scale *= std::min(step, MAX_RAISE);
+			FramesUnderBudget = 0;
+		}
+	}
+	else {
+		FramesUnderBudget = 0;
+	}
+	Scale = std::clamp(Scale, MIN_SCALE, MAX_SCALE);
+	if (Scale != previous) {
+		SettleFrames = SETTLE_FRAMES;
+		UpdateExtent();
+	}
+
+	TotalMs += gpuMs;
+	TotalScale += Scale;
+	LowestScale = std::min(LowestScale, Scale);
+	++Samples;
+}
+
+void DynamicResolution::UpdateExtent() {
+	// Below full size, whole multiples of 8 keep tiny scale changes from
+	// resizing every frame.
+	auto scaled = [this](uint32_t size) {
+		if (Scale >= 1.0f) {
+			return size;
+		}
+		uint32_t pixels = static_cast<uint32_t>(size * Scale) & ~7u;
+		return std::clamp(pixels, std::min(size, 8u), size);
+	};
+	RenderExtent = { scaled(MaxExtent.width), scaled(MaxExtent.height) };
+}
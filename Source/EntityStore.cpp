@@ -0,0 +1,141 @@
+#include "EntityStore.h"
+
+// ------------------------
+// Public methods
+// ------------------------
+void EntityStore::Reserve(uint32_t count) {
+	Origins.reserve(count * 3);
+	Angles.reserve(count * 3);
+	AbsMins.reserve(count * 3);
+	AbsMaxs.reserve(count * 3);
+	Models.reserve(count);
+	Frames.reserve(count);
+	Flags.reserve(count);
+	DenseToSlot.reserve(count);
+	SlotToDense.reserve(count);
+	SlotGenerations.reserve(count);
+}
+
+void EntityStore::Clear() {
+	// Bump every generation so outstanding handles go stale.
+	for (uint32_t dense = 0; dense < Count(); ++dense) {
+		uint32_t slot = DenseToSlot[dense];
+		SlotToDense[slot] = INVALID_INDEX;
+		++SlotGenerations[slot];
+		FreeSlots.push_back(slot);
+	}
+
+	Origins.clear();
+	Angles.clear();
+	AbsMins.clear();
+	AbsMaxs.clear();
+	Models.clear();
+	Frames.clear();
+	Flags.clear();
+	DenseToSlot.clear();
+}
+
+EntityHandle EntityStore::Create() {
+	uint32_t slot;
+	if (!FreeSlots.empty()) {
+		slot = FreeSlots.back();
+		FreeSlots.pop_back();
+	}
+	else {
+		slot = static_cast<uint32_t>(SlotToDense.size());
+		SlotToDense.push_back(INVALID_INDEX);
+		// Generation 0 is never live, so a default handle is always stale.
+		SlotGenerations.push_back(1);
+	}
+
+	uint32_t dense = Count();
+	SlotToDense[slot] = dense;
+	DenseToSlot.push_back(slot);
+
+	Origins.insert(Origins.end(), 3, 0.0f);
+	Angles.insert(Angles.end(), 3, 0.0f);
+	AbsMins.insert(AbsMins.end(), 3, 0.0f);
+	AbsMaxs.insert(AbsMaxs.end(), 3, 0.0f);
+	Models.push_back(0);
+	Frames.push_back(0);
+	Flags.push_back(0);
+
+	return EntityHandle{ slot, SlotGenerations[slot] };
+}
+
+bool EntityStore::Destroy(EntityHandle handle) {
+	uint32_t dense = IndexOf(handle);
+	if (dense == INVALID_INDEX) {
+		return false;
+	}
+
+	uint32_t last = Count() - 1;
+	if (dense != last) {
+		for (uint32_t i = 0; i < 3; ++i) {
+			Origins[dense * 3 + i] = Origins[last * 3 + i];
+			Angles[dense * 3 + i] = Angles[last * 3 + i];
+			AbsMins[dense * 3 + i] = AbsMins[last * 3 + i];
+			AbsMaxs[dense * 3 + i] = AbsMaxs[last * 3 + i];
+		}
+		Models[dense] = Models[last];
+		Frames[dense] = Frames[last];
+		Flags[dense] = Flags[last];
+
+		uint32_t movedSlot = DenseToSlot[last];
+		DenseToSlot[dense] = movedSlot;
+		SlotToDense[movedSlot] = dense;
+	}
+
+	Origins.resize(last * 3);
+	Angles.resize(last * 3);
+	AbsMins.resize(last * 3);
+	AbsMaxs.resize(last * 3);
+	Models.pop_back();
+	Frames.pop_back();
+	Flags.pop_back();
+	DenseToSlot.pop_back();
+
+	SlotToDense[handle.Slot] = INVALID_INDEX;
+	++SlotGenerations[handle.Slot];
+	FreeSlots.push_back(handle.Slot);
+	return true;
+}
+
+bool EntityStore::IsAlive(EntityHandle handle) const {
+	return IndexOf(handle) != INVALID_INDEX;
+}
+
+uint32_t EntityStore::IndexOf(EntityHandle handle) const {
+	if (handle.Slot >= SlotToDense.size() || SlotGenerations[handle.Slot] != handle.Generation) {
+		return INVALID_INDEX;
+	}
+	return SlotToDense[handle.Slot];
+}
+
+EntityHandle EntityStore::HandleAt(uint32_t index) const {
+	uint32_t slot = DenseToSlot[index];
+	return EntityHandle{ slot, SlotGenerations[slot] };
+}
+
+uint32_t EntityStore::Count() const {
+	return static_cast<uint32_t>(DenseToSlot.size());
+}
+
+void EntityStore::Link(uint32_t index, const vec3_t mins, const vec3_t maxs) {
+	const float* origin = Origin(index);
+	float* absMin = AbsMin(index);
+	float* absMax = AbsMax(index);
+	for (uint32_t i = 0; i < 3; ++i) {
+		absMin[i] = origin[i] + mins[i];
+		absMax[i] = origin[i] + maxs[i];
+	}
+}
+
+void EntityStore::CullBoxes(const float planes[6][4], std::vector<uint32_t>& visible) const {
+	const uint32_t count = Count();
+	for (uint32_t i = 0; i < count; ++i) {
+		if (!BoxOutsideFrustum(planes, &AbsMins[i * 3], &AbsMaxs[i * 3])) {
+			visible.push_back(i);
+		}
+	}
+}
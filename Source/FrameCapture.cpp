@@ -0,0 +1,344 @@
+#include "FrameCapture.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+// ------------------------
+// Public methods
+// ------------------------
+void FrameCapture::Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+	const VkAllocationCallbacks* allocator, VkFormat format, VkExtent2D extent,
+	uint32_t framesInFlight, const std::string& screenshotDirectory) {
+	Device = device;
+	Allocator = allocator;
+	Extent = extent;
+	ScreenshotDirectory = screenshotDirectory;
+
+	switch (format) {
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		// TGA stores BGRA, so these go out as they are.
+		SwapRedBlue = false;
+		break;
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		SwapRedBlue = true;
+		break;
+	default:
+		Log::Writef(LogSeverity::Warning, 0, "Frame capture unavailable: unsupported format %d", format);
+		return;
+	}
+
+	VkDeviceSize size = static_cast<VkDeviceSize>(Extent.width) * Extent.height * 4;
+	Slots.resize(framesInFlight + EXTRA_SLOTS);
+	for (Slot& slot : Slots) {
+		CreateSlot(physicalDevice, slot, size);
+	}
+
+	Stopping = false;
+	Writer = std::thread(&FrameCapture::WriterLoop, this);
+}
+
+void FrameCapture::Destroy() {
+	if (Slots.empty()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Stopping = true;
+	}
+	WorkReady.notify_all();
+	Writer.join();
+
+	for (Slot& slot : Slots) {
+		vkUnmapMemory(Device, slot.Memory);
+		vkDestroyBuffer(Device, slot.Buffer, Allocator);
+		vkFreeMemory(Device, slot.Memory, Allocator);
+	}
+	Slots.clear();
+}
+
+bool FrameCapture::IsAvailable() const {
+	return !Slots.empty();
+}
+
+bool FrameCapture::IsPending() const {
+	return SequenceActive || ScreenshotPending;
+}
+
+void FrameCapture::RequestScreenshot() {
+	ScreenshotPending = IsAvailable();
+}
+
+void FrameCapture::StartSequence(const std::string& directory, uint64_t frameCount) {
+	if (!IsAvailable()) {
+		return;
+	}
+
+	SequenceDirectory = directory;
+	SequenceLimit = frameCount;
+	SequenceFrame = 0;
+	SequenceActive = true;
+}
+
+void FrameCapture::StopSequence() {
+	SequenceActive = false;
+}
+
+bool FrameCapture::SequenceFinished() {
+	if (SequenceLimit == 0 || SequenceActive || SequenceFrame < SequenceLimit) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(Mutex);
+	for (const Slot& slot : Slots) {
+		if (slot.State != SlotState::Free) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void FrameCapture::Collect(uint64_t retiredFrame) {
+	bool queued = false;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		for (uint32_t i = 0; i < Slots.size(); ++i) {
+			Slot& slot = Slots[i];
+			if (slot.State != SlotState::Copying || slot.Frame > retiredFrame) {
+				continue;
+			}
+
+			if (!Coherent) {
+				VkMappedMemoryRange range{ };
+				range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+				range.memory = slot.Memory;
+				range.offset = 0;
+				range.size = VK_WHOLE_SIZE;
+				vkInvalidateMappedMemoryRanges(Device, 1, &range);
+			}
+			slot.State = SlotState::Writing;
+			Queue.push_back(i);
+			queued = true;
+		}
+	}
+	if (queued) {
+		WorkReady.notify_one();
+	}
+}
+
+void FrameCapture::Record(VkCommandBuffer commandBuffer, VkImage image, uint64_t frame, BarrierBatch& barriers) {
+	if (!SequenceActive && !ScreenshotPending) {
+		return;
+	}
+
+	// Sequence frames are numbered whether or not they are captured, so a
+	// drop shows up as a missing file rather than shifting the rest.
+	bool sequenceFrame = SequenceActive;
+	uint64_t sequenceIndex = SequenceFrame;
+	if (sequenceFrame && ++SequenceFrame == SequenceLimit) {
+		SequenceActive = false;
+	}
+
+	Slot* slot = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		for (Slot& candidate : Slots) {
+			if (candidate.State == SlotState::Free) {
+				slot = &candidate;
+				slot->State = SlotState::Copying;
+				break;
+			}
+		}
+	}
+	if (slot == nullptr) {
+		if (sequenceFrame) {
+			++Dropped;
+		}
+		return;
+	}
+
+	slot->Frame = frame;
+	slot->Paths.clear();
+	if (sequenceFrame) {
+		char name[32];
+		std::snprintf(name, sizeof(name), "/frame_%06llu.tga", static_cast<unsigned long long>(sequenceIndex));
+		slot->Paths.push_back(SequenceDirectory + name);
+	}
+	if (ScreenshotPending) {
+		slot->Paths.push_back(NextScreenshotPath());
+		Log::Writef(LogSeverity::Info, 0, "Screenshot: %s", slot->Paths.back().c_str());
+		ScreenshotPending = false;
+	}
+	++Captured;
+
+	VkBufferImageCopy region{ };
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { Extent.width, Extent.height, 1 };
+	vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->Buffer, 1, &region);
+
+	barriers.AddMemory(VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+}
+
+void FrameCapture::Report() {
+	if (Captured == 0 && Dropped == 0) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(Mutex);
+	Log::Writef(LogSeverity::Info, 0,
+		"Frame capture: %llu frames captured, %llu dropped, %llu files written (%.2f ms avg), %llu failed",
+		static_cast<unsigned long long>(Captured), static_cast<unsigned long long>(Dropped),
+		static_cast<unsigned long long>(Written), Written > 0 ? WriteSeconds * 1000.0 / Written : 0.0,
+		static_cast<unsigned long long>(WriteFailures));
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void FrameCapture::CreateSlot(const VkPhysicalDevice& physicalDevice, Slot& slot, VkDeviceSize size) {
+	VkBufferCreateInfo bufferInfo{ };
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (utils::FunctionFailed(vkCreateBuffer(Device, &bufferInfo, Allocator, &slot.Buffer))) {
+		throw std::runtime_error("Failed to create capture buffer!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(Device, slot.Buffer, &memRequirements);
+
+	// The CPU reads every byte, which is slow from uncached memory, so
+	// cached is preferred even if it needs invalidating.
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+	const VkMemoryPropertyFlags preferences[] = {
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+	};
+	uint32_t memoryType = memProperties.memoryTypeCount;
+	for (VkMemoryPropertyFlags wanted : preferences) {
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount && memoryType == memProperties.memoryTypeCount; ++i) {
+			if ((memRequirements.memoryTypeBits & (1 << i)) &&
+				(memProperties.memoryTypes[i].propertyFlags & wanted) == wanted) {
+				memoryType = i;
+			}
+		}
+	}
+	if (memoryType == memProperties.memoryTypeCount) {
+		throw std::runtime_error("Failed to find capture buffer memory!");
+	}
+	Coherent = (memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+	VkMemoryAllocateInfo allocInfo{ };
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	if (utils::FunctionFailed(vkAllocateMemory(Device, &allocInfo, Allocator, &slot.Memory))) {
+		throw std::runtime_error("Failed to allocate capture buffer memory!");
+	}
+	vkBindBufferMemory(Device, slot.Buffer, slot.Memory, 0);
+
+	void* mapped = nullptr;
+	if (utils::FunctionFailed(vkMapMemory(Device, slot.Memory, 0, VK_WHOLE_SIZE, 0, &mapped))) {
+		throw std::runtime_error("Failed to map capture buffer memory!");
+	}
+	slot.Mapped = static_cast<const uint8_t*>(mapped);
+}
+
+std::string FrameCapture::NextScreenshotPath() {
+	// Only runs for an actual screenshot, so the existence checks are rare.
+	char name[32];
+	std::string path;
+	do {
+		std::snprintf(name, sizeof(name), "/quake%04u.tga", ScreenshotIndex++);
+		path = ScreenshotDirectory + name;
+	} while (std::filesystem::exists(path));
+	return path;
+}
+
+void FrameCapture::WriterLoop() {
+	for (;;) {
+		uint32_t index;
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			WorkReady.wait(lock, [this] { return Stopping || !Queue.empty(); });
+			// Stopping still drains whatever was collected.
+			if (Queue.empty()) {
+				return;
+			}
+			index = Queue.front();
+			Queue.pop_front();
+		}
+
+		Slot& slot = Slots[index];
+		auto start = std::chrono::steady_clock::now();
+		uint64_t written = 0;
+		for (const std::string& path : slot.Paths) {
+			if (WriteTga(path, slot.Mapped)) {
+				++written;
+			}
+			else {
+				Log::Writef(LogSeverity::Warning, 0, "Failed to write capture %s", path.c_str());
+			}
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::lock_guard<std::mutex> lock(Mutex);
+		Written += written;
+		WriteFailures += slot.Paths.size() - written;
+		WriteSeconds += seconds;
+		slot.State = SlotState::Free;
+	}
+}
+
+bool FrameCapture::WriteTga(const std::string& path, const uint8_t* pixels) {
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	// Uncompressed true colour, 32 bits with 8 of alpha, top-left origin.
+	uint8_t header[18] = { };
+	header[2] = 2;
+	header[12] = static_cast<uint8_t>(Extent.width & 0xff);
+	header[13] = static_cast<uint8_t>(Extent.width >> 8);
+	header[14] = static_cast<uint8_t>(Extent.height & 0xff);
+	header[15] = static_cast<uint8_t>(Extent.height >> 8);
+	header[16] = 32;
+	header[17] = 0x28;
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+	const size_t rowBytes = static_cast<size_t>(Extent.width) * 4;
+	std::vector<uint8_t> row(rowBytes);
+	for (uint32_t y = 0; y < Extent.height; ++y) {
+		const uint8_t* source = pixels + y * rowBytes;
+		for (size_t x = 0; x < rowBytes; x += 4) {
+			row[x + 0] = source[x + (SwapRedBlue ? 2 : 0)];
+			row[x + 1] = source[x + 1];
+			row[x + 2] = source[x + (SwapRedBlue ? 0 : 2)];
+			row[x + 3] = 0xff;
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), rowBytes);
+	}
+
+	file.close();
+	return !file.fail();
+}
@@ -0,0 +1,244 @@
+#include "HostAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "Align.h"
+#include "Log.h"
+
+static const char* ScopeName(uint32_t scope) {
+	switch (scope) {
+	case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND: return "command";
+	case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT: return "object";
+	case VK_SYSTEM_ALLOCATION_SCOPE_CACHE: return "cache";
+	case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE: return "device";
+	case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+	default: return "unknown";
+	}
+}
+
+// ------------------------
+// Public methods
+// ------------------------
+HostAllocator::HostAllocator() : Arena(ARENA_SIZE) {
+	Callbacks.pUserData = this;
+	Callbacks.pfnAllocation = &HostAllocator::Allocate;
+	Callbacks.pfnReallocation = &HostAllocator::Reallocate;
+	Callbacks.pfnFree = &HostAllocator::Free;
+	Callbacks.pfnInternalAllocation = &HostAllocator::InternalAllocate;
+	Callbacks.pfnInternalFree = &HostAllocator::InternalFree;
+}
+
+HostAllocator::~HostAllocator() {
+	for (void* chunk : Chunks) {
+		std::free(chunk);
+	}
+}
+
+const VkAllocationCallbacks* HostAllocator::GetCallbacks() const {
+	return &Callbacks;
+}
+
+void HostAllocator::BeginFrame() {
+	std::lock_guard<std::mutex> lock(Mutex);
+	ArenaFramePeak = std::max(ArenaFramePeak, ArenaFrameBytes);
+	ArenaFrameBytes = 0;
+}
+
+size_t HostAllocator::GetLiveBytes() const {
+	std::lock_guard<std::mutex> lock(Mutex);
+	size_t bytes = 0;
+	for (const ScopeStats& stats : Stats) {
+		bytes += stats.LiveBytes + stats.InternalBytes;
+	}
+	return bytes;
+}
+
+void HostAllocator::Report() const {
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	Log::Write(LogSeverity::Info, 0, "Driver host allocations:");
+	for (uint32_t scope = 0; scope < SCOPE_COUNT; ++scope) {
+		const ScopeStats& stats = Stats[scope];
+		if (stats.Allocations == 0 && stats.InternalBytes == 0) {
+			continue;
+		}
+		Log::Writef(LogSeverity::Info, 0, "  %s: %llu allocations, %llu live (%zu bytes), %zu bytes peak, %zu bytes internal",
+			ScopeName(scope), static_cast<unsigned long long>(stats.Allocations),
+			static_cast<unsigned long long>(stats.LiveCount), stats.LiveBytes, stats.PeakBytes, stats.InternalBytes);
+	}
+	Log::Writef(LogSeverity::Info, 0, "  arena: %zu of %zu bytes peak per frame, %llu overflows",
+		std::max(ArenaFramePeak, ArenaFrameBytes), ARENA_SIZE, static_cast<unsigned long long>(ArenaOverflows));
+	Log::Writef(LogSeverity::Info, 0, "  pools: %zu chunks, %llu oversized heap allocations",
+		Chunks.size(), static_cast<unsigned long long>(HeapAllocations));
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::Allocate(void* userData, size_t size, size_t alignment,
+	VkSystemAllocationScope scope) {
+	HostAllocator* allocator = static_cast<HostAllocator*>(userData);
+	std::lock_guard<std::mutex> lock(allocator->Mutex);
+	return allocator->AllocateLocked(size, alignment, scope);
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::Reallocate(void* userData, void* original, size_t size,
+	size_t alignment, VkSystemAllocationScope scope) {
+	HostAllocator* allocator = static_cast<HostAllocator*>(userData);
+	std::lock_guard<std::mutex> lock(allocator->Mutex);
+
+	if (original == nullptr) {
+		return allocator->AllocateLocked(size, alignment, scope);
+	}
+	if (size == 0) {
+		allocator->FreeLocked(original);
+		return nullptr;
+	}
+
+	// On failure the original must be left untouched.
+	void* memory = allocator->AllocateLocked(size, alignment, scope);
+	if (memory == nullptr) {
+		return nullptr;
+	}
+	const Header* header = static_cast<const Header*>(original) - 1;
+	std::memcpy(memory, original, std::min(size, header->Size));
+	allocator->FreeLocked(original);
+	return memory;
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::Free(void* userData, void* memory) {
+	if (memory == nullptr) {
+		return;
+	}
+	HostAllocator* allocator = static_cast<HostAllocator*>(userData);
+	std::lock_guard<std::mutex> lock(allocator->Mutex);
+	allocator->FreeLocked(memory);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::InternalAllocate(void* userData, size_t size,
+	VkInternalAllocationType, VkSystemAllocationScope scope) {
+	HostAllocator* allocator = static_cast<HostAllocator*>(userData);
+	std::lock_guard<std::mutex> lock(allocator->Mutex);
+	allocator->Stats[scope].InternalBytes += size;
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::InternalFree(void* userData, size_t size,
+	VkInternalAllocationType, VkSystemAllocationScope scope) {
+	HostAllocator* allocator = static_cast<HostAllocator*>(userData);
+	std::lock_guard<std::mutex> lock(allocator->Mutex);
+	allocator->Stats[scope].InternalBytes -= size;
+}
+
+void* HostAllocator::AllocateLocked(size_t size, size_t alignment, VkSystemAllocationScope scope) {
+	if (size == 0) {
+		return nullptr;
+	}
+	// The header in front of the pointer has to be aligned as well.
+	alignment = std::max(alignment, alignof(Header));
+
+	uint8_t* block = nullptr;
+	uint32_t source = HEAP_SOURCE;
+	if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) {
+		block = AllocateFromArena(size, alignment);
+		if (block != nullptr) {
+			source = ARENA_SOURCE;
+		}
+	}
+
+	if (block == nullptr) {
+		// Worst case padding in front of the aligned pointer.
+		size_t needed = sizeof(Header) + alignment - 1 + size;
+		uint32_t sizeClass = 0;
+		while (sizeClass < POOL_CLASSES && (MIN_BLOCK_SIZE << sizeClass) < needed) {
+			++sizeClass;
+		}
+
+		if (sizeClass < POOL_CLASSES) {
+			block = AllocateBlock(sizeClass);
+			source = sizeClass;
+		}
+		else {
+			block = static_cast<uint8_t*>(std::malloc(needed));
+			source = HEAP_SOURCE;
+			++HeapAllocations;
+		}
+		if (block == nullptr) {
+			return nullptr;
+		}
+	}
+
+	uint8_t* memory = reinterpret_cast<uint8_t*>(
+		utils::AlignUp(reinterpret_cast<uintptr_t>(block) + sizeof(Header), alignment));
+	Header* header = reinterpret_cast<Header*>(memory) - 1;
+	header->Block = block;
+	header->Size = size;
+	header->Scope = scope;
+	header->Source = source;
+
+	ScopeStats& stats = Stats[scope];
+	++stats.Allocations;
+	++stats.LiveCount;
+	stats.LiveBytes += size;
+	stats.PeakBytes = std::max(stats.PeakBytes, stats.LiveBytes);
+	return memory;
+}
+
+void HostAllocator::FreeLocked(void* memory) {
+	const Header* header = static_cast<const Header*>(memory) - 1;
+
+	ScopeStats& stats = Stats[header->Scope];
+	--stats.LiveCount;
+	stats.LiveBytes -= header->Size;
+
+	if (header->Source == ARENA_SOURCE) {
+		// Command scope allocations are short-lived, so the arena drains
+		// between calls and can rewind without tracking individual frees.
+		if (--ArenaLive == 0) {
+			ArenaOffset = 0;
+		}
+	}
+	else if (header->Source == HEAP_SOURCE) {
+		std::free(header->Block);
+	}
+	else {
+		FreeBlocks[header->Source].push_back(header->Block);
+	}
+}
+
+uint8_t* HostAllocator::AllocateFromArena(size_t size, size_t alignment) {
+	uintptr_t base = reinterpret_cast<uintptr_t>(Arena.data());
+	uintptr_t start = base + ArenaOffset;
+	uintptr_t end = static_cast<uintptr_t>(utils::AlignUp(start + sizeof(Header), alignment)) + size;
+	if (end > base + ARENA_SIZE) {
+		++ArenaOverflows;
+		return nullptr;
+	}
+
+	ArenaOffset = end - base;
+	ArenaFrameBytes += end - start;
+	++ArenaLive;
+	return reinterpret_cast<uint8_t*>(start);
+}
+
+uint8_t* HostAllocator::AllocateBlock(uint32_t sizeClass) {
+	std::vector<void*>& freeBlocks = FreeBlocks[sizeClass];
+	if (freeBlocks.empty()) {
+		const size_t blockSize = MIN_BLOCK_SIZE << sizeClass;
+		uint8_t* chunk = static_cast<uint8_t*>(std::malloc(blockSize * BLOCKS_PER_CHUNK));
+		if (chunk == nullptr) {
+			return nullptr;
+		}
+		Chunks.push_back(chunk);
+
+		freeBlocks.reserve(freeBlocks.size() + BLOCKS_PER_CHUNK);
+		for (uint32_t i = BLOCKS_PER_CHUNK; i > 0; --i) {
+			freeBlocks.push_back(chunk + (i - 1) * blockSize);
+		}
+	}
+
+	void* block = freeBlocks.back();
+	freeBlocks.pop_back();
+	return static_cast<uint8_t*>(block);
+}
@@ -0,0 +1,226 @@
+#include "LevelPackage.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(PackageHeader) == 32, "PackageHeader layout is part of the file format");
+static_assert(sizeof(PackageSection) == 24, "PackageSection layout is part of the file format");
+static_assert(sizeof(PackageImage) == 32, "PackageImage layout is part of the file format");
+static_assert(sizeof(WorldVertex) == 28, "WorldVertex layout is part of the file format");
+static_assert(sizeof(WorldSurface) == 48, "WorldSurface layout is part of the file format");
+
+// ------------------------
+// Public methods
+// ------------------------
+LevelPackage::~LevelPackage() {
+	Close();
+}
+
+void LevelPackage::Open(const std::string& filename) {
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open level package " + filename + "!");
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to open level package " + filename + ", it is empty!");
+	}
+	// The view keeps the file and mapping alive once both handles close.
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr) {
+		throw std::runtime_error("Failed to map level package " + filename + "!");
+	}
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == nullptr) {
+		throw std::runtime_error("Failed to map level package " + filename + "!");
+	}
+	Data = static_cast<const uint8_t*>(view);
+	Size = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+	int descriptor = open(filename.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		throw std::runtime_error("Failed to open level package " + filename + "!");
+	}
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || status.st_size <= 0) {
+		close(descriptor);
+		throw std::runtime_error("Failed to open level package " + filename + ", it is empty!");
+	}
+	void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+	if (view == MAP_FAILED) {
+		throw std::runtime_error("Failed to map level package " + filename + "!");
+	}
+	// Everything is about to be copied to the GPU, so start reading ahead.
+	madvise(view, static_cast<size_t>(status.st_size), MADV_WILLNEED);
+	Data = static_cast<const uint8_t*>(view);
+	Size = static_cast<uint64_t>(status.st_size);
+#endif
+
+	try {
+		Validate();
+	}
+	catch (...) {
+		Close();
+		throw;
+	}
+}
+
+void LevelPackage::Close() {
+	if (Data == nullptr) {
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(Data);
+#else
+	munmap(const_cast<uint8_t*>(Data), static_cast<size_t>(Size));
+#endif
+	Data = nullptr;
+	Size = 0;
+	std::fill(std::begin(Sections), std::end(Sections), nullptr);
+}
+
+uint64_t LevelPackage::GetSourceHash() const {
+	return reinterpret_cast<const PackageHeader*>(Data)->SourceHash;
+}
+
+const WorldVertex* LevelPackage::GetVertices(size_t& count) const {
+	return GetSection<WorldVertex>(PackageSectionType::Vertices, count);
+}
+
+const uint32_t* LevelPackage::GetIndices(size_t& count) const {
+	return GetSection<uint32_t>(PackageSectionType::Indices, count);
+}
+
+const WorldSurface* LevelPackage::GetSurfaces(size_t& count) const {
+	return GetSection<WorldSurface>(PackageSectionType::Surfaces, count);
+}
+
+const PackageImage* LevelPackage::GetImages(size_t& count) const {
+	return GetSection<PackageImage>(PackageSectionType::Images, count);
+}
+
+const uint8_t* LevelPackage::GetImageData(const PackageImage& image) const {
+	const PackageSection* section = Sections[static_cast<uint32_t>(PackageSectionType::ImageData)];
+	return Data + section->Offset + image.DataOffset;
+}
+
+uint64_t LevelPackage::Hash(const void* data, size_t size, uint64_t seed) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+uint32_t LevelPackage::GetTexelSize(PackageImageFormat format) {
+	return format == PackageImageFormat::R8 ? 1 : 4;
+}
+
+uint64_t LevelPackage::GetImageSize(uint32_t width, uint32_t height, uint32_t mipLevels, PackageImageFormat format) {
+	uint64_t size = 0;
+	for (uint32_t level = 0; level < mipLevels; ++level) {
+		size += static_cast<uint64_t>(std::max(width >> level, 1u)) * std::max(height >> level, 1u);
+	}
+	return size * GetTexelSize(format);
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void LevelPackage::Validate() {
+	PackageHeader header;
+	if (Size < sizeof(header)) {
+		throw std::runtime_error("Failed to open level package, header is truncated!");
+	}
+	std::memcpy(&header, Data, sizeof(header));
+	if (std::memcmp(header.Magic, MAGIC, sizeof(MAGIC)) != 0) {
+		throw std::runtime_error("Failed to open level package, it is not a cooked level!");
+	}
+	if (header.Version != VERSION) {
+		throw std::runtime_error("Failed to open level package, it was cooked for another version!");
+	}
+	if (header.FileSize != Size ||
+		header.SectionCount > (Size - sizeof(header)) / sizeof(PackageSection)) {
+		throw std::runtime_error("Failed to open level package, file is truncated!");
+	}
+
+	const PackageSection* sections = reinterpret_cast<const PackageSection*>(Data + sizeof(header));
+	for (uint32_t i = 0; i < header.SectionCount; ++i) {
+		const PackageSection& section = sections[i];
+		if (section.Type >= PackageSectionType::Count || section.Offset % SECTION_ALIGNMENT != 0 ||
+			section.Offset > Size || section.Size > Size - section.Offset) {
+			throw std::runtime_error("Failed to open level package, section is out of bounds!");
+		}
+		Sections[static_cast<uint32_t>(section.Type)] = &section;
+	}
+	for (const PackageSection* section : Sections) {
+		if (section == nullptr) {
+			throw std::runtime_error("Failed to open level package, a section is missing!");
+		}
+	}
+
+	size_t vertexCount, indexCount, surfaceCount, imageCount;
+	GetVertices(vertexCount);
+	const uint32_t* indices = GetIndices(indexCount);
+	const WorldSurface* surfaces = GetSurfaces(surfaceCount);
+	const PackageImage* images = GetImages(imageCount);
+
+	for (size_t i = 0; i < surfaceCount; ++i) {
+		const WorldSurface& surface = surfaces[i];
+		if (static_cast<uint64_t>(surface.FirstIndex) + surface.IndexCount > indexCount ||
+			surface.VertexOffset < 0 || static_cast<uint64_t>(surface.VertexOffset) > vertexCount ||
+			(surface.Texture != PACKAGE_NO_IMAGE && surface.Texture >= imageCount) ||
+			(surface.Lightmap != PACKAGE_NO_IMAGE && surface.Lightmap >= imageCount)) {
+			throw std::runtime_error("Failed to open level package, surface is out of bounds!");
+		}
+		// A corrupt index would otherwise read past the vertex buffer on the GPU.
+		const uint64_t vertexLimit = vertexCount - static_cast<uint64_t>(surface.VertexOffset);
+		for (uint32_t j = 0; j < surface.IndexCount; ++j) {
+			if (indices[surface.FirstIndex + j] >= vertexLimit) {
+				throw std::runtime_error("Failed to open level package, index is out of bounds!");
+			}
+		}
+	}
+
+	const uint64_t dataSize = Sections[static_cast<uint32_t>(PackageSectionType::ImageData)]->Size;
+	for (size_t i = 0; i < imageCount; ++i) {
+		const PackageImage& image = images[i];
+		if (image.Width == 0 || image.Height == 0 || image.MipLevels == 0 || image.MipLevels > 32 ||
+			image.Format > PackageImageFormat::R8 || image.DataOffset % IMAGE_ALIGNMENT != 0 ||
+			image.DataSize != GetImageSize(image.Width, image.Height, image.MipLevels, image.Format) ||
+			image.DataOffset > dataSize || image.DataSize > dataSize - image.DataOffset) {
+			throw std::runtime_error("Failed to open level package, image is out of bounds!");
+		}
+	}
+}
+
+template <typename T>
+const T* LevelPackage::GetSection(PackageSectionType type, size_t& count) const {
+	const PackageSection* section = Sections[static_cast<uint32_t>(type)];
+	if (section->Size % sizeof(T) != 0) {
+		throw std::runtime_error("Failed to open level package, section size is not a whole number of entries!");
+	}
+	count = static_cast<size_t>(section->Size / sizeof(T));
+	return reinterpret_cast<const T*>(Data + section->Offset);
+}
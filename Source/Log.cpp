@@ -0,0 +1,310 @@
+#include "Log.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+	const uint32_t RATE_TABLE_SIZE = 256;
+
+	struct Slot {
+		std::atomic<size_t> Sequence{ 0 };
+		LogSeverity Severity = LogSeverity::Info;
+		int32_t MessageId = 0;
+		uint32_t Repeats = 0;
+		int64_t TimeMs = 0;
+		char Text[Log::MAX_MESSAGE];
+	};
+
+	struct RateEntry {
+		std::atomic<int32_t> MessageId{ 0 };
+		std::atomic<int64_t> WindowStart{ 0 };
+		std::atomic<uint32_t> Count{ 0 };
+		std::atomic<uint32_t> Suppressed{ 0 };
+	};
+
+	struct LogState {
+		// Bounded MPMC queue: each slot's sequence says whose turn it is.
+		Slot Slots[Log::RING_SIZE];
+		alignas(64) std::atomic<size_t> EnqueuePos{ 0 };
+		alignas(64) std::atomic<size_t> DequeuePos{ 0 };
+
+		std::atomic<uint32_t> MinSeverity{ static_cast<uint32_t>(LogSeverity::Info) };
+		std::atomic<int32_t> Muted[Log::MAX_MUTED];
+		std::atomic<uint32_t> MutedCount{ 0 };
+		RateEntry Rates[RATE_TABLE_SIZE];
+
+		std::atomic<uint64_t> Written{ 0 };
+		std::atomic<uint64_t> Dropped{ 0 };
+		std::atomic<uint64_t> Filtered{ 0 };
+		std::atomic<uint64_t> Suppressed{ 0 };
+
+		std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+		std::thread Writer;
+		std::atomic<bool> Running{ false };
+		std::atomic<bool> WriterSleeping{ false };
+		std::mutex WakeMutex;
+		std::condition_variable Wake;
+		// Serialises draining between the writer thread and Stop().
+		std::mutex DrainMutex;
+
+		LogState() {
+			for (uint32_t i = 0; i < Log::RING_SIZE; ++i) {
+				Slots[i].Sequence.store(i, std::memory_order_relaxed);
+			}
+			for (auto& muted : Muted) {
+				muted.store(0, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	LogState& GetState() {
+		static LogState state;
+		return state;
+	}
+
+	int64_t NowMs(const LogState& state) {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - state.StartTime).count();
+	}
+
+	bool IsMuted(LogState& state, int32_t messageId) {
+		uint32_t count = state.MutedCount.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < count; ++i) {
+			if (state.Muted[i].load(std::memory_order_relaxed) == messageId) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Racy by design: concurrent writers of the same ID may let a message or
+	// two past the limit, which is cheaper than locking.
+	bool Admit(LogState& state, int32_t messageId, int64_t now, uint32_t& repeats) {
+		RateEntry& entry = state.Rates[(static_cast<uint32_t>(messageId) * 2654435761u) % RATE_TABLE_SIZE];
+
+		if (entry.MessageId.load(std::memory_order_relaxed) != messageId) {
+			entry.MessageId.store(messageId, std::memory_order_relaxed);
+			entry.WindowStart.store(now, std::memory_order_relaxed);
+			entry.Count.store(1, std::memory_order_relaxed);
+			entry.Suppressed.store(0, std::memory_order_relaxed);
+			return true;
+		}
+
+		int64_t windowStart = entry.WindowStart.load(std::memory_order_relaxed);
+		if (now - windowStart >= Log::RATE_WINDOW_MS &&
+			entry.WindowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed)) {
+			entry.Count.store(1, std::memory_order_relaxed);
+			repeats = entry.Suppressed.exchange(0, std::memory_order_relaxed);
+			return true;
+		}
+
+		if (entry.Count.fetch_add(1, std::memory_order_relaxed) < Log::MAX_REPEATS) {
+			return true;
+		}
+		entry.Suppressed.fetch_add(1, std::memory_order_relaxed);
+		state.Suppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// Returns the claimed slot, or nullptr when the ring is full.
+	Slot* BeginEnqueue(LogState& state, size_t& position) {
+		position = state.EnqueuePos.load(std::memory_order_relaxed);
+		for (;;) {
+			Slot& slot = state.Slots[position % Log::RING_SIZE];
+			size_t sequence = slot.Sequence.load(std::memory_order_acquire);
+			intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+			if (difference == 0) {
+				if (state.EnqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					return &slot;
+				}
+			}
+			else if (difference < 0) {
+				return nullptr;
+			}
+			else {
+				position = state.EnqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void EndEnqueue(LogState& state, Slot& slot, size_t position) {
+		slot.Sequence.store(position + 1, std::memory_order_release);
+		if (state.WriterSleeping.load(std::memory_order_acquire)) {
+			state.Wake.notify_one();
+		}
+	}
+
+	bool Accept(LogState& state, LogSeverity severity, int32_t messageId, uint32_t& repeats) {
+		if (static_cast<uint32_t>(severity) < state.MinSeverity.load(std::memory_order_relaxed) ||
+			(messageId != 0 && IsMuted(state, messageId))) {
+			state.Filtered.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		return messageId == 0 || Admit(state, messageId, NowMs(state), repeats);
+	}
+
+	Slot* Claim(LogState& state, LogSeverity severity, int32_t messageId, size_t& position) {
+		uint32_t repeats = 0;
+		if (!Accept(state, severity, messageId, repeats)) {
+			return nullptr;
+		}
+
+		Slot* slot = BeginEnqueue(state, position);
+		if (slot == nullptr) {
+			state.Dropped.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		slot->Severity = severity;
+		slot->MessageId = messageId;
+		slot->Repeats = repeats;
+		slot->TimeMs = NowMs(state);
+		return slot;
+	}
+
+	const char* SeverityTag(LogSeverity severity) {
+		switch (severity) {
+		case LogSeverity::Verbose: return "V";
+		case LogSeverity::Info: return "I";
+		case LogSeverity::Warning: return "W";
+		default: return "E";
+		}
+	}
+
+	// Drains everything queued so far; returns false if there was nothing.
+	bool Drain(LogState& state) {
+		std::lock_guard<std::mutex> lock(state.DrainMutex);
+
+		std::string out;
+		std::string err;
+		char prefix[64];
+		size_t position = state.DequeuePos.load(std::memory_order_relaxed);
+		for (;;) {
+			Slot& slot = state.Slots[position % Log::RING_SIZE];
+			if (slot.Sequence.load(std::memory_order_acquire) != position + 1) {
+				break;
+			}
+
+			std::string& stream = slot.Severity >= LogSeverity::Warning ? err : out;
+			std::snprintf(prefix, sizeof(prefix), "[%8.3f] %s ",
+				slot.TimeMs / 1000.0, SeverityTag(slot.Severity));
+			stream += prefix;
+			stream += slot.Text;
+			if (slot.Repeats != 0) {
+				std::snprintf(prefix, sizeof(prefix), " (+%u similar suppressed)", slot.Repeats);
+				stream += prefix;
+			}
+			stream += '\n';
+
+			slot.Sequence.store(position + Log::RING_SIZE, std::memory_order_release);
+			++position;
+			state.Written.fetch_add(1, std::memory_order_relaxed);
+		}
+		state.DequeuePos.store(position, std::memory_order_relaxed);
+
+		if (!out.empty()) {
+			std::fwrite(out.data(), 1, out.size(), stdout);
+			std::fflush(stdout);
+		}
+		if (!err.empty()) {
+			std::fwrite(err.data(), 1, err.size(), stderr);
+			std::fflush(stderr);
+		}
+		return !out.empty() || !err.empty();
+	}
+
+	void WriterLoop(LogState& state) {
+		while (state.Running.load(std::memory_order_acquire)) {
+			if (Drain(state)) {
+				continue;
+			}
+			// The timeout covers a wakeup racing with WriterSleeping.
+			std::unique_lock<std::mutex> lock(state.WakeMutex);
+			state.WriterSleeping.store(true, std::memory_order_release);
+			state.Wake.wait_for(lock, std::chrono::milliseconds(10));
+			state.WriterSleeping.store(false, std::memory_order_release);
+		}
+	}
+}
+
+// ------------------------
+// Public methods
+// ------------------------
+void Log::Start() {
+	LogState& state = GetState();
+	if (state.Running.exchange(true)) {
+		return;
+	}
+	state.Writer = std::thread(WriterLoop, std::ref(state));
+}
+
+void Log::Stop() {
+	LogState& state = GetState();
+	if (state.Running.exchange(false)) {
+		state.Wake.notify_one();
+		state.Writer.join();
+	}
+	Drain(state);
+
+	uint64_t dropped = state.Dropped.load();
+	uint64_t suppressed = state.Suppressed.load();
+	if (dropped != 0 || suppressed != 0) {
+		std::fprintf(stderr, "Log: %llu written, %llu dropped, %llu filtered, %llu suppressed\n",
+			static_cast<unsigned long long>(state.Written.load()),
+			static_cast<unsigned long long>(dropped),
+			static_cast<unsigned long long>(state.Filtered.load()),
+			static_cast<unsigned long long>(suppressed));
+	}
+}
+
+void Log::SetMinSeverity(LogSeverity severity) {
+	GetState().MinSeverity.store(static_cast<uint32_t>(severity), std::memory_order_relaxed);
+}
+
+LogSeverity Log::GetMinSeverity() {
+	return static_cast<LogSeverity>(GetState().MinSeverity.load(std::memory_order_relaxed));
+}
+
+void Log::Mute(int32_t messageId) {
+	LogState& state = GetState();
+	uint32_t index = state.MutedCount.load(std::memory_order_relaxed);
+	if (messageId == 0 || index >= MAX_MUTED) {
+		return;
+	}
+	state.Muted[index].store(messageId, std::memory_order_relaxed);
+	state.MutedCount.store(index + 1, std::memory_order_release);
+}
+
+void Log::Write(LogSeverity severity, int32_t messageId, const char* text) {
+	LogState& state = GetState();
+	size_t position;
+	Slot* slot = Claim(state, severity, messageId, position);
+	if (slot == nullptr) {
+		return;
+	}
+
+	std::strncpy(slot->Text, text, MAX_MESSAGE - 1);
+	slot->Text[MAX_MESSAGE - 1] = '\0';
+	EndEnqueue(state, *slot, position);
+}
+
+void Log::Writef(LogSeverity severity, int32_t messageId, const char* format, ...) {
+	LogState& state = GetState();
+	size_t position;
+	Slot* slot = Claim(state, severity, messageId, position);
+	if (slot == nullptr) {
+		return;
+	}
+
+	va_list args;
+	va_start(args, format);
+	std::vsnprintf(slot->Text, MAX_MESSAGE, format, args);
+	va_end(args);
+	EndEnqueue(state, *slot, position);
+}
@@ -0,0 +1,375 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Log.h"
+
+namespace {
+	struct Definition {
+		char Name[Metrics::MAX_NAME];
+		MetricType Type = MetricType::Counter;
+		// Histograms' index into the per-histogram arrays.
+		uint32_t Slot = 0;
+	};
+
+	// Written only by its thread. Every value only grows, so EndFrame()
+	// can read them at any time and take the difference from what it saw
+	// last; an update it misses is picked up the next frame.
+	struct ThreadBlock {
+		// Counter sums and histogram sample counts.
+		std::atomic<uint64_t> Counts[Metrics::MAX_METRICS]{ };
+		std::atomic<double> Sums[Metrics::MAX_HISTOGRAMS]{ };
+		// The one value EndFrame() resets, by exchanging it.
+		std::atomic<double> Maxima[Metrics::MAX_HISTOGRAMS]{ };
+		std::atomic<uint64_t> Buckets[Metrics::MAX_HISTOGRAMS][Metrics::BUCKET_COUNT]{ };
+
+		// EndFrame() only.
+		uint64_t SeenCounts[Metrics::MAX_METRICS]{ };
+		double SeenSums[Metrics::MAX_HISTOGRAMS]{ };
+		uint64_t SeenBuckets[Metrics::MAX_HISTOGRAMS][Metrics::BUCKET_COUNT]{ };
+	};
+
+	// Totals over a run of frames. Histograms' Counts are their sample
+	// counts.
+	struct Interval {
+		std::chrono::steady_clock::time_point Start;
+		uint64_t Frames = 0;
+		uint64_t Counts[Metrics::MAX_METRICS]{ };
+		double Sums[Metrics::MAX_HISTOGRAMS]{ };
+		double Maxima[Metrics::MAX_HISTOGRAMS]{ };
+		uint64_t Buckets[Metrics::MAX_HISTOGRAMS][Metrics::BUCKET_COUNT]{ };
+	};
+
+	struct MetricsState {
+		// Guards registration and the list of blocks.
+		std::mutex Mutex;
+		Definition Definitions[Metrics::MAX_METRICS];
+		std::atomic<uint32_t> DefinitionCount{ 0 };
+		uint32_t HistogramCount = 0;
+		std::vector<std::unique_ptr<ThreadBlock>> Blocks;
+		std::atomic<double> Gauges[Metrics::MAX_METRICS]{ };
+
+		// Render thread only.
+		std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+		uint64_t FrameNumber = 0;
+		uint64_t Totals[Metrics::MAX_METRICS]{ };
+		Interval Display;
+		Interval Export;
+		std::FILE* ExportFile = nullptr;
+		uint32_t ExportIntervalMs = 0;
+		char OverlayText[Metrics::MAX_OVERLAY_TEXT] = "";
+	};
+
+	MetricsState& GetState() {
+		static MetricsState state;
+		return state;
+	}
+
+	ThreadBlock& GetBlock() {
+		thread_local ThreadBlock* block = nullptr;
+		if (block == nullptr) {
+			MetricsState& state = GetState();
+			std::lock_guard<std::mutex> lock(state.Mutex);
+			state.Blocks.push_back(std::make_unique<ThreadBlock>());
+			block = state.Blocks.back().get();
+		}
+		return *block;
+	}
+
+	// Single-writer increment: no lock prefix, unlike fetch_add.
+	template <typename T>
+	void Bump(std::atomic<T>& value, T amount) {
+		value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	uint32_t BucketOf(double value) {
+		if (!(value > 0.0)) {
+			return 0;
+		}
+		int exponent;
+		const double mantissa = std::frexp(value, &exponent);
+		const int32_t octave = exponent - 1 - Metrics::MIN_EXPONENT;
+		if (octave < 0) {
+			return 0;
+		}
+		if (octave >= static_cast<int32_t>(Metrics::OCTAVES)) {
+			return Metrics::BUCKET_COUNT - 1;
+		}
+		const uint32_t step = static_cast<uint32_t>((mantissa * 2.0 - 1.0) * Metrics::BUCKETS_PER_OCTAVE);
+		return static_cast<uint32_t>(octave) * Metrics::BUCKETS_PER_OCTAVE + step;
+	}
+
+	double BucketLimit(uint32_t bucket) {
+		const uint32_t octave = bucket / Metrics::BUCKETS_PER_OCTAVE;
+		const uint32_t step = bucket % Metrics::BUCKETS_PER_OCTAVE + 1;
+		return std::ldexp(1.0 + static_cast<double>(step) / Metrics::BUCKETS_PER_OCTAVE,
+			static_cast<int32_t>(octave) + Metrics::MIN_EXPONENT);
+	}
+
+	// The upper edge of the bucket holding the pth sample, which is never
+	// more than the largest value seen.
+	double Percentile(const Interval& interval, uint32_t id, uint32_t slot, double p) {
+		const uint64_t count = interval.Counts[id];
+		if (count == 0) {
+			return 0.0;
+		}
+		const uint64_t target = static_cast<uint64_t>(std::ceil(p * count));
+		uint64_t seen = 0;
+		for (uint32_t b = 0; b < Metrics::BUCKET_COUNT; ++b) {
+			seen += interval.Buckets[slot][b];
+			if (seen >= target) {
+				return std::min(BucketLimit(b), interval.Maxima[slot]);
+			}
+		}
+		return interval.Maxima[slot];
+	}
+
+	void ResetInterval(Interval& interval, std::chrono::steady_clock::time_point now) {
+		interval = Interval{ };
+		interval.Start = now;
+	}
+
+	void Collect(MetricsState& state, uint32_t definitionCount) {
+		std::lock_guard<std::mutex> lock(state.Mutex);
+		for (const std::unique_ptr<ThreadBlock>& block : state.Blocks) {
+			for (uint32_t id = 0; id < definitionCount; ++id) {
+				const Definition& definition = state.Definitions[id];
+				const uint64_t count = block->Counts[id].load(std::memory_order_relaxed);
+				if (definition.Type == MetricType::Gauge || count == block->SeenCounts[id]) {
+					continue;
+				}
+				const uint64_t delta = count - block->SeenCounts[id];
+				block->SeenCounts[id] = count;
+
+				if (definition.Type == MetricType::Counter) {
+					state.Display.Counts[id] += delta;
+					state.Export.Counts[id] += delta;
+					state.Totals[id] += delta;
+					continue;
+				}
+
+				// Histograms are counted from their buckets, so percentiles
+				// always add up even if a sample lands between the loads.
+				const uint32_t slot = definition.Slot;
+				for (uint32_t b = 0; b < Metrics::BUCKET_COUNT; ++b) {
+					const uint64_t value = block->Buckets[slot][b].load(std::memory_order_relaxed);
+					const uint64_t added = value - block->SeenBuckets[slot][b];
+					if (added != 0) {
+						block->SeenBuckets[slot][b] = value;
+						state.Display.Buckets[slot][b] += added;
+						state.Export.Buckets[slot][b] += added;
+						state.Display.Counts[id] += added;
+						state.Export.Counts[id] += added;
+					}
+				}
+				const double sum = block->Sums[slot].load(std::memory_order_relaxed);
+				state.Display.Sums[slot] += sum - block->SeenSums[slot];
+				state.Export.Sums[slot] += sum - block->SeenSums[slot];
+				block->SeenSums[slot] = sum;
+				const double maximum = block->Maxima[slot].exchange(0.0, std::memory_order_relaxed);
+				state.Display.Maxima[slot] = std::max(state.Display.Maxima[slot], maximum);
+				state.Export.Maxima[slot] = std::max(state.Export.Maxima[slot], maximum);
+			}
+		}
+	}
+
+	void FormatOverlay(MetricsState& state, uint32_t definitionCount) {
+		const Interval& interval = state.Display;
+		char* out = state.OverlayText;
+		size_t left = sizeof(state.OverlayText);
+		out[0] = '\0';
+
+		// Histograms first, then counters, then gauges, each in the order
+		// they were registered.
+		const MetricType order[] = { MetricType::Histogram, MetricType::Counter, MetricType::Gauge };
+		for (MetricType type : order) {
+			for (uint32_t id = 0; id < definitionCount && left > 1; ++id) {
+				const Definition& definition = state.Definitions[id];
+				if (definition.Type != type) {
+					continue;
+				}
+
+				int written = 0;
+				if (type == MetricType::Histogram) {
+					const uint32_t slot = definition.Slot;
+					const uint64_t count = interval.Counts[id];
+					written = std::snprintf(out, left, "%-20s %8.2f p99 %8.2f max %8.2f\n", definition.Name,
+						count > 0 ? interval.Sums[slot] / count : 0.0, Percentile(interval, id, slot, 0.99),
+						interval.Maxima[slot]);
+				}
+				else if (type == MetricType::Counter) {
+					written = std::snprintf(out, left, "%-20s %8.1f /frame\n", definition.Name,
+						interval.Frames > 0 ? static_cast<double>(interval.Counts[id]) / interval.Frames : 0.0);
+				}
+				else {
+					written = std::snprintf(out, left, "%-20s %12.6g\n", definition.Name,
+						state.Gauges[id].load(std::memory_order_relaxed));
+				}
+				if (written < 0 || static_cast<size_t>(written) >= left) {
+					return;
+				}
+				out += written;
+				left -= written;
+			}
+		}
+	}
+
+	void WriteExport(MetricsState& state, uint32_t definitionCount, std::chrono::steady_clock::time_point now) {
+		const Interval& interval = state.Export;
+		const double unixTime = std::chrono::duration<double>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+
+		char field[256];
+		std::string line;
+		std::snprintf(field, sizeof(field), "{\"unix\":%.3f,\"t\":%.3f,\"frame\":%llu,\"frames\":%llu,\"seconds\":%.3f,\"metrics\":{",
+			unixTime, std::chrono::duration<double>(now - state.StartTime).count(),
+			static_cast<unsigned long long>(state.FrameNumber), static_cast<unsigned long long>(interval.Frames),
+			std::chrono::duration<double>(now - interval.Start).count());
+		line += field;
+
+		for (uint32_t id = 0; id < definitionCount; ++id) {
+			const Definition& definition = state.Definitions[id];
+			if (definition.Type == MetricType::Histogram) {
+				const uint32_t slot = definition.Slot;
+				const uint64_t count = interval.Counts[id];
+				std::snprintf(field, sizeof(field),
+					"%s\"%s\":{\"count\":%llu,\"mean\":%.4g,\"p50\":%.4g,\"p95\":%.4g,\"p99\":%.4g,\"max\":%.4g}",
+					id > 0 ? "," : "", definition.Name, static_cast<unsigned long long>(count),
+					count > 0 ? interval.Sums[slot] / count : 0.0, Percentile(interval, id, slot, 0.5),
+					Percentile(interval, id, slot, 0.95), Percentile(interval, id, slot, 0.99), interval.Maxima[slot]);
+			}
+			else if (definition.Type == MetricType::Counter) {
+				std::snprintf(field, sizeof(field), "%s\"%s\":{\"sum\":%llu,\"per_frame\":%.4g,\"total\":%llu}",
+					id > 0 ? "," : "", definition.Name, static_cast<unsigned long long>(interval.Counts[id]),
+					interval.Frames > 0 ? static_cast<double>(interval.Counts[id]) / interval.Frames : 0.0,
+					static_cast<unsigned long long>(state.Totals[id]));
+			}
+			else {
+				std::snprintf(field, sizeof(field), "%s\"%s\":%.10g", id > 0 ? "," : "", definition.Name,
+					state.Gauges[id].load(std::memory_order_relaxed));
+			}
+			line += field;
+		}
+		line += "}}\n";
+
+		// Flushed per line so a crash in a soak run keeps everything up to
+		// the last interval.
+		std::fputs(line.c_str(), state.ExportFile);
+		std::fflush(state.ExportFile);
+	}
+}
+
+// ------------------------
+// Public methods
+// ------------------------
+uint32_t Metrics::Register(const char* name, MetricType type) {
+	const size_t length = std::strlen(name);
+	if (length == 0 || length >= MAX_NAME || std::strspn(name, "abcdefghijklmnopqrstuvwxyz0123456789_") != length) {
+		throw std::runtime_error(std::string("Failed to register metric \"") + name + "\", the name is malformed!");
+	}
+
+	MetricsState& state = GetState();
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	const uint32_t count = state.DefinitionCount.load(std::memory_order_relaxed);
+	for (uint32_t id = 0; id < count; ++id) {
+		if (std::strcmp(state.Definitions[id].Name, name) == 0) {
+			if (state.Definitions[id].Type != type) {
+				throw std::runtime_error(std::string("Failed to register metric ") + name + ", it has another type!");
+			}
+			return id;
+		}
+	}
+	if (count == MAX_METRICS || (type == MetricType::Histogram && state.HistogramCount == MAX_HISTOGRAMS)) {
+		throw std::runtime_error(std::string("Failed to register metric ") + name + ", the registry is full!");
+	}
+
+	Definition& definition = state.Definitions[count];
+	std::memcpy(definition.Name, name, length + 1);
+	definition.Type = type;
+	definition.Slot = type == MetricType::Histogram ? state.HistogramCount++ : 0;
+	state.DefinitionCount.store(count + 1, std::memory_order_release);
+	return count;
+}
+
+void Metrics::Add(uint32_t counter, uint64_t amount) {
+	Bump(GetBlock().Counts[counter], amount);
+}
+
+void Metrics::Set(uint32_t gauge, double value) {
+	GetState().Gauges[gauge].store(value, std::memory_order_relaxed);
+}
+
+void Metrics::Record(uint32_t histogram, double value) {
+	ThreadBlock& block = GetBlock();
+	const uint32_t slot = GetState().Definitions[histogram].Slot;
+	Bump(block.Buckets[slot][BucketOf(value)], uint64_t{ 1 });
+	Bump(block.Sums[slot], value);
+	if (value > block.Maxima[slot].load(std::memory_order_relaxed)) {
+		block.Maxima[slot].store(value, std::memory_order_relaxed);
+	}
+	// Last, as it is what tells EndFrame() to look at the rest.
+	Bump(block.Counts[histogram], uint64_t{ 1 });
+}
+
+void Metrics::EndFrame() {
+	MetricsState& state = GetState();
+	const uint32_t definitionCount = state.DefinitionCount.load(std::memory_order_acquire);
+	auto now = std::chrono::steady_clock::now();
+	if (state.FrameNumber == 0) {
+		ResetInterval(state.Display, now);
+	}
+
+	Collect(state, definitionCount);
+	++state.FrameNumber;
+	++state.Display.Frames;
+	++state.Export.Frames;
+
+	if (now - state.Display.Start >= std::chrono::milliseconds(uint32_t{ DISPLAY_INTERVAL_MS })) {
+		FormatOverlay(state, definitionCount);
+		ResetInterval(state.Display, now);
+	}
+	if (state.ExportFile != nullptr && now - state.Export.Start >= std::chrono::milliseconds(state.ExportIntervalMs)) {
+		WriteExport(state, definitionCount, now);
+		ResetInterval(state.Export, now);
+	}
+}
+
+void Metrics::StartExport(const std::string& filename, uint32_t intervalMs) {
+	MetricsState& state = GetState();
+	StopExport();
+
+	// Appended to, so runs against the same file line up one after another.
+	state.ExportFile = std::fopen(filename.c_str(), "a");
+	if (state.ExportFile == nullptr) {
+		Log::Writef(LogSeverity::Warning, 0, "Failed to open %s, metrics won't be exported", filename.c_str());
+		return;
+	}
+	state.ExportIntervalMs = intervalMs;
+	ResetInterval(state.Export, std::chrono::steady_clock::now());
+}
+
+void Metrics::StopExport() {
+	MetricsState& state = GetState();
+	if (state.ExportFile == nullptr) {
+		return;
+	}
+	if (state.Export.Frames > 0) {
+		WriteExport(state, state.DefinitionCount.load(std::memory_order_acquire), std::chrono::steady_clock::now());
+	}
+	std::fclose(state.ExportFile);
+	state.ExportFile = nullptr;
+}
+
+const char* Metrics::GetOverlayText() {
+	return GetState().OverlayText;
+}
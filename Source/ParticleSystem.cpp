@@ -0,0 +1,679 @@
+#include "ParticleSystem.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARTICLES_SSE2
+#endif
+
+#include "Metrics.h"
+
+static const uint32_t WORKGROUP_SIZE = 64;
+
+static const uint32_t DRAW_CALLS = Metrics::Register("draw_calls", MetricType::Counter);
+static const uint32_t PIPELINE_BINDS = Metrics::Register("pipeline_binds", MetricType::Counter);
+
+// Approximation of Quake's explosion colour ramp, as linear RGB.
+static const float RAMP_EXPLOSION[][3] = {
+	{ 1.00f, 0.95f, 0.45f }, { 1.00f, 0.80f, 0.30f }, { 0.95f, 0.60f, 0.20f },
+	{ 0.85f, 0.40f, 0.10f }, { 0.60f, 0.25f, 0.05f }, { 0.40f, 0.15f, 0.05f }
+};
+
+// ------------------------
+// Public methods
+// ------------------------
+void ParticleSystem::Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+	const VkAllocationCallbacks* allocator,
+	uint32_t graphicsFamily, std::optional<uint32_t> computeFamily,
+	const PipelineTarget& target, uint32_t framesInFlight) {
+	PhysicalDevice = physicalDevice;
+	Device = device;
+	Allocator = allocator;
+	GraphicsFamily = graphicsFamily;
+	AsyncCompute = computeFamily.has_value() && computeFamily.value() != graphicsFamily;
+	ComputeFamily = AsyncCompute ? computeFamily.value() : graphicsFamily;
+	FramesInFlight = framesInFlight;
+
+	CreateBuffers();
+	if (AsyncCompute) {
+		vkGetDeviceQueue(Device, ComputeFamily, 0, &ComputeQueue);
+		CreateDescriptors();
+		CreateComputePipeline();
+		CreateComputeCommands();
+	}
+	CreateGraphicsPipeline(target);
+}
+
+void ParticleSystem::Destroy() {
+	vkDestroyPipeline(Device, DrawPipeline, Allocator);
+	vkDestroyPipelineLayout(Device, DrawLayout, Allocator);
+	DrawShader.DestroyShader(Device);
+
+	if (AsyncCompute) {
+		for (auto semaphore : ComputeFinishedSemaphores) {
+			vkDestroySemaphore(Device, semaphore, Allocator);
+		}
+		vkDestroyCommandPool(Device, ComputeCommandPool, Allocator);
+		vkDestroyPipeline(Device, ComputePipeline, Allocator);
+		vkDestroyPipelineLayout(Device, ComputeLayout, Allocator);
+		vkDestroyDescriptorPool(Device, DescriptorPool, Allocator);
+		vkDestroyDescriptorSetLayout(Device, ComputeSetLayout, Allocator);
+		ComputeShader.DestroyShader(Device);
+	}
+
+	for (size_t i = 0; i < ParticleBuffers.size(); ++i) {
+		if (ParticleMapped[i] != nullptr) {
+			vkUnmapMemory(Device, ParticleMemory[i]);
+		}
+		vkDestroyBuffer(Device, ParticleBuffers[i], Allocator);
+		vkFreeMemory(Device, ParticleMemory[i], Allocator);
+	}
+	for (size_t i = 0; i < SpawnBuffers.size(); ++i) {
+		vkUnmapMemory(Device, SpawnMemory[i]);
+		vkDestroyBuffer(Device, SpawnBuffers[i], Allocator);
+		vkFreeMemory(Device, SpawnMemory[i], Allocator);
+	}
+}
+
+bool ParticleSystem::HasAsyncCompute() const {
+	return AsyncCompute;
+}
+
+void ParticleSystem::Spawn(const Particle& particle) {
+	PendingSpawns.push_back(particle);
+	LatestDie = std::max(LatestDie, particle.Die);
+}
+
+void ParticleSystem::ParticleExplosion(const vec3_t origin, float time) {
+	std::uniform_real_distribution<float> offset(-16.0f, 16.0f);
+	std::uniform_real_distribution<float> speed(-256.0f, 256.0f);
+	std::uniform_real_distribution<float> life(0.5f, 1.5f);
+
+	for (int i = 0; i < 1024; ++i) {
+		const float* color = RAMP_EXPLOSION[i % 6];
+
+		Particle p{ };
+		for (int j = 0; j < 3; ++j) {
+			p.Origin[j] = origin[j] + offset(Random);
+			p.Velocity[j] = speed(Random);
+		}
+		p.Die = time + life(Random);
+		p.Gravity = (i & 1) ? 0.05f : 0.0f;
+		p.Color[0] = color[0];
+		p.Color[1] = color[1];
+		p.Color[2] = color[2];
+		p.Color[3] = 1.0f;
+		Spawn(p);
+	}
+}
+
+void ParticleSystem::TeleportSplash(const vec3_t origin, float time) {
+	std::uniform_real_distribution<float> jitter(0.0f, 4.0f);
+	std::uniform_real_distribution<float> life(0.2f, 0.34f);
+	std::uniform_real_distribution<float> speed(50.0f, 113.0f);
+
+	for (int i = -16; i < 16; i += 4) {
+		for (int j = -16; j < 16; j += 4) {
+			for (int k = -24; k < 32; k += 4) {
+				float dir[3] = { j * 8.0f, i * 8.0f, k * 8.0f };
+				float length = std::sqrt(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+				float scale = speed(Random) / (length > 0.0f ? length : 1.0f);
+
+				Particle p{ };
+				p.Origin[0] = origin[0] + i + jitter(Random);
+				p.Origin[1] = origin[1] + j + jitter(Random);
+				p.Origin[2] = origin[2] + k + jitter(Random);
+				for (int n = 0; n < 3; ++n) {
+					p.Velocity[n] = dir[n] * scale;
+				}
+				p.Die = time + life(Random);
+				p.Gravity = 0.05f;
+				p.Color[0] = 0.75f;
+				p.Color[1] = 0.75f;
+				p.Color[2] = 0.75f;
+				p.Color[3] = 1.0f;
+				Spawn(p);
+			}
+		}
+	}
+}
+
+void ParticleSystem::Simulate(uint32_t frame, float time, float frameTime,
+	std::vector<VkSemaphore>& waitSemaphores,
+	std::vector<VkPipelineStageFlags>& waitStages) {
+	// Every particle spawned so far is dead, so the ring can start over.
+	// Stale slots in either buffer all hold dead particles.
+	if (PendingSpawns.empty() && time >= LatestDie) {
+		ActiveCount = 0;
+		SpawnCursor = 0;
+		DrawCount = 0;
+		return;
+	}
+
+	if (AsyncCompute) {
+		SimulateCompute(frame, time, frameTime, waitSemaphores, waitStages);
+	}
+	else {
+		SimulateCpu(frame, frameTime);
+	}
+	DrawCount = ActiveCount;
+}
+
+void ParticleSystem::Draw(VkCommandBuffer commandBuffer, uint32_t frame, const Mat4& viewProj, float time) {
+	if (DrawCount == 0) {
+		return;
+	}
+
+	DrawStep step{ };
+	step.ViewProj = viewProj;
+	step.Time = time;
+	step.Size = Size;
+
+	VkDeviceSize offset = 0;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, DrawPipeline);
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &ParticleBuffers[frame], &offset);
+	vkCmdPushConstants(commandBuffer, DrawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(step), &step);
+	vkCmdDraw(commandBuffer, 6, DrawCount, 0, 0);
+	Metrics::Add(PIPELINE_BINDS);
+	Metrics::Add(DRAW_CALLS);
+	// Not counted as triangles: which instances are alive is only known
+	// to the vertex shader, which collapses the dead ones.
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void ParticleSystem::CreateBuffers() {
+	const VkDeviceSize stateSize = sizeof(Particle) * MAX_PARTICLES;
+
+	ParticleBuffers.resize(FramesInFlight);
+	ParticleMemory.resize(FramesInFlight);
+	ParticleMapped.resize(FramesInFlight, nullptr);
+
+	if (!AsyncCompute) {
+		for (uint32_t i = 0; i < FramesInFlight; ++i) {
+			utils::CreateBuffer(PhysicalDevice, Device, stateSize,
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				ParticleBuffers[i], ParticleMemory[i], Allocator);
+
+			void* mapped = nullptr;
+			vkMapMemory(Device, ParticleMemory[i], 0, stateSize, 0, &mapped);
+			ParticleMapped[i] = static_cast<Particle*>(mapped);
+			std::memset(mapped, 0, stateSize);
+		}
+
+		OriginX.reset(new float[MAX_PARTICLES]());
+		OriginY.reset(new float[MAX_PARTICLES]());
+		OriginZ.reset(new float[MAX_PARTICLES]());
+		VelocityX.reset(new float[MAX_PARTICLES]());
+		VelocityY.reset(new float[MAX_PARTICLES]());
+		VelocityZ.reset(new float[MAX_PARTICLES]());
+		DieTime.reset(new float[MAX_PARTICLES]());
+		GravityScale.reset(new float[MAX_PARTICLES]());
+		Colors.reset(new float[MAX_PARTICLES * 4]());
+		return;
+	}
+
+	// Both queue families touch the state buffers every frame, so they
+	// are shared concurrently rather than ping-ponging ownership.
+	uint32_t families[] = { GraphicsFamily, ComputeFamily };
+
+	for (uint32_t i = 0; i < FramesInFlight; ++i) {
+		VkBufferCreateInfo bufferInfo{ };
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = stateSize;
+		bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = families;
+
+		if (utils::FunctionFailed(vkCreateBuffer(Device, &bufferInfo, Allocator, &ParticleBuffers[i]))) {
+			throw std::runtime_error("Failed to create particle buffer!");
+		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetBufferMemoryRequirements(Device, ParticleBuffers[i], &memRequirements);
+
+		VkMemoryAllocateInfo allocInfo{ };
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memRequirements.size;
+		allocInfo.memoryTypeIndex = utils::FindMemoryType(PhysicalDevice,
+			memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		if (utils::FunctionFailed(vkAllocateMemory(Device, &allocInfo, Allocator, &ParticleMemory[i]))) {
+			throw std::runtime_error("Failed to allocate particle buffer memory!");
+		}
+		vkBindBufferMemory(Device, ParticleBuffers[i], ParticleMemory[i], 0);
+	}
+
+	const VkDeviceSize spawnSize = sizeof(Particle) * MAX_SPAWN_PER_FRAME;
+
+	SpawnBuffers.resize(FramesInFlight);
+	SpawnMemory.resize(FramesInFlight);
+	SpawnMapped.resize(FramesInFlight);
+
+	for (uint32_t i = 0; i < FramesInFlight; ++i) {
+		utils::CreateBuffer(PhysicalDevice, Device, spawnSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			SpawnBuffers[i], SpawnMemory[i], Allocator);
+
+		void* mapped = nullptr;
+		vkMapMemory(Device, SpawnMemory[i], 0, spawnSize, 0, &mapped);
+		SpawnMapped[i] = static_cast<Particle*>(mapped);
+	}
+}
+
+void ParticleSystem::CreateDescriptors() {
+	VkDescriptorSetLayoutBinding bindings[3]{ };
+	for (uint32_t i = 0; i < 3; ++i) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{ };
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 3;
+	layoutInfo.pBindings = bindings;
+
+	if (utils::FunctionFailed(vkCreateDescriptorSetLayout(Device, &layoutInfo, Allocator, &ComputeSetLayout))) {
+		throw std::runtime_error("Failed to create particle descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{ };
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = 3 * FramesInFlight;
+
+	VkDescriptorPoolCreateInfo poolInfo{ };
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = FramesInFlight;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (utils::FunctionFailed(vkCreateDescriptorPool(Device, &poolInfo, Allocator, &DescriptorPool))) {
+		throw std::runtime_error("Failed to create particle descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(FramesInFlight, ComputeSetLayout);
+	DescriptorSets.resize(FramesInFlight);
+
+	VkDescriptorSetAllocateInfo allocInfo{ };
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = DescriptorPool;
+	allocInfo.descriptorSetCount = FramesInFlight;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (utils::FunctionFailed(vkAllocateDescriptorSets(Device, &allocInfo, DescriptorSets.data()))) {
+		throw std::runtime_error("Failed to allocate particle descriptor sets!");
+	}
+
+	for (uint32_t i = 0; i < FramesInFlight; ++i) {
+		uint32_t previous = (i + FramesInFlight - 1) % FramesInFlight;
+
+		VkDescriptorBufferInfo bufferInfos[3]{ };
+		bufferInfos[0] = { ParticleBuffers[previous], 0, VK_WHOLE_SIZE };
+		bufferInfos[1] = { ParticleBuffers[i], 0, VK_WHOLE_SIZE };
+		bufferInfos[2] = { SpawnBuffers[i], 0, VK_WHOLE_SIZE };
+
+		VkWriteDescriptorSet writes[3]{ };
+		for (uint32_t b = 0; b < 3; ++b) {
+			writes[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[b].dstSet = DescriptorSets[i];
+			writes[b].dstBinding = b;
+			writes[b].descriptorCount = 1;
+			writes[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[b].pBufferInfo = &bufferInfos[b];
+		}
+		vkUpdateDescriptorSets(Device, 3, writes, 0, nullptr);
+	}
+}
+
+void ParticleSystem::CreateComputePipeline() {
+	ComputeShader.SetCompShaderFilename("Shaders/particle_comp.spv");
+	ComputeShader.CompileShader(Device, Allocator);
+
+	VkPushConstantRange pushConstantRange{ };
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ComputeStep);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{ };
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &ComputeSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (utils::FunctionFailed(vkCreatePipelineLayout(Device, &pipelineLayoutInfo, Allocator, &ComputeLayout))) {
+		throw std::runtime_error("Failed to create particle compute pipeline layout!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{ };
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = ComputeShader.GetComp();
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = ComputeLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	if (utils::FunctionFailed(
+		vkCreateComputePipelines(
+			Device, VK_NULL_HANDLE, 1, &pipelineInfo, Allocator, &ComputePipeline))) {
+		throw std::runtime_error("Failed to create particle compute pipeline!");
+	}
+}
+
+void ParticleSystem::CreateGraphicsPipeline(const PipelineTarget& target) {
+	DrawShader.SetVertShaderFilename("Shaders/particle_vert.spv");
+	DrawShader.SetFragShaderFilename("Shaders/particle_frag.spv");
+	DrawShader.CompileShader(Device, Allocator);
+
+	VkPipelineShaderStageCreateInfo shaderStages[2]{ };
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = DrawShader.GetVert();
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = DrawShader.GetFrag();
+	shaderStages[1].pName = "main";
+
+	VkVertexInputBindingDescription binding{ };
+	binding.binding = 0;
+	binding.stride = sizeof(Particle);
+	binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	VkVertexInputAttributeDescription attributes[2]{ };
+	attributes[0].location = 0;
+	attributes[0].binding = 0;
+	attributes[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	attributes[0].offset = offsetof(Particle, Origin);
+	attributes[1].location = 1;
+	attributes[1].binding = 0;
+	attributes[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	attributes[1].offset = offsetof(Particle, Color);
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{ };
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.pVertexBindingDescriptions = &binding;
+	vertexInputInfo.vertexAttributeDescriptionCount = 2;
+	vertexInputInfo.pVertexAttributeDescriptions = attributes;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{ };
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportState{ };
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{ };
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{ };
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = target.Samples;
+	multisampling.minSampleShading = 1.0f;
+
+	// Particles are drawn last and hidden by the world, but never write
+	// depth: after a prepass the main pass only has read-only depth.
+	VkPipelineDepthStencilStateCreateInfo depthStencil{ };
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_FALSE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{ };
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_FALSE;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{ };
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	std::vector<VkDynamicState> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicState{ };
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkPushConstantRange pushConstantRange{ };
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(DrawStep);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{ };
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (utils::FunctionFailed(vkCreatePipelineLayout(Device, &pipelineLayoutInfo, Allocator, &DrawLayout))) {
+		throw std::runtime_error("Failed to create particle pipeline layout!");
+	}
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{ };
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = DrawLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkPipelineRenderingCreateInfo renderingInfo{ };
+	target.Apply(pipelineInfo, renderingInfo);
+
+	if (utils::FunctionFailed(
+		vkCreateGraphicsPipelines(
+			Device, VK_NULL_HANDLE, 1, &pipelineInfo, Allocator, &DrawPipeline))) {
+		throw std::runtime_error("Failed to create particle pipeline!");
+	}
+}
+
+void ParticleSystem::CreateComputeCommands() {
+	VkCommandPoolCreateInfo poolInfo{ };
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = ComputeFamily;
+
+	if (utils::FunctionFailed(vkCreateCommandPool(Device, &poolInfo, Allocator, &ComputeCommandPool))) {
+		throw std::runtime_error("Failed to create compute command pool!");
+	}
+
+	ComputeCommandBuffers.resize(FramesInFlight);
+
+	VkCommandBufferAllocateInfo allocInfo{ };
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = ComputeCommandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = FramesInFlight;
+
+	if (utils::FunctionFailed(vkAllocateCommandBuffers(Device, &allocInfo, ComputeCommandBuffers.data()))) {
+		throw std::runtime_error("Failed to allocate compute command buffers!");
+	}
+
+	ComputeFinishedSemaphores.resize(FramesInFlight);
+
+	VkSemaphoreCreateInfo semaphoreInfo{ };
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (uint32_t i = 0; i < FramesInFlight; ++i) {
+		if (utils::FunctionFailed(vkCreateSemaphore(Device, &semaphoreInfo, Allocator, &ComputeFinishedSemaphores[i]))) {
+			throw std::runtime_error("Failed to create compute semaphore!");
+		}
+	}
+
+	// Start every particle dead. This runs once at startup, so a blocking
+	// submit is fine here.
+	VkCommandBuffer commandBuffer = ComputeCommandBuffers[0];
+
+	VkCommandBufferBeginInfo beginInfo{ };
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	for (auto buffer : ParticleBuffers) {
+		vkCmdFillBuffer(commandBuffer, buffer, 0, VK_WHOLE_SIZE, 0);
+	}
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo{ };
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	vkQueueSubmit(ComputeQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	vkQueueWaitIdle(ComputeQueue);
+}
+
+void ParticleSystem::SimulateCompute(uint32_t frame, float time, float frameTime,
+	std::vector<VkSemaphore>& waitSemaphores,
+	std::vector<VkPipelineStageFlags>& waitStages) {
+	uint32_t spawnCount = static_cast<uint32_t>(std::min<size_t>(PendingSpawns.size(), MAX_SPAWN_PER_FRAME));
+	std::memcpy(SpawnMapped[frame], PendingSpawns.data(), spawnCount * sizeof(Particle));
+	PendingSpawns.erase(PendingSpawns.begin(), PendingSpawns.begin() + spawnCount);
+
+	ComputeStep step{ };
+	step.FrameTime = frameTime;
+	step.Gravity = Gravity;
+	step.Time = time;
+	step.SpawnBase = SpawnCursor;
+	step.SpawnCount = spawnCount;
+	step.MaxParticles = MAX_PARTICLES;
+	GrowActiveRange(spawnCount);
+	step.ActiveCount = ActiveCount;
+	SpawnCursor = (SpawnCursor + spawnCount) % MAX_PARTICLES;
+
+	VkCommandBuffer commandBuffer = ComputeCommandBuffers[frame];
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo{ };
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (utils::FunctionFailed(vkBeginCommandBuffer(commandBuffer, &beginInfo))) {
+		throw std::runtime_error("Failed to begin compute command buffer!");
+	}
+
+	// Last frame's dispatch wrote the state this one reads. Both were
+	// submitted to the compute queue, so a barrier is enough.
+	VkMemoryBarrier barrier{ };
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		1, &barrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ComputePipeline);
+	Metrics::Add(PIPELINE_BINDS);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ComputeLayout,
+		0, 1, &DescriptorSets[frame], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, ComputeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(step), &step);
+	vkCmdDispatch(commandBuffer, (ActiveCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	if (utils::FunctionFailed(vkEndCommandBuffer(commandBuffer))) {
+		throw std::runtime_error("Failed to record compute command buffer!");
+	}
+
+	VkSubmitInfo submitInfo{ };
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &ComputeFinishedSemaphores[frame];
+
+	if (utils::FunctionFailed(vkQueueSubmit(ComputeQueue, 1, &submitInfo, VK_NULL_HANDLE))) {
+		throw std::runtime_error("Failed to submit compute command buffer!");
+	}
+
+	waitSemaphores.push_back(ComputeFinishedSemaphores[frame]);
+	waitStages.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+}
+
+void ParticleSystem::SimulateCpu(uint32_t frame, float frameTime) {
+	uint32_t spawnCount = static_cast<uint32_t>(std::min<size_t>(PendingSpawns.size(), MAX_SPAWN_PER_FRAME));
+	for (uint32_t i = 0; i < spawnCount; ++i) {
+		const Particle& p = PendingSpawns[i];
+		uint32_t slot = (SpawnCursor + i) % MAX_PARTICLES;
+
+		OriginX[slot] = p.Origin[0];
+		OriginY[slot] = p.Origin[1];
+		OriginZ[slot] = p.Origin[2];
+		VelocityX[slot] = p.Velocity[0];
+		VelocityY[slot] = p.Velocity[1];
+		VelocityZ[slot] = p.Velocity[2];
+		DieTime[slot] = p.Die;
+		GravityScale[slot] = p.Gravity;
+		std::memcpy(&Colors[slot * 4], p.Color, sizeof(p.Color));
+	}
+	PendingSpawns.erase(PendingSpawns.begin(), PendingSpawns.begin() + spawnCount);
+	GrowActiveRange(spawnCount);
+	SpawnCursor = (SpawnCursor + spawnCount) % MAX_PARTICLES;
+
+	// Dead particles in the active range are integrated too; the vertex
+	// shader discards them and it keeps the loop branch-free.
+	const uint32_t count = ActiveCount;
+	const float gravityStep = Gravity * frameTime;
+	uint32_t i = 0;
+#ifdef PARTICLES_SSE2
+	const __m128 dt = _mm_set1_ps(frameTime);
+	const __m128 grav = _mm_set1_ps(gravityStep);
+	for (; i + 4 <= count; i += 4) {
+		__m128 vz = _mm_loadu_ps(&VelocityZ[i]);
+		vz = _mm_sub_ps(vz, _mm_mul_ps(grav, _mm_loadu_ps(&GravityScale[i])));
+		_mm_storeu_ps(&VelocityZ[i], vz);
+
+		_mm_storeu_ps(&OriginX[i], _mm_add_ps(_mm_loadu_ps(&OriginX[i]), _mm_mul_ps(_mm_loadu_ps(&VelocityX[i]), dt)));
+		_mm_storeu_ps(&OriginY[i], _mm_add_ps(_mm_loadu_ps(&OriginY[i]), _mm_mul_ps(_mm_loadu_ps(&VelocityY[i]), dt)));
+		_mm_storeu_ps(&OriginZ[i], _mm_add_ps(_mm_loadu_ps(&OriginZ[i]), _mm_mul_ps(vz, dt)));
+	}
+#endif
+	for (; i < count; ++i) {
+		VelocityZ[i] -= gravityStep * GravityScale[i];
+		OriginX[i] += VelocityX[i] * frameTime;
+		OriginY[i] += VelocityY[i] * frameTime;
+		OriginZ[i] += VelocityZ[i] * frameTime;
+	}
+
+	Particle* out = ParticleMapped[frame];
+	for (uint32_t n = 0; n < count; ++n) {
+		out[n].Origin[0] = OriginX[n];
+		out[n].Origin[1] = OriginY[n];
+		out[n].Origin[2] = OriginZ[n];
+		out[n].Die = DieTime[n];
+		std::memcpy(out[n].Color, &Colors[n * 4], sizeof(out[n].Color));
+	}
+}
+
+void ParticleSystem::GrowActiveRange(uint32_t spawnCount) {
+	// Once the ring wraps every slot is in use.
+	const uint32_t end = SpawnCursor + spawnCount;
+	ActiveCount = end >= MAX_PARTICLES ? MAX_PARTICLES : std::max(ActiveCount, end);
+}
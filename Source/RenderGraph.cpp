@@ -0,0 +1,863 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Log.h"
+#include "Utils.h"
+
+namespace {
+	const uint32_t NO_PASS = 0xFFFFFFFF;
+	const uint32_t NO_MEMORY_TYPE = 0xFFFFFFFF;
+
+	struct AccessInfo {
+		VkImageLayout Layout;
+		VkPipelineStageFlags2 Stage;
+		VkAccessFlags2 Access;
+		// The part of Access later uses have to be made to see.
+		VkAccessFlags2 WriteAccess;
+		VkImageUsageFlags Usage;
+		bool Attachment;
+		// Depends on what earlier passes left in the image.
+		bool ReadsContents;
+	};
+
+	AccessInfo DescribeAccess(RenderAccess type, VkAttachmentLoadOp loadOp) {
+		const bool load = loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+		switch (type) {
+		case RenderAccess::ColorWrite:
+			return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | (load ? VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT : 0),
+				VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true, load };
+		case RenderAccess::ColorResolve:
+			return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true, false };
+		case RenderAccess::DepthWrite:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+				VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true, load };
+		case RenderAccess::DepthRead:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, 0, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true, true };
+		case RenderAccess::ShaderRead:
+			return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+				VK_ACCESS_2_SHADER_READ_BIT, 0, VK_IMAGE_USAGE_SAMPLED_BIT, false, true };
+		case RenderAccess::TransferRead:
+		default:
+			return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+				VK_ACCESS_2_TRANSFER_READ_BIT, 0, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false, true };
+		}
+	}
+
+	bool IsWrite(RenderAccess type) {
+		return type == RenderAccess::ColorWrite || type == RenderAccess::ColorResolve || type == RenderAccess::DepthWrite;
+	}
+
+	VkImageAspectFlags AspectForFormat(VkFormat format) {
+		switch (format) {
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+}
+
+// ------------------------
+// Public methods
+// ------------------------
+void RenderGraph::Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+	const VkAllocationCallbacks* allocator, bool modernPath) {
+	PhysicalDevice = physicalDevice;
+	Device = device;
+	Allocator = allocator;
+	ModernPath = modernPath;
+}
+
+void RenderGraph::Destroy() {
+	ReleaseCompiled();
+	Resources.clear();
+	Passes.clear();
+}
+
+RenderResource RenderGraph::ImportImage(const std::string& name, VkFormat format, VkExtent2D extent,
+	VkImageLayout initialLayout, VkImageLayout finalLayout, VkPipelineStageFlags2 initialStage) {
+	Resource resource;
+	resource.Name = name;
+	resource.Imported = true;
+	resource.Format = format;
+	resource.Extent = extent;
+	resource.InitialLayout = initialLayout;
+	resource.FinalLayout = finalLayout;
+	resource.InitialStage = initialStage;
+	Resources.push_back(resource);
+	return static_cast<RenderResource>(Resources.size() - 1);
+}
+
+RenderResource RenderGraph::CreateImage(const std::string& name, VkFormat format, VkExtent2D extent,
+	VkSampleCountFlagBits samples) {
+	Resource resource;
+	resource.Name = name;
+	resource.Format = format;
+	resource.Extent = extent;
+	resource.Samples = samples;
+	Resources.push_back(resource);
+	return static_cast<RenderResource>(Resources.size() - 1);
+}
+
+void RenderGraph::SetImportedImage(RenderResource resource, VkImage image, VkImageView view) {
+	Resources[resource].Image = image;
+	Resources[resource].View = view;
+}
+
+void RenderGraph::ResizeImage(RenderResource resource, VkExtent2D extent) {
+	Resources[resource].Extent = extent;
+}
+
+uint32_t RenderGraph::AddPass(const std::string& name, std::function<void(VkCommandBuffer)> record) {
+	Pass pass;
+	pass.Name = name;
+	pass.Record = std::move(record);
+	Passes.push_back(std::move(pass));
+	return static_cast<uint32_t>(Passes.size() - 1);
+}
+
+void RenderGraph::SetSideEffects(uint32_t pass) {
+	Passes[pass].SideEffects = true;
+}
+
+void RenderGraph::SetOptional(uint32_t pass) {
+	Passes[pass].Optional = true;
+}
+
+void RenderGraph::SetOptionalPassesEnabled(bool enabled) {
+	OptionalPassesEnabled = enabled;
+}
+
+void RenderGraph::SetRenderArea(uint32_t pass, VkExtent2D area) {
+	Passes[pass].RenderArea = area;
+}
+
+void RenderGraph::WriteColor(uint32_t pass, RenderResource resource, VkAttachmentLoadOp loadOp,
+	VkClearValue clearValue) {
+	AddAccess(pass, Access{ resource, RenderAccess::ColorWrite, loadOp, clearValue, 0, VK_ATTACHMENT_STORE_OP_STORE });
+}
+
+void RenderGraph::ResolveColor(uint32_t pass, RenderResource source, RenderResource target) {
+	AddAccess(pass, Access{ target, RenderAccess::ColorResolve, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VkClearValue{ },
+		source, VK_ATTACHMENT_STORE_OP_STORE });
+}
+
+void RenderGraph::WriteDepth(uint32_t pass, RenderResource resource, VkAttachmentLoadOp loadOp,
+	VkClearValue clearValue) {
+	AddAccess(pass, Access{ resource, RenderAccess::DepthWrite, loadOp, clearValue, 0, VK_ATTACHMENT_STORE_OP_STORE });
+}
+
+void RenderGraph::Read(uint32_t pass, RenderResource resource, RenderAccess type) {
+	AddAccess(pass, Access{ resource, type, VK_ATTACHMENT_LOAD_OP_LOAD, VkClearValue{ }, 0,
+		VK_ATTACHMENT_STORE_OP_STORE });
+}
+
+void RenderGraph::Compile() {
+	ReleaseCompiled();
+
+	CullPasses();
+	PlanLifetimes();
+	AllocateImages();
+	PlanBarriers(true);
+	PlanBarriers(false);
+	if (!ModernPath) {
+		for (Pass& pass : Passes) {
+			if (!pass.Culled && pass.Graphics) {
+				CreateRenderPass(pass);
+			}
+		}
+	}
+}
+
+void RenderGraph::Execute(VkCommandBuffer commandBuffer, BarrierBatch& barriers) {
+	const bool withOptional = OptionalPassesEnabled;
+	for (Pass& pass : Passes) {
+		if (pass.Culled || (pass.Optional && !withOptional)) {
+			continue;
+		}
+
+		for (const PlannedBarrier& barrier : withOptional ? pass.Barriers : pass.BarriersWithoutOptional) {
+			AddBarrier(barriers, barrier);
+		}
+		barriers.Flush(commandBuffer, ModernPath);
+
+		if (pass.Graphics) {
+			BeginPass(commandBuffer, pass);
+		}
+		if (pass.Record) {
+			pass.Record(commandBuffer);
+		}
+		if (pass.Graphics) {
+			EndPass(commandBuffer);
+		}
+	}
+
+	for (const PlannedBarrier& barrier : withOptional ? FinalBarriers : FinalBarriersWithoutOptional) {
+		AddBarrier(barriers, barrier);
+	}
+	barriers.Flush(commandBuffer, ModernPath);
+}
+
+PipelineTarget RenderGraph::GetPipelineTarget(uint32_t pass) const {
+	PipelineTarget target;
+	target.RenderPass = Passes[pass].RenderPass;
+	for (const Access& access : Passes[pass].Accesses) {
+		const Resource& resource = Resources[access.Resource];
+		if (access.Type == RenderAccess::ColorWrite && target.ColorFormat == VK_FORMAT_UNDEFINED) {
+			target.ColorFormat = resource.Format;
+			target.Samples = resource.Samples;
+		}
+		else if (access.Type == RenderAccess::DepthWrite || access.Type == RenderAccess::DepthRead) {
+			target.DepthFormat = resource.Format;
+			target.Samples = resource.Samples;
+		}
+	}
+	return target;
+}
+
+VkImage RenderGraph::GetImage(RenderResource resource) const {
+	return Resources[resource].Image;
+}
+
+VkImageView RenderGraph::GetImageView(RenderResource resource) const {
+	return Resources[resource].View;
+}
+
+bool RenderGraph::IsCulled(uint32_t pass) const {
+	return Passes[pass].Culled;
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void RenderGraph::AddAccess(uint32_t pass, const Access& access) {
+	for (const Access& existing : Passes[pass].Accesses) {
+		if (existing.Resource == access.Resource) {
+			throw std::runtime_error("Failed to add render graph access, image is already used by the pass!");
+		}
+	}
+	Passes[pass].Accesses.push_back(access);
+}
+
+void RenderGraph::ReleaseCompiled() {
+	for (Pass& pass : Passes) {
+		for (const Framebuffer& framebuffer : pass.Framebuffers) {
+			vkDestroyFramebuffer(Device, framebuffer.Handle, Allocator);
+		}
+		pass.Framebuffers.clear();
+		if (pass.RenderPass != VK_NULL_HANDLE) {
+			vkDestroyRenderPass(Device, pass.RenderPass, Allocator);
+			pass.RenderPass = VK_NULL_HANDLE;
+		}
+		pass.Barriers.clear();
+		pass.BarriersWithoutOptional.clear();
+	}
+
+	for (Resource& resource : Resources) {
+		if (resource.Imported) {
+			continue;
+		}
+		if (resource.View != VK_NULL_HANDLE) {
+			vkDestroyImageView(Device, resource.View, Allocator);
+		}
+		if (resource.Image != VK_NULL_HANDLE) {
+			vkDestroyImage(Device, resource.Image, Allocator);
+		}
+		if (resource.Memory != VK_NULL_HANDLE) {
+			vkFreeMemory(Device, resource.Memory, Allocator);
+		}
+		resource.View = VK_NULL_HANDLE;
+		resource.Image = VK_NULL_HANDLE;
+		resource.Memory = VK_NULL_HANDLE;
+	}
+
+	for (const MemoryBlock& block : MemoryBlocks) {
+		vkFreeMemory(Device, block.Memory, Allocator);
+	}
+	MemoryBlocks.clear();
+	FinalBarriers.clear();
+	FinalBarriersWithoutOptional.clear();
+}
+
+void RenderGraph::CullPasses() {
+	// The last pass to write each image, as seen by the pass being visited.
+	std::vector<uint32_t> lastWriter(Resources.size(), NO_PASS);
+	std::vector<std::vector<uint32_t>> dependencies(Passes.size());
+
+	for (uint32_t p = 0; p < Passes.size(); ++p) {
+		for (const Access& access : Passes[p].Accesses) {
+			if (DescribeAccess(access.Type, access.LoadOp).ReadsContents && lastWriter[access.Resource] != NO_PASS) {
+				dependencies[p].push_back(lastWriter[access.Resource]);
+			}
+		}
+		for (const Access& access : Passes[p].Accesses) {
+			if (IsWrite(access.Type)) {
+				lastWriter[access.Resource] = p;
+			}
+		}
+		Passes[p].Culled = !Passes[p].SideEffects && !Passes[p].Optional;
+	}
+
+	for (RenderResource r = 0; r < Resources.size(); ++r) {
+		const Resource& resource = Resources[r];
+		if (resource.Imported && resource.FinalLayout != VK_IMAGE_LAYOUT_UNDEFINED && lastWriter[r] != NO_PASS) {
+			Passes[lastWriter[r]].Culled = false;
+		}
+	}
+
+	// Dependencies always point backwards, so one reverse sweep is enough.
+	for (uint32_t p = static_cast<uint32_t>(Passes.size()); p > 0; --p) {
+		if (!Passes[p - 1].Culled) {
+			for (uint32_t dependency : dependencies[p - 1]) {
+				Passes[dependency].Culled = false;
+			}
+		}
+	}
+
+	for (const Pass& pass : Passes) {
+		if (pass.Culled) {
+			Log::Writef(LogSeverity::Verbose, 0, "Render graph: culled pass \"%s\"", pass.Name.c_str());
+		}
+	}
+}
+
+void RenderGraph::PlanLifetimes() {
+	for (Resource& resource : Resources) {
+		resource.Used = false;
+		resource.Lazy = false;
+		resource.Usage = 0;
+		resource.LastStage = 0;
+		resource.LastWriteAccess = 0;
+	}
+
+	for (uint32_t p = 0; p < Passes.size(); ++p) {
+		Pass& pass = Passes[p];
+		pass.Graphics = false;
+		if (pass.Culled) {
+			continue;
+		}
+
+		for (const Access& access : pass.Accesses) {
+			Resource& resource = Resources[access.Resource];
+			AccessInfo info = DescribeAccess(access.Type, access.LoadOp);
+
+			if (!resource.Used) {
+				resource.FirstPass = p;
+			}
+			// Reads since the last write all have to finish before the next one.
+			if (resource.Used && resource.LastWriteAccess == 0 && info.WriteAccess == 0) {
+				resource.LastStage |= info.Stage;
+			}
+			else {
+				resource.LastStage = info.Stage;
+			}
+			resource.LastWriteAccess = info.WriteAccess;
+			resource.LastPass = p;
+			resource.Used = true;
+			resource.Usage |= info.Usage;
+
+			if (info.Attachment) {
+				if (pass.Graphics && (pass.Extent.width != resource.Extent.width ||
+					pass.Extent.height != resource.Extent.height)) {
+					throw std::runtime_error("Failed to compile render graph, pass attachments differ in size!");
+				}
+				pass.Graphics = true;
+				pass.Extent = resource.Extent;
+			}
+		}
+	}
+
+	// Contents nothing later looks at are discarded. A read-only depth
+	// attachment stores, as DONT_CARE would count as a write.
+	for (uint32_t p = 0; p < Passes.size(); ++p) {
+		for (Access& access : Passes[p].Accesses) {
+			const Resource& resource = Resources[access.Resource];
+			bool output = resource.Imported && resource.FinalLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+			bool store = output || resource.LastPass > p || access.Type == RenderAccess::DepthRead;
+			access.StoreOp = store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		}
+	}
+
+	// An image only a single pass renders to and nothing reads back never
+	// has to leave tile memory.
+	for (Resource& resource : Resources) {
+		if (resource.Imported || !resource.Used || resource.FirstPass != resource.LastPass) {
+			continue;
+		}
+		bool lazy = true;
+		for (const Access& access : Passes[resource.FirstPass].Accesses) {
+			if (&Resources[access.Resource] != &resource) {
+				continue;
+			}
+			lazy = DescribeAccess(access.Type, access.LoadOp).Attachment && access.LoadOp != VK_ATTACHMENT_LOAD_OP_LOAD;
+		}
+		if (lazy) {
+			resource.Lazy = true;
+			resource.Usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+	}
+}
+
+void RenderGraph::AllocateImages() {
+	struct Candidate {
+		RenderResource Resource;
+		VkMemoryRequirements Requirements;
+	};
+	std::vector<Candidate> aliased;
+	VkDeviceSize requestedBytes = 0;
+	VkDeviceSize lazyBytes = 0;
+	uint32_t imageCount = 0;
+
+	for (RenderResource r = 0; r < Resources.size(); ++r) {
+		Resource& resource = Resources[r];
+		if (resource.Imported || !resource.Used) {
+			continue;
+		}
+
+		VkImageCreateInfo imageInfo{ };
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { resource.Extent.width, resource.Extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = resource.Format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = resource.Usage;
+		imageInfo.samples = resource.Samples;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (utils::FunctionFailed(vkCreateImage(Device, &imageInfo, Allocator, &resource.Image))) {
+			throw std::runtime_error("Failed to create render graph image!");
+		}
+		++imageCount;
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(Device, resource.Image, &requirements);
+		requestedBytes += requirements.size;
+
+		uint32_t lazyType = resource.Lazy
+			? FindMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+			: NO_MEMORY_TYPE;
+		if (lazyType != NO_MEMORY_TYPE) {
+			VkMemoryAllocateInfo allocInfo{ };
+			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocInfo.allocationSize = requirements.size;
+			allocInfo.memoryTypeIndex = lazyType;
+			if (utils::FunctionFailed(vkAllocateMemory(Device, &allocInfo, Allocator, &resource.Memory))) {
+				throw std::runtime_error("Failed to allocate render graph image memory!");
+			}
+			vkBindImageMemory(Device, resource.Image, resource.Memory, 0);
+			resource.Previous = r;
+			lazyBytes += requirements.size;
+		}
+		else {
+			aliased.push_back({ r, requirements });
+		}
+	}
+
+	// Largest first, each into the first block that is free for its whole
+	// lifetime and has a compatible memory type.
+	std::sort(aliased.begin(), aliased.end(), [](const Candidate& a, const Candidate& b) {
+		return a.Requirements.size > b.Requirements.size;
+	});
+	for (const Candidate& candidate : aliased) {
+		const Resource& resource = Resources[candidate.Resource];
+		MemoryBlock* target = nullptr;
+		for (MemoryBlock& block : MemoryBlocks) {
+			if ((block.TypeBits & candidate.Requirements.memoryTypeBits) == 0) {
+				continue;
+			}
+			bool overlaps = false;
+			for (RenderResource other : block.Resources) {
+				if (resource.FirstPass <= Resources[other].LastPass && Resources[other].FirstPass <= resource.LastPass) {
+					overlaps = true;
+					break;
+				}
+			}
+			if (!overlaps) {
+				target = &block;
+				break;
+			}
+		}
+		if (target == nullptr) {
+			MemoryBlocks.emplace_back();
+			target = &MemoryBlocks.back();
+			target->TypeBits = candidate.Requirements.memoryTypeBits;
+		}
+		target->Resources.push_back(candidate.Resource);
+		target->Size = std::max(target->Size, candidate.Requirements.size);
+		target->TypeBits &= candidate.Requirements.memoryTypeBits;
+	}
+
+	VkDeviceSize allocatedBytes = lazyBytes;
+	for (MemoryBlock& block : MemoryBlocks) {
+		uint32_t type = FindMemoryType(block.TypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (type == NO_MEMORY_TYPE) {
+			throw std::runtime_error("Failed to find suitable memory type for render graph images!");
+		}
+
+		VkMemoryAllocateInfo allocInfo{ };
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = block.Size;
+		allocInfo.memoryTypeIndex = type;
+		if (utils::FunctionFailed(vkAllocateMemory(Device, &allocInfo, Allocator, &block.Memory))) {
+			throw std::runtime_error("Failed to allocate render graph image memory!");
+		}
+		allocatedBytes += block.Size;
+
+		// Each image's first use waits on the one before it in the block,
+		// and the first on the last from the previous frame.
+		std::sort(block.Resources.begin(), block.Resources.end(), [this](RenderResource a, RenderResource b) {
+			return Resources[a].FirstPass < Resources[b].FirstPass;
+		});
+		for (size_t i = 0; i < block.Resources.size(); ++i) {
+			Resource& resource = Resources[block.Resources[i]];
+			resource.Previous = block.Resources[(i + block.Resources.size() - 1) % block.Resources.size()];
+			vkBindImageMemory(Device, resource.Image, block.Memory, 0);
+		}
+	}
+
+	for (Resource& resource : Resources) {
+		if (!resource.Imported && resource.Used) {
+			resource.View = utils::CreateImageView(Device, resource.Image, resource.Format,
+				AspectForFormat(resource.Format), 1, Allocator);
+		}
+	}
+
+	Log::Writef(LogSeverity::Verbose, 0,
+		"Render graph: %u images, %llu bytes requested, %llu bytes allocated (%llu lazily), %zu aliasing blocks",
+		imageCount, static_cast<unsigned long long>(requestedBytes), static_cast<unsigned long long>(allocatedBytes),
+		static_cast<unsigned long long>(lazyBytes), MemoryBlocks.size());
+}
+
+void RenderGraph::PlanBarriers(bool withOptional) {
+	struct State {
+		VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags2 Stage = 0;
+		VkAccessFlags2 WriteAccess = 0;
+		bool Touched = false;
+	};
+	std::vector<State> states(Resources.size());
+
+	for (Pass& pass : Passes) {
+		if (pass.Culled || (pass.Optional && !withOptional)) {
+			continue;
+		}
+		std::vector<PlannedBarrier>& barriers = withOptional ? pass.Barriers : pass.BarriersWithoutOptional;
+
+		for (const Access& access : pass.Accesses) {
+			const Resource& resource = Resources[access.Resource];
+			AccessInfo info = DescribeAccess(access.Type, access.LoadOp);
+			State& state = states[access.Resource];
+			// Skipping a pass that wrote would leave later passes reading
+			// stale contents.
+			if (pass.Optional && info.WriteAccess != 0) {
+				throw std::runtime_error("Failed to compile render graph, optional pass \"" + pass.Name + "\" writes!");
+			}
+
+			PlannedBarrier barrier{ };
+			barrier.Resource = access.Resource;
+			barrier.NewLayout = info.Layout;
+			barrier.DstStage = info.Stage;
+			barrier.DstAccess = info.Access;
+
+			bool needed;
+			if (!state.Touched && resource.Imported) {
+				barrier.OldLayout = resource.InitialLayout;
+				barrier.SrcStage = resource.InitialStage;
+				barrier.SrcAccess = 0;
+				needed = resource.InitialLayout != info.Layout || resource.InitialStage != 0;
+			}
+			else if (!state.Touched) {
+				// The contents are never kept across frames, so start from
+				// UNDEFINED and only wait for the memory's previous user.
+				const Resource& previous = Resources[resource.Previous];
+				barrier.OldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				barrier.SrcStage = previous.LastStage;
+				barrier.SrcAccess = previous.LastWriteAccess;
+				needed = true;
+			}
+			else {
+				barrier.OldLayout = state.Layout;
+				barrier.SrcStage = state.Stage;
+				barrier.SrcAccess = state.WriteAccess;
+				// Reads in the same layout need no barrier between them.
+				needed = state.Layout != info.Layout || state.WriteAccess != 0 || info.WriteAccess != 0;
+			}
+
+			if (needed) {
+				barriers.push_back(barrier);
+				state.Stage = info.Stage;
+			}
+			else {
+				state.Stage |= info.Stage;
+			}
+			state.WriteAccess = info.WriteAccess;
+			state.Layout = info.Layout;
+			state.Touched = true;
+		}
+	}
+
+	for (RenderResource r = 0; r < Resources.size(); ++r) {
+		const Resource& resource = Resources[r];
+		const State& state = states[r];
+		if (!resource.Imported || !state.Touched || resource.FinalLayout == VK_IMAGE_LAYOUT_UNDEFINED ||
+			resource.FinalLayout == state.Layout) {
+			continue;
+		}
+
+		PlannedBarrier barrier{ };
+		barrier.Resource = r;
+		barrier.OldLayout = state.Layout;
+		barrier.NewLayout = resource.FinalLayout;
+		barrier.SrcStage = state.Stage;
+		barrier.SrcAccess = state.WriteAccess;
+		// Nothing later in the command buffer waits on this; whatever
+		// consumes the output has to wait on the whole submit, e.g. a
+		// semaphore signalled at ALL_COMMANDS.
+		barrier.DstStage = VK_PIPELINE_STAGE_2_NONE;
+		barrier.DstAccess = 0;
+		(withOptional ? FinalBarriers : FinalBarriersWithoutOptional).push_back(barrier);
+	}
+}
+
+void RenderGraph::CreateRenderPass(Pass& pass) {
+	// The graph records every transition as a barrier, so each attachment
+	// starts and ends the render pass in the layout it is used in.
+	std::vector<VkAttachmentDescription> attachments;
+	std::vector<VkAttachmentReference> colorRefs;
+	std::vector<VkAttachmentReference> resolveRefs;
+	VkAttachmentReference depthRef{ VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED };
+
+	for (const Access& access : pass.Accesses) {
+		AccessInfo info = DescribeAccess(access.Type, access.LoadOp);
+		if (!info.Attachment || access.Type == RenderAccess::ColorResolve) {
+			continue;
+		}
+
+		VkAttachmentDescription attachment{ };
+		attachment.format = Resources[access.Resource].Format;
+		attachment.samples = Resources[access.Resource].Samples;
+		attachment.loadOp = access.LoadOp;
+		attachment.storeOp = access.StoreOp;
+		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.initialLayout = info.Layout;
+		attachment.finalLayout = info.Layout;
+		VkAttachmentReference ref{ static_cast<uint32_t>(attachments.size()), info.Layout };
+		attachments.push_back(attachment);
+
+		if (access.Type == RenderAccess::ColorWrite) {
+			colorRefs.push_back(ref);
+			resolveRefs.push_back({ VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+
+			for (const Access& resolve : pass.Accesses) {
+				if (resolve.Type == RenderAccess::ColorResolve && resolve.ResolveSource == access.Resource) {
+					VkAttachmentDescription target{ };
+					target.format = Resources[resolve.Resource].Format;
+					target.samples = Resources[resolve.Resource].Samples;
+					target.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+					target.storeOp = resolve.StoreOp;
+					target.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+					target.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+					target.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+					target.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+					resolveRefs.back() = { static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+					attachments.push_back(target);
+				}
+			}
+		}
+		else {
+			depthRef = ref;
+		}
+	}
+
+	bool resolves = std::any_of(resolveRefs.begin(), resolveRefs.end(),
+		[](const VkAttachmentReference& ref) { return ref.attachment != VK_ATTACHMENT_UNUSED; });
+
+	VkSubpassDescription subpass{ };
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+	subpass.pColorAttachments = colorRefs.data();
+	subpass.pResolveAttachments = resolves ? resolveRefs.data() : nullptr;
+	subpass.pDepthStencilAttachment = depthRef.attachment != VK_ATTACHMENT_UNUSED ? &depthRef : nullptr;
+
+	VkRenderPassCreateInfo renderPassInfo{ };
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	renderPassInfo.pAttachments = attachments.data();
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+
+	if (utils::FunctionFailed(vkCreateRenderPass(Device, &renderPassInfo, Allocator, &pass.RenderPass))) {
+		throw std::runtime_error("Failed to create render pass!");
+	}
+}
+
+void RenderGraph::BeginPass(VkCommandBuffer commandBuffer, Pass& pass) {
+	VkExtent2D area = pass.Extent;
+	if (pass.RenderArea.width != 0 && pass.RenderArea.height != 0) {
+		area.width = std::min(pass.RenderArea.width, pass.Extent.width);
+		area.height = std::min(pass.RenderArea.height, pass.Extent.height);
+	}
+
+	if (ModernPath) {
+		std::vector<VkRenderingAttachmentInfo> colorAttachments;
+		VkRenderingAttachmentInfo depthAttachment{ };
+		bool hasDepth = false;
+
+		for (const Access& access : pass.Accesses) {
+			if (access.Type != RenderAccess::ColorWrite && access.Type != RenderAccess::DepthWrite &&
+				access.Type != RenderAccess::DepthRead) {
+				continue;
+			}
+
+			VkRenderingAttachmentInfo attachment{ };
+			attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			attachment.imageView = Resources[access.Resource].View;
+			attachment.imageLayout = DescribeAccess(access.Type, access.LoadOp).Layout;
+			attachment.loadOp = access.LoadOp;
+			attachment.storeOp = access.StoreOp;
+			attachment.clearValue = access.ClearValue;
+
+			if (access.Type == RenderAccess::ColorWrite) {
+				for (const Access& resolve : pass.Accesses) {
+					if (resolve.Type == RenderAccess::ColorResolve && resolve.ResolveSource == access.Resource) {
+						attachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+						attachment.resolveImageView = Resources[resolve.Resource].View;
+						attachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+					}
+				}
+				colorAttachments.push_back(attachment);
+			}
+			else {
+				depthAttachment = attachment;
+				hasDepth = true;
+			}
+		}
+
+		VkRenderingInfo renderingInfo{ };
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		renderingInfo.renderArea.offset = { 0, 0 };
+		renderingInfo.renderArea.extent = area;
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+		renderingInfo.pColorAttachments = colorAttachments.data();
+		renderingInfo.pDepthAttachment = hasDepth ? &depthAttachment : nullptr;
+
+		vkCmdBeginRendering(commandBuffer, &renderingInfo);
+		return;
+	}
+
+	// Clear values are indexed by attachment, in the order CreateRenderPass()
+	// laid them out.
+	std::vector<VkClearValue> clearValues;
+	for (const Access& access : pass.Accesses) {
+		if (access.Type == RenderAccess::ColorWrite || access.Type == RenderAccess::DepthWrite ||
+			access.Type == RenderAccess::DepthRead) {
+			clearValues.push_back(access.ClearValue);
+		}
+		if (access.Type == RenderAccess::ColorWrite) {
+			for (const Access& resolve : pass.Accesses) {
+				if (resolve.Type == RenderAccess::ColorResolve && resolve.ResolveSource == access.Resource) {
+					clearValues.push_back(VkClearValue{ });
+				}
+			}
+		}
+	}
+
+	VkRenderPassBeginInfo renderPassInfo{ };
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = pass.RenderPass;
+	renderPassInfo.framebuffer = GetFramebuffer(pass);
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = area;
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void RenderGraph::EndPass(VkCommandBuffer commandBuffer) {
+	if (ModernPath) {
+		vkCmdEndRendering(commandBuffer);
+	}
+	else {
+		vkCmdEndRenderPass(commandBuffer);
+	}
+}
+
+VkFramebuffer RenderGraph::GetFramebuffer(Pass& pass) {
+	std::vector<VkImageView> views;
+	for (const Access& access : pass.Accesses) {
+		if (access.Type == RenderAccess::ColorWrite || access.Type == RenderAccess::DepthWrite ||
+			access.Type == RenderAccess::DepthRead) {
+			views.push_back(Resources[access.Resource].View);
+		}
+		if (access.Type == RenderAccess::ColorWrite) {
+			for (const Access& resolve : pass.Accesses) {
+				if (resolve.Type == RenderAccess::ColorResolve && resolve.ResolveSource == access.Resource) {
+					views.push_back(Resources[resolve.Resource].View);
+				}
+			}
+		}
+	}
+
+	// Imported images change from frame to frame, so there is one
+	// framebuffer per combination seen, e.g. per swapchain image.
+	for (const Framebuffer& framebuffer : pass.Framebuffers) {
+		if (framebuffer.Views == views) {
+			return framebuffer.Handle;
+		}
+	}
+
+	VkFramebufferCreateInfo framebufferInfo{ };
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = pass.RenderPass;
+	framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+	framebufferInfo.pAttachments = views.data();
+	framebufferInfo.width = pass.Extent.width;
+	framebufferInfo.height = pass.Extent.height;
+	framebufferInfo.layers = 1;
+
+	VkFramebuffer handle;
+	if (utils::FunctionFailed(vkCreateFramebuffer(Device, &framebufferInfo, Allocator, &handle))) {
+		throw std::runtime_error("Failed to create framebuffer!");
+	}
+	pass.Framebuffers.push_back({ views, handle });
+	return handle;
+}
+
+void RenderGraph::AddBarrier(BarrierBatch& barriers, const PlannedBarrier& barrier) const {
+	const Resource& resource = Resources[barrier.Resource];
+	barriers.AddImage(resource.Image, AspectForFormat(resource.Format), barrier.OldLayout, barrier.NewLayout,
+		barrier.SrcStage, barrier.SrcAccess, barrier.DstStage, barrier.DstAccess);
+}
+
+uint32_t RenderGraph::FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const {
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &memProperties);
+
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i) {
+		if ((typeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+	return NO_MEMORY_TYPE;
+}
@@ -15,6 +15,9 @@ VkShaderModule Shader::GetVert() const {
 VkShaderModule Shader::GetFrag() const {
 	return Frag;
 }
+VkShaderModule Shader::GetComp() const {
+	return Comp;
+}
 
 void Shader::SetVertShaderFilename(const std::string& filename) {
 	vertFilename = filename;
@@ -22,15 +25,28 @@ void Shader::SetVertShaderFilename(const std::string& filename) {
 void Shader::SetFragShaderFilename(const std::string& filename) {
 	fragFilename = filename;
 }
+void Shader::SetCompShaderFilename(const std::string& filename) {
+	compFilename = filename;
+}
 
-void Shader::CompileShader(const VkDevice& device) {
-	Vert = CompileShaderModule(device, utils::readFile(vertFilename));
-	Frag = CompileShaderModule(device, utils::readFile(fragFilename));
+void Shader::CompileShader(const VkDevice& device, const VkAllocationCallbacks* allocator) {
+	Allocator = allocator;
+	if (!vertFilename.empty()) {
+		Vert = CompileShaderModule(device, utils::readFile(vertFilename));
+	}
+	if (!fragFilename.empty()) {
+		Frag = CompileShaderModule(device, utils::readFile(fragFilename));
+	}
+	if (!compFilename.empty()) {
+		Comp = CompileShaderModule(device, utils::readFile(compFilename));
+	}
 }
 
 void Shader::DestroyShader(const VkDevice& device) {
-	vkDestroyShaderModule(device, Frag, nullptr);
-	vkDestroyShaderModule(device, Vert, nullptr);
+	vkDestroyShaderModule(device, Comp, Allocator);
+	vkDestroyShaderModule(device, Frag, Allocator);
+	vkDestroyShaderModule(device, Vert, Allocator);
+	Comp = Frag = Vert = VK_NULL_HANDLE;
 }
 
 // ------------------------
@@ -43,7 +59,7 @@ VkShaderModule Shader::CompileShaderModule(const VkDevice& device, const std::ve
 	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
 	VkShaderModule shaderModule;
-	if (utils::FunctionFailed(vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule))) {
+	if (utils::FunctionFailed(vkCreateShaderModule(device, &createInfo, Allocator, &shaderModule))) {
 		throw std::runtime_error("Failed to create shader module!");
 	}
 
@@ -0,0 +1,161 @@
+#include "Simulation.h"
+
+#include <algorithm>
+
+using Clock = std::chrono::steady_clock;
+
+static const float TICK_INTERVAL = 1.0f / Simulation::TICK_RATE;
+
+// ------------------------
+// Public methods
+// ------------------------
+Simulation::~Simulation() {
+	Stop();
+}
+
+void Simulation::Start(const vec3_t origin, const vec3_t angles) {
+	Stop();
+
+	State = SimSnapshot{ };
+	VectorCopy(origin, State.Origin);
+	Command = UserCommand{ };
+	VectorCopy(angles, Command.ViewAngles);
+	Previous = Current = State;
+
+	StartTime = Clock::now();
+	Running.store(true, std::memory_order_release);
+	Thread = std::thread(&Simulation::Run, this);
+}
+
+void Simulation::Stop() {
+	if (Running.exchange(false)) {
+		Thread.join();
+	}
+}
+
+void Simulation::SubmitCommand(const UserCommand& command) {
+	Commands.BeginWrite() = command;
+	Commands.Publish();
+}
+
+void Simulation::SampleView(vec3_t origin) {
+	if (Snapshots.Acquire()) {
+		Previous = Current;
+		Current = Snapshots.Read();
+	}
+
+	// Drawing a tick behind means there is nearly always a newer snapshot
+	// to interpolate towards.
+	double renderTime = std::chrono::duration<double>(Clock::now() - StartTime).count() - TICK_INTERVAL;
+	double span = Current.Time - Previous.Time;
+	float frac = 1.0f;
+	if (span > 0.0) {
+		frac = static_cast<float>(std::clamp((renderTime - Previous.Time) / span, 0.0, 1.0));
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		origin[i] = Previous.Origin[i] + frac * (Current.Origin[i] - Previous.Origin[i]);
+	}
+}
+
+uint64_t Simulation::GetTick() const {
+	return Current.Tick;
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void Simulation::Run() {
+	const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(TICK_INTERVAL));
+	Clock::time_point nextTick = StartTime + interval;
+
+	while (Running.load(std::memory_order_acquire)) {
+		Clock::time_point now = Clock::now();
+
+		uint32_t ticks = 0;
+		while (now >= nextTick && ticks < MAX_CATCHUP_TICKS) {
+			if (Commands.Acquire()) {
+				Command = Commands.Read();
+			}
+			Tick(TICK_INTERVAL);
+			nextTick += interval;
+			++ticks;
+		}
+
+		if (now >= nextTick) {
+			// Too far behind to catch up: skip the backlog rather than
+			// spiralling, keeping the clock in step.
+			uint64_t skipped = (now - nextTick) / interval + 1;
+			State.Time += skipped * TICK_INTERVAL;
+			nextTick += skipped * interval;
+		}
+
+		if (ticks != 0) {
+			Publish();
+		}
+		std::this_thread::sleep_until(nextTick);
+	}
+}
+
+void Simulation::Tick(float frameTime) {
+	vec3_t forward, right, up;
+	AngleVectors(Command.ViewAngles, forward, right, up);
+
+	vec3_t wishVel;
+	for (int i = 0; i < 3; ++i) {
+		wishVel[i] = forward[i] * Command.ForwardMove + right[i] * Command.SideMove;
+	}
+	wishVel[2] += Command.UpMove;
+
+	float wishSpeed = std::sqrt(DotProduct(wishVel, wishVel));
+	vec3_t wishDir = { 0.0f, 0.0f, 0.0f };
+	if (wishSpeed > 0.0f) {
+		for (int i = 0; i < 3; ++i) {
+			wishDir[i] = wishVel[i] / wishSpeed;
+		}
+	}
+	wishSpeed = std::min(wishSpeed, MAX_SPEED);
+
+	Friction(frameTime);
+	Accelerate(wishDir, wishSpeed, frameTime);
+
+	for (int i = 0; i < 3; ++i) {
+		State.Origin[i] += State.Velocity[i] * frameTime;
+	}
+	++State.Tick;
+	State.Time += frameTime;
+}
+
+void Simulation::Publish() {
+	Snapshots.BeginWrite() = State;
+	Snapshots.Publish();
+}
+
+// SV_UserFriction without the ledge check, as there is no world to test.
+void Simulation::Friction(float frameTime) {
+	float speed = std::sqrt(DotProduct(State.Velocity, State.Velocity));
+	if (speed == 0.0f) {
+		return;
+	}
+
+	float control = speed < STOP_SPEED ? STOP_SPEED : speed;
+	float newSpeed = std::max(speed - frameTime * control * FRICTION, 0.0f);
+	float scale = newSpeed / speed;
+	for (int i = 0; i < 3; ++i) {
+		State.Velocity[i] *= scale;
+	}
+}
+
+// SV_Accelerate.
+void Simulation::Accelerate(const vec3_t wishDir, float wishSpeed, float frameTime) {
+	float currentSpeed = DotProduct(State.Velocity, wishDir);
+	float addSpeed = wishSpeed - currentSpeed;
+	if (addSpeed <= 0.0f) {
+		return;
+	}
+
+	float accelSpeed = std::min(ACCELERATE * frameTime * wishSpeed, addSpeed);
+	for (int i = 0; i < 3; ++i) {
+		State.Velocity[i] += accelSpeed * wishDir[i];
+	}
+}
@@ -0,0 +1,314 @@
+#include "SoundMixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Log.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOUND_SSE2
+#endif
+
+namespace {
+	// Adds count frames of the sample, starting at the 32.32 position, into
+	// the two planar buffers with the given gains.
+	void Resample(const float* data, uint64_t position, uint64_t step, uint32_t count,
+		float leftGain, float rightGain, float* outLeft, float* outRight) {
+		uint32_t i = 0;
+#ifdef SOUND_SSE2
+		const __m128 left = _mm_set1_ps(leftGain);
+		const __m128 right = _mm_set1_ps(rightGain);
+		// The fraction drops its lowest bit to fit a signed conversion.
+		const __m128 fractionScale = _mm_set1_ps(1.0f / 2147483648.0f);
+		for (; i + 4 <= count; i += 4) {
+			const uint64_t p0 = position;
+			const uint64_t p1 = p0 + step;
+			const uint64_t p2 = p1 + step;
+			const uint64_t p3 = p2 + step;
+			position = p3 + step;
+
+			// SSE2 has no gather, so the frames are loaded one at a time and
+			// everything after is done four frames wide.
+			const float* s0 = data + (p0 >> 32);
+			const float* s1 = data + (p1 >> 32);
+			const float* s2 = data + (p2 >> 32);
+			const float* s3 = data + (p3 >> 32);
+			const __m128 a = _mm_set_ps(s3[0], s2[0], s1[0], s0[0]);
+			const __m128 b = _mm_set_ps(s3[1], s2[1], s1[1], s0[1]);
+			const __m128i fraction = _mm_set_epi32(
+				static_cast<int32_t>(static_cast<uint32_t>(p3) >> 1), static_cast<int32_t>(static_cast<uint32_t>(p2) >> 1),
+				static_cast<int32_t>(static_cast<uint32_t>(p1) >> 1), static_cast<int32_t>(static_cast<uint32_t>(p0) >> 1));
+			const __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(fraction), fractionScale);
+			const __m128 s = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+
+			_mm_storeu_ps(outLeft + i, _mm_add_ps(_mm_loadu_ps(outLeft + i), _mm_mul_ps(s, left)));
+			_mm_storeu_ps(outRight + i, _mm_add_ps(_mm_loadu_ps(outRight + i), _mm_mul_ps(s, right)));
+		}
+#endif
+		for (; i < count; ++i) {
+			const float* s = data + (position >> 32);
+			const float t = static_cast<float>(static_cast<uint32_t>(position) >> 1) * (1.0f / 2147483648.0f);
+			const float value = s[0] + (s[1] - s[0]) * t;
+			outLeft[i] += value * leftGain;
+			outRight[i] += value * rightGain;
+			position += step;
+		}
+	}
+}
+
+// ------------------------
+// Public methods
+// ------------------------
+void SoundMixer::Init(uint32_t outputRate) {
+	OutputRate = outputRate;
+	for (Channel& channel : Channels) {
+		channel = Channel{ };
+	}
+
+	// Looking down +X, as AngleVectors gives for zero angles, until the
+	// game moves the listener.
+	CurrentListener = Listener{ };
+	CurrentListener.Right[1] = -1.0f;
+	CurrentListener.Entity = -1;
+}
+
+uint32_t SoundMixer::GetOutputRate() const {
+	return OutputRate;
+}
+
+void SoundMixer::PadSample(SoundSample& sample) {
+	sample.Length = static_cast<uint32_t>(std::min<size_t>(sample.Length, sample.Data.size()));
+	sample.Data.resize(sample.Length);
+	if (sample.LoopStart >= static_cast<int32_t>(sample.Length)) {
+		sample.LoopStart = -1;
+	}
+	// Interpolating past the end fades to silence, or into the loop.
+	sample.Data.push_back(sample.LoopStart >= 0 ? sample.Data[sample.LoopStart] : 0.0f);
+}
+
+void SoundMixer::StartSound(const SoundStart& start) {
+	if (start.Sample == nullptr || start.Sample->Length == 0 || start.Sample->Rate == 0 || start.Volume <= 0.0f) {
+		return;
+	}
+	Command command{ };
+	command.Type = CommandType::Start;
+	command.Start = start;
+	PushCommand(command);
+}
+
+void SoundMixer::StopSound(int32_t entity, int32_t channel) {
+	Command command{ };
+	command.Type = CommandType::Stop;
+	command.Start.Entity = entity;
+	command.Start.Channel = channel;
+	PushCommand(command);
+}
+
+void SoundMixer::StopAllSounds() {
+	Command command{ };
+	command.Type = CommandType::StopAll;
+	PushCommand(command);
+}
+
+void SoundMixer::SetListener(const vec3_t origin, const vec3_t angles, int32_t entity) {
+	vec3_t forward, up;
+	Listener& listener = ListenerUpdates.BeginWrite();
+	VectorCopy(origin, listener.Origin);
+	AngleVectors(angles, forward, listener.Right, up);
+	listener.Entity = entity;
+	ListenerUpdates.Publish();
+}
+
+void SoundMixer::Mix(int16_t* out, uint32_t frames) {
+	if (ListenerUpdates.Acquire()) {
+		CurrentListener = ListenerUpdates.Read();
+	}
+	ApplyCommands();
+
+	// Respatialised once per call, as S_Update does once per frame.
+	uint32_t active = 0;
+	for (Channel& channel : Channels) {
+		if (channel.Sample != nullptr) {
+			Spatialize(channel);
+			++active;
+		}
+	}
+	if (active > PeakChannels.load(std::memory_order_relaxed)) {
+		PeakChannels.store(active, std::memory_order_relaxed);
+	}
+	MixedFrames.fetch_add(frames, std::memory_order_relaxed);
+
+	while (frames > 0) {
+		const uint32_t count = frames < MIX_BLOCK ? frames : MIX_BLOCK;
+		std::fill_n(MixLeft, count, 0.0f);
+		std::fill_n(MixRight, count, 0.0f);
+		for (Channel& channel : Channels) {
+			if (channel.Sample != nullptr) {
+				MixChannel(channel, count);
+			}
+		}
+		WriteOutput(out, count);
+		out += count * 2;
+		frames -= count;
+	}
+}
+
+void SoundMixer::Report() const {
+	Log::Writef(LogSeverity::Info, 0, "Sound: %u Hz, %.1f s mixed, peak %u of %u channels, %llu stolen, %llu commands dropped",
+		OutputRate, OutputRate > 0 ? static_cast<double>(MixedFrames.load()) / OutputRate : 0.0, PeakChannels.load(),
+		MAX_CHANNELS, static_cast<unsigned long long>(StolenChannels.load()), static_cast<unsigned long long>(DroppedCommands));
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void SoundMixer::PushCommand(const Command& command) {
+	// A full queue means the audio thread has stalled; dropping the sound
+	// is better than stalling the game with it.
+	if (!Commands.Push(command)) {
+		++DroppedCommands;
+	}
+}
+
+void SoundMixer::ApplyCommands() {
+	Command command;
+	while (Commands.Pop(command)) {
+		const SoundStart& start = command.Start;
+		switch (command.Type) {
+		case CommandType::Start: {
+			Channel* channel = PickChannel(start.Entity, start.Channel);
+			if (channel == nullptr) {
+				break;
+			}
+			channel->Sample = start.Sample;
+			channel->Position = 0;
+			channel->Step = (static_cast<uint64_t>(start.Sample->Rate) << 32) / OutputRate;
+			channel->Entity = start.Entity;
+			channel->EntityChannel = start.Channel;
+			VectorCopy(start.Origin, channel->Origin);
+			channel->Volume = start.Volume;
+			channel->DistanceScale = start.Attenuation / NOMINAL_CLIP_DISTANCE;
+			Spatialize(*channel);
+			// Out of earshot already; S_StartSound drops these too.
+			if (channel->LeftVolume <= 0.0f && channel->RightVolume <= 0.0f && start.Sample->LoopStart < 0) {
+				channel->Sample = nullptr;
+			}
+			break;
+		}
+		case CommandType::Stop:
+			for (Channel& channel : Channels) {
+				if (channel.Sample != nullptr && channel.Entity == start.Entity && channel.EntityChannel == start.Channel) {
+					channel.Sample = nullptr;
+				}
+			}
+			break;
+		case CommandType::StopAll:
+			for (Channel& channel : Channels) {
+				channel.Sample = nullptr;
+			}
+			break;
+		}
+	}
+}
+
+SoundMixer::Channel* SoundMixer::PickChannel(int32_t entity, int32_t entityChannel) {
+	Channel* pick = nullptr;
+	uint64_t pickLife = std::numeric_limits<uint64_t>::max();
+	for (Channel& channel : Channels) {
+		if (entityChannel != 0 && channel.Entity == entity &&
+			(channel.EntityChannel == entityChannel || entityChannel == -1)) {
+			return &channel;
+		}
+		if (channel.Sample == nullptr) {
+			if (pickLife > 0) {
+				pick = &channel;
+				pickLife = 0;
+			}
+			continue;
+		}
+		if (channel.Entity == CurrentListener.Entity && entity != CurrentListener.Entity) {
+			continue;
+		}
+		if (channel.Sample->LoopStart >= 0) {
+			continue;
+		}
+
+		const uint64_t life = ((static_cast<uint64_t>(channel.Sample->Length) << 32) - channel.Position) / channel.Step;
+		if (life < pickLife) {
+			pick = &channel;
+			pickLife = life;
+		}
+	}
+	if (pick != nullptr && pick->Sample != nullptr) {
+		StolenChannels.fetch_add(1, std::memory_order_relaxed);
+	}
+	return pick;
+}
+
+void SoundMixer::Spatialize(Channel& channel) const {
+	if (channel.Entity == CurrentListener.Entity) {
+		channel.LeftVolume = channel.RightVolume = channel.Volume;
+		return;
+	}
+
+	vec3_t source;
+	for (int c = 0; c < 3; ++c) {
+		source[c] = channel.Origin[c] - CurrentListener.Origin[c];
+	}
+	const float length = std::sqrt(DotProduct(source, source));
+	const float distance = length * channel.DistanceScale;
+	const float dot = length > 0.0f ? DotProduct(CurrentListener.Right, source) / length : 0.0f;
+
+	channel.LeftVolume = std::max(0.0f, channel.Volume * (1.0f - distance) * (1.0f - dot));
+	channel.RightVolume = std::max(0.0f, channel.Volume * (1.0f - distance) * (1.0f + dot));
+}
+
+void SoundMixer::MixChannel(Channel& channel, uint32_t frames) {
+	const SoundSample& sample = *channel.Sample;
+	const uint64_t end = static_cast<uint64_t>(sample.Length) << 32;
+	const bool audible = channel.LeftVolume > 0.0f || channel.RightVolume > 0.0f;
+
+	uint32_t offset = 0;
+	while (offset < frames) {
+		// Frames until the position passes the end of the sample.
+		const uint64_t left = (end - channel.Position + channel.Step - 1) / channel.Step;
+		const uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(left, frames - offset));
+		if (audible) {
+			Resample(sample.Data.data(), channel.Position, channel.Step, count,
+				channel.LeftVolume, channel.RightVolume, MixLeft + offset, MixRight + offset);
+		}
+		channel.Position += channel.Step * count;
+		offset += count;
+
+		if (channel.Position >= end) {
+			if (sample.LoopStart < 0) {
+				channel.Sample = nullptr;
+				return;
+			}
+			const uint64_t loopLength = end - (static_cast<uint64_t>(sample.LoopStart) << 32);
+			channel.Position = end - loopLength + (channel.Position - end) % loopLength;
+		}
+	}
+}
+
+void SoundMixer::WriteOutput(int16_t* out, uint32_t frames) const {
+	uint32_t i = 0;
+#ifdef SOUND_SSE2
+	const __m128 scale = _mm_set1_ps(32767.0f);
+	const __m128 minimum = _mm_set1_ps(-32768.0f);
+	// Clamped before converting, as out-of-range conversions give INT_MIN.
+	for (; i + 4 <= frames; i += 4) {
+		const __m128i left = _mm_cvtps_epi32(_mm_max_ps(minimum, _mm_min_ps(scale, _mm_mul_ps(_mm_load_ps(MixLeft + i), scale))));
+		const __m128i right = _mm_cvtps_epi32(_mm_max_ps(minimum, _mm_min_ps(scale, _mm_mul_ps(_mm_load_ps(MixRight + i), scale))));
+		const __m128i left16 = _mm_packs_epi32(left, left);
+		const __m128i right16 = _mm_packs_epi32(right, right);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm_unpacklo_epi16(left16, right16));
+	}
+#endif
+	for (; i < frames; ++i) {
+		out[i * 2] = static_cast<int16_t>(std::lrint(std::clamp(MixLeft[i] * 32767.0f, -32768.0f, 32767.0f)));
+		out[i * 2 + 1] = static_cast<int16_t>(std::lrint(std::clamp(MixRight[i] * 32767.0f, -32768.0f, 32767.0f)));
+	}
+}
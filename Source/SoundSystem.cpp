@@ -0,0 +1,180 @@
+#include "SoundSystem.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "Log.h"
+#include "Utils.h"
+
+namespace {
+	uint32_t ReadU32(const char* data) {
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	uint16_t ReadU16(const char* data) {
+		uint16_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+}
+
+// ------------------------
+// Public methods
+// ------------------------
+void SoundSystem::Init() {
+	if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+		Log::Writef(LogSeverity::Warning, 0, "SDL failed to initialise audio, running without sound: %s", SDL_GetError());
+		return;
+	}
+	SubsystemStarted = true;
+
+	SDL_AudioSpec desired{ };
+	desired.freq = OUTPUT_RATE;
+	desired.format = AUDIO_S16SYS;
+	desired.channels = 2;
+	desired.samples = DEVICE_FRAMES;
+	desired.callback = Callback;
+	desired.userdata = this;
+
+	// SDL converts to the device's format and channel count itself; the
+	// rate is left to the device so SDL doesn't resample the mix again.
+	SDL_AudioSpec obtained{ };
+	Device = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+	if (Device == 0) {
+		Log::Writef(LogSeverity::Warning, 0, "SDL failed to open an audio device, running without sound: %s", SDL_GetError());
+		return;
+	}
+
+	Mixer.Init(static_cast<uint32_t>(obtained.freq));
+	SDL_PauseAudioDevice(Device, 0);
+	Log::Writef(LogSeverity::Info, 0, "Sound: %d Hz, %u frame buffer, %u channels", obtained.freq, obtained.samples,
+		SoundMixer::MAX_CHANNELS);
+}
+
+void SoundSystem::Destroy() {
+	// Waits for a callback in progress, so the mixer is ours again after.
+	if (Device != 0) {
+		SDL_CloseAudioDevice(Device);
+		Device = 0;
+	}
+	if (SubsystemStarted) {
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		SubsystemStarted = false;
+	}
+	Samples.clear();
+}
+
+bool SoundSystem::IsAvailable() const {
+	return Device != 0;
+}
+
+const SoundSample* SoundSystem::LoadSound(const std::string& filename, bool forceLoop) {
+	auto sample = std::make_unique<SoundSample>();
+	ParseWav(utils::readFile(filename), filename, *sample);
+	if (forceLoop && sample->LoopStart < 0) {
+		sample->LoopStart = 0;
+	}
+	SoundMixer::PadSample(*sample);
+
+	Samples.push_back(std::move(sample));
+	return Samples.back().get();
+}
+
+void SoundSystem::StartSound(const SoundStart& start) {
+	if (IsAvailable()) {
+		Mixer.StartSound(start);
+	}
+}
+
+void SoundSystem::StopSound(int32_t entity, int32_t channel) {
+	if (IsAvailable()) {
+		Mixer.StopSound(entity, channel);
+	}
+}
+
+void SoundSystem::StopAllSounds() {
+	if (IsAvailable()) {
+		Mixer.StopAllSounds();
+	}
+}
+
+void SoundSystem::SetListener(const vec3_t origin, const vec3_t angles, int32_t entity) {
+	if (IsAvailable()) {
+		Mixer.SetListener(origin, angles, entity);
+	}
+}
+
+void SoundSystem::Report() const {
+	// Only a mixer that has had a device has anything to say.
+	if (Mixer.GetOutputRate() > 0) {
+		Mixer.Report();
+	}
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void SDLCALL SoundSystem::Callback(void* userdata, Uint8* stream, int length) {
+	SoundSystem* sound = static_cast<SoundSystem*>(userdata);
+	sound->Mixer.Mix(reinterpret_cast<int16_t*>(stream), static_cast<uint32_t>(length) / (2 * sizeof(int16_t)));
+}
+
+void SoundSystem::ParseWav(const std::vector<char>& file, const std::string& filename, SoundSample& sample) {
+	if (file.size() < 12 || std::memcmp(file.data(), "RIFF", 4) != 0 || std::memcmp(file.data() + 8, "WAVE", 4) != 0) {
+		throw std::runtime_error("Failed to load " + filename + ", it is not a WAV file!");
+	}
+
+	uint16_t bits = 0;
+	const char* data = nullptr;
+	uint32_t dataSize = 0;
+	size_t offset = 12;
+	while (offset + 8 <= file.size()) {
+		const char* chunk = file.data() + offset;
+		const uint32_t size = ReadU32(chunk + 4);
+		if (size > file.size() - offset - 8) {
+			throw std::runtime_error("Failed to load " + filename + ", a chunk runs past the end of the file!");
+		}
+
+		if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+			if (ReadU16(chunk + 8) != 1) {
+				throw std::runtime_error("Failed to load " + filename + ", only PCM is supported!");
+			}
+			if (ReadU16(chunk + 10) != 1) {
+				throw std::runtime_error("Failed to load " + filename + ", only mono is supported!");
+			}
+			sample.Rate = ReadU32(chunk + 12);
+			bits = ReadU16(chunk + 22);
+		}
+		// GetWavinfo takes the loop start from the first cue point's
+		// sample offset.
+		else if (std::memcmp(chunk, "cue ", 4) == 0 && size >= 28) {
+			sample.LoopStart = static_cast<int32_t>(ReadU32(chunk + 32));
+		}
+		else if (std::memcmp(chunk, "data", 4) == 0) {
+			data = chunk + 8;
+			dataSize = size;
+		}
+		// Chunks are padded to an even size.
+		offset += 8 + size + (size & 1);
+	}
+
+	if (bits != 8 && bits != 16) {
+		throw std::runtime_error("Failed to load " + filename + ", only 8 and 16-bit samples are supported!");
+	}
+	if (data == nullptr) {
+		throw std::runtime_error("Failed to load " + filename + ", it has no data chunk!");
+	}
+
+	sample.Length = dataSize / (bits / 8);
+	sample.Data.resize(sample.Length);
+	for (uint32_t i = 0; i < sample.Length; ++i) {
+		if (bits == 8) {
+			sample.Data[i] = (static_cast<float>(static_cast<uint8_t>(data[i])) - 128.0f) * (1.0f / 128.0f);
+		}
+		else {
+			sample.Data[i] = static_cast<float>(static_cast<int16_t>(ReadU16(data + i * 2))) * (1.0f / 32768.0f);
+		}
+	}
+}
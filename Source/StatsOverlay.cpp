@@ -0,0 +1,294 @@
+#include "StatsOverlay.h"
+
+#include <cstring>
+
+// ------------------------
+// Public methods
+// ------------------------
+void StatsOverlay::Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+	const VkAllocationCallbacks* allocator, const PipelineTarget& target, uint32_t framesInFlight) {
+	PhysicalDevice = physicalDevice;
+	Device = device;
+	Allocator = allocator;
+	FramesInFlight = framesInFlight;
+
+	CreateBuffers();
+	CreateDescriptors();
+	CreatePipeline(target);
+}
+
+void StatsOverlay::Destroy() {
+	vkDestroyPipeline(Device, Pipeline, Allocator);
+	vkDestroyPipelineLayout(Device, Layout, Allocator);
+	OverlayShader.DestroyShader(Device);
+	vkDestroyDescriptorPool(Device, DescriptorPool, Allocator);
+	vkDestroyDescriptorSetLayout(Device, SetLayout, Allocator);
+	for (uint32_t i = 0; i < FramesInFlight; ++i) {
+		vkDestroyBuffer(Device, TextBuffers[i], Allocator);
+		vkFreeMemory(Device, TextMemory[i], Allocator);
+	}
+	TextBuffers.clear();
+	TextMemory.clear();
+	TextMapped.clear();
+}
+
+void StatsOverlay::Draw(VkCommandBuffer commandBuffer, uint32_t frame, VkExtent2D extent, const char* text) {
+	char* grid = TextMapped[frame];
+	std::memset(grid, ' ', COLUMNS * ROWS);
+
+	uint32_t row = 0;
+	uint32_t column = 0;
+	for (const char* c = text; *c != '\0' && row < ROWS; ++c) {
+		if (*c == '\n') {
+			++row;
+			column = 0;
+			continue;
+		}
+		if (column == COLUMNS) {
+			continue;
+		}
+
+		char printed = *c;
+		if (printed >= 'a' && printed <= 'z') {
+			printed = static_cast<char>(printed - 'a' + 'A');
+		}
+		else if (printed < ' ' || printed > '_') {
+			printed = '?';
+		}
+		grid[row * COLUMNS + column++] = printed;
+	}
+	// A last line without a newline still counts.
+	const uint32_t rows = column > 0 && row < ROWS ? row + 1 : row;
+	if (rows == 0) {
+		return;
+	}
+
+	const uint32_t width = COLUMNS * CELL_WIDTH * SCALE;
+	const uint32_t height = rows * CELL_HEIGHT * SCALE;
+	if (extent.width <= static_cast<uint32_t>(MARGIN) || extent.height <= static_cast<uint32_t>(MARGIN)) {
+		return;
+	}
+
+	VkViewport viewport{ };
+	viewport.width = static_cast<float>(extent.width);
+	viewport.height = static_cast<float>(extent.height);
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{ };
+	scissor.offset = { MARGIN, MARGIN };
+	scissor.extent.width = width < extent.width - MARGIN ? width : extent.width - MARGIN;
+	scissor.extent.height = height < extent.height - MARGIN ? height : extent.height - MARGIN;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	OverlayStep step{ };
+	step.Origin[0] = MARGIN;
+	step.Origin[1] = MARGIN;
+	step.Columns = COLUMNS;
+	step.Scale = SCALE;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Layout,
+		0, 1, &DescriptorSets[frame], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, Layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(step), &step);
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void StatsOverlay::CreateBuffers() {
+	const VkDeviceSize gridSize = COLUMNS * ROWS;
+
+	TextBuffers.resize(FramesInFlight);
+	TextMemory.resize(FramesInFlight);
+	TextMapped.resize(FramesInFlight, nullptr);
+
+	for (uint32_t i = 0; i < FramesInFlight; ++i) {
+		utils::CreateBuffer(PhysicalDevice, Device, gridSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			TextBuffers[i], TextMemory[i], Allocator);
+
+		void* mapped = nullptr;
+		if (utils::FunctionFailed(vkMapMemory(Device, TextMemory[i], 0, gridSize, 0, &mapped))) {
+			throw std::runtime_error("Failed to map overlay text buffer!");
+		}
+		TextMapped[i] = static_cast<char*>(mapped);
+	}
+}
+
+void StatsOverlay::CreateDescriptors() {
+	VkDescriptorSetLayoutBinding binding{ };
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{ };
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	if (utils::FunctionFailed(vkCreateDescriptorSetLayout(Device, &layoutInfo, Allocator, &SetLayout))) {
+		throw std::runtime_error("Failed to create overlay descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{ };
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = FramesInFlight;
+
+	VkDescriptorPoolCreateInfo poolInfo{ };
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = FramesInFlight;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (utils::FunctionFailed(vkCreateDescriptorPool(Device, &poolInfo, Allocator, &DescriptorPool))) {
+		throw std::runtime_error("Failed to create overlay descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(FramesInFlight, SetLayout);
+	VkDescriptorSetAllocateInfo allocInfo{ };
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = DescriptorPool;
+	allocInfo.descriptorSetCount = FramesInFlight;
+	allocInfo.pSetLayouts = layouts.data();
+
+	DescriptorSets.resize(FramesInFlight);
+	if (utils::FunctionFailed(vkAllocateDescriptorSets(Device, &allocInfo, DescriptorSets.data()))) {
+		throw std::runtime_error("Failed to allocate overlay descriptor sets!");
+	}
+
+	for (uint32_t i = 0; i < FramesInFlight; ++i) {
+		VkDescriptorBufferInfo bufferInfo{ };
+		bufferInfo.buffer = TextBuffers[i];
+		bufferInfo.offset = 0;
+		bufferInfo.range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet write{ };
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = DescriptorSets[i];
+		write.dstBinding = 0;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.pBufferInfo = &bufferInfo;
+		vkUpdateDescriptorSets(Device, 1, &write, 0, nullptr);
+	}
+}
+
+void StatsOverlay::CreatePipeline(const PipelineTarget& target) {
+	// The upscaler's fullscreen triangle; the fragment shader works from
+	// gl_FragCoord and the scissor does the clipping.
+	OverlayShader.SetVertShaderFilename("Shaders/upscale_vert.spv");
+	OverlayShader.SetFragShaderFilename("Shaders/overlay_frag.spv");
+	OverlayShader.CompileShader(Device, Allocator);
+
+	VkPipelineShaderStageCreateInfo shaderStages[2]{ };
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = OverlayShader.GetVert();
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = OverlayShader.GetFrag();
+	shaderStages[1].pName = "main";
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{ };
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{ };
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportState{ };
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{ };
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{ };
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = target.Samples;
+	multisampling.minSampleShading = 1.0f;
+
+	// Drawn over the finished scene, which may have a depth attachment.
+	VkPipelineDepthStencilStateCreateInfo depthStencil{ };
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_FALSE;
+	depthStencil.depthWriteEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{ };
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{ };
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	std::vector<VkDynamicState> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicState{ };
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkPushConstantRange pushConstantRange{ };
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(OverlayStep);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{ };
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &SetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (utils::FunctionFailed(vkCreatePipelineLayout(Device, &pipelineLayoutInfo, Allocator, &Layout))) {
+		throw std::runtime_error("Failed to create overlay pipeline layout!");
+	}
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{ };
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = Layout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkPipelineRenderingCreateInfo renderingInfo{ };
+	target.Apply(pipelineInfo, renderingInfo);
+
+	if (utils::FunctionFailed(
+		vkCreateGraphicsPipelines(
+			Device, VK_NULL_HANDLE, 1, &pipelineInfo, Allocator, &Pipeline))) {
+		throw std::runtime_error("Failed to create overlay pipeline!");
+	}
+}
@@ -0,0 +1,323 @@
+#include "TextureDescriptors.h"
+
+#include <algorithm>
+
+// ------------------------
+// Public methods
+// ------------------------
+void TextureDescriptors::Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+	const VkAllocationCallbacks* allocator, uint32_t framesInFlight, bool bindless) {
+	Device = device;
+	Allocator = allocator;
+	Bindless = bindless;
+	RetiredSlots.resize(framesInFlight);
+
+	CreateSamplers();
+	if (Bindless) {
+		CreateBindlessSet(physicalDevice);
+	}
+	else {
+		// Unbounded; the table only holds views until a set is built.
+		Capacity = UINT32_MAX;
+		CreateFramePools(framesInFlight);
+	}
+}
+
+void TextureDescriptors::Destroy() {
+	for (auto& pool : FramePools) {
+		vkDestroyDescriptorPool(Device, pool, Allocator);
+	}
+	FramePools.clear();
+	FrameMaterials.clear();
+	vkDestroyDescriptorPool(Device, GlobalPool, Allocator);
+	GlobalPool = VK_NULL_HANDLE;
+	GlobalSet = VK_NULL_HANDLE;
+	vkDestroyDescriptorSetLayout(Device, SetLayout, Allocator);
+	SetLayout = VK_NULL_HANDLE;
+	vkDestroySampler(Device, NearestSampler, Allocator);
+	vkDestroySampler(Device, LinearSampler, Allocator);
+	NearestSampler = LinearSampler = VK_NULL_HANDLE;
+
+	Views.clear();
+	Samplers.clear();
+	FreeSlots.clear();
+	RetiredSlots.clear();
+}
+
+bool TextureDescriptors::IsBindless() const {
+	return Bindless;
+}
+
+VkDescriptorSetLayout TextureDescriptors::GetSetLayout() const {
+	return SetLayout;
+}
+
+uint32_t TextureDescriptors::Register(VkImageView view, VkFilter filter) {
+	uint32_t index;
+	if (!FreeSlots.empty()) {
+		index = FreeSlots.back();
+		FreeSlots.pop_back();
+	}
+	else {
+		if (Views.size() >= Capacity) {
+			throw std::runtime_error("Texture descriptor array is full!");
+		}
+		index = static_cast<uint32_t>(Views.size());
+		Views.push_back(VK_NULL_HANDLE);
+		Samplers.push_back(VK_NULL_HANDLE);
+	}
+
+	Views[index] = view;
+	Samplers[index] = filter == VK_FILTER_LINEAR ? LinearSampler : NearestSampler;
+
+	if (Bindless) {
+		WriteBindless(index);
+	}
+	return index;
+}
+
+void TextureDescriptors::Release(uint32_t index, uint32_t frame) {
+	// The array is partially bound, so the stale descriptor can stay
+	// written until the slot is reused.
+	Views[index] = VK_NULL_HANDLE;
+	RetiredSlots[frame].push_back(index);
+}
+
+void TextureDescriptors::BeginFrame(uint32_t frame) {
+	FreeSlots.insert(FreeSlots.end(), RetiredSlots[frame].begin(), RetiredSlots[frame].end());
+	RetiredSlots[frame].clear();
+
+	BoundCommandBuffer = VK_NULL_HANDLE;
+	BoundLayout = VK_NULL_HANDLE;
+	BoundSet = VK_NULL_HANDLE;
+
+	if (!Bindless) {
+		vkResetDescriptorPool(Device, FramePools[frame], 0);
+		FrameMaterials[frame].clear();
+	}
+}
+
+MaterialIndices TextureDescriptors::BindMaterial(VkCommandBuffer commandBuffer, VkPipelineLayout layout,
+	uint32_t frame, uint32_t texture, uint32_t lightmap) {
+	if (Bindless) {
+		if (BoundCommandBuffer != commandBuffer || BoundLayout != layout) {
+			BindArray(commandBuffer, layout);
+		}
+		return MaterialIndices{ texture, lightmap };
+	}
+
+	uint64_t key = (static_cast<uint64_t>(texture) << 32) | lightmap;
+	auto& materials = FrameMaterials[frame];
+	auto found = materials.find(key);
+
+	VkDescriptorSet set;
+	if (found != materials.end()) {
+		set = found->second;
+	}
+	else {
+		VkDescriptorSetAllocateInfo allocInfo{ };
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = FramePools[frame];
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &SetLayout;
+
+		if (utils::FunctionFailed(vkAllocateDescriptorSets(Device, &allocInfo, &set))) {
+			throw std::runtime_error("Ran out of per-frame material descriptor sets!");
+		}
+
+		VkDescriptorImageInfo imageInfos[2] = { GetImageInfo(texture), GetImageInfo(lightmap) };
+
+		VkWriteDescriptorSet write{ };
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = 0;
+		write.dstArrayElement = 0;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.descriptorCount = 2;
+		write.pImageInfo = imageInfos;
+		vkUpdateDescriptorSets(Device, 1, &write, 0, nullptr);
+
+		materials.emplace(key, set);
+	}
+
+	if (BoundSet != set || BoundLayout != layout) {
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout,
+			0, 1, &set, 0, nullptr);
+		BoundLayout = layout;
+		BoundSet = set;
+	}
+
+	// The fallback shader samples its two bindings directly.
+	return MaterialIndices{ 0, 1 };
+}
+
+void TextureDescriptors::BindArray(VkCommandBuffer commandBuffer, VkPipelineLayout layout) {
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout,
+		0, 1, &GlobalSet, 0, nullptr);
+	BoundCommandBuffer = commandBuffer;
+	BoundLayout = layout;
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void TextureDescriptors::CreateSamplers() {
+	VkSamplerCreateInfo samplerInfo{ };
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 1.0f;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.mipLodBias = 0.0f;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	if (utils::FunctionFailed(vkCreateSampler(Device, &samplerInfo, Allocator, &NearestSampler))) {
+		throw std::runtime_error("Failed to create texture sampler!");
+	}
+
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	if (utils::FunctionFailed(vkCreateSampler(Device, &samplerInfo, Allocator, &LinearSampler))) {
+		throw std::runtime_error("Failed to create lightmap sampler!");
+	}
+}
+
+void TextureDescriptors::CreateBindlessSet(const VkPhysicalDevice& physicalDevice) {
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{ };
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties{ };
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &indexingProperties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+	Capacity = std::min({ MAX_TEXTURES,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSamplers });
+
+	VkDescriptorSetLayoutBinding binding{ };
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = Capacity;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	binding.pImmutableSamplers = nullptr;
+
+	VkDescriptorBindingFlags bindingFlags =
+		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+		VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{ };
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = 1;
+	bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{ };
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	if (utils::FunctionFailed(vkCreateDescriptorSetLayout(Device, &layoutInfo, Allocator, &SetLayout))) {
+		throw std::runtime_error("Failed to create bindless texture set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{ };
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = Capacity;
+
+	VkDescriptorPoolCreateInfo poolInfo{ };
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (utils::FunctionFailed(vkCreateDescriptorPool(Device, &poolInfo, Allocator, &GlobalPool))) {
+		throw std::runtime_error("Failed to create bindless texture pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{ };
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = GlobalPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &SetLayout;
+
+	if (utils::FunctionFailed(vkAllocateDescriptorSets(Device, &allocInfo, &GlobalSet))) {
+		throw std::runtime_error("Failed to allocate bindless texture set!");
+	}
+}
+
+void TextureDescriptors::CreateFramePools(uint32_t framesInFlight) {
+	VkDescriptorSetLayoutBinding binding{ };
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = 2;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	binding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{ };
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	if (utils::FunctionFailed(vkCreateDescriptorSetLayout(Device, &layoutInfo, Allocator, &SetLayout))) {
+		throw std::runtime_error("Failed to create material set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{ };
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = 2 * MAX_MATERIALS_PER_FRAME;
+
+	VkDescriptorPoolCreateInfo poolInfo{ };
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = MAX_MATERIALS_PER_FRAME;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	FramePools.resize(framesInFlight);
+	FrameMaterials.resize(framesInFlight);
+	for (auto& pool : FramePools) {
+		if (utils::FunctionFailed(vkCreateDescriptorPool(Device, &poolInfo, Allocator, &pool))) {
+			throw std::runtime_error("Failed to create material descriptor pool!");
+		}
+	}
+}
+
+void TextureDescriptors::WriteBindless(uint32_t index) {
+	VkDescriptorImageInfo imageInfo = GetImageInfo(index);
+
+	VkWriteDescriptorSet write{ };
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = GlobalSet;
+	write.dstBinding = 0;
+	write.dstArrayElement = index;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.descriptorCount = 1;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(Device, 1, &write, 0, nullptr);
+}
+
+VkDescriptorImageInfo TextureDescriptors::GetImageInfo(uint32_t index) const {
+	VkDescriptorImageInfo imageInfo{ };
+	imageInfo.sampler = Samplers[index];
+	imageInfo.imageView = Views[index];
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	return imageInfo;
+}
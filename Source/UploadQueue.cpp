@@ -0,0 +1,482 @@
+#include "UploadQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Align.h"
+#include "Metrics.h"
+
+static const uint32_t UPLOADS = Metrics::Register("uploads", MetricType::Counter);
+static const uint32_t UPLOAD_BYTES = Metrics::Register("upload_bytes", MetricType::Counter);
+
+// Stages that may consume uploaded data on the graphics queue.
+static const VkPipelineStageFlags CONSUMER_STAGES =
+	VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+	VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+	VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+	VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+	VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+static const VkAccessFlags BUFFER_CONSUMER_ACCESS =
+	VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+	VK_ACCESS_INDEX_READ_BIT |
+	VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+	VK_ACCESS_UNIFORM_READ_BIT |
+	VK_ACCESS_SHADER_READ_BIT;
+
+// ------------------------
+// Public methods
+// ------------------------
+void UploadQueue::Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+	const VkAllocationCallbacks* allocator, uint32_t graphicsFamily, std::optional<uint32_t> transferFamily) {
+	PhysicalDevice = physicalDevice;
+	Device = device;
+	Allocator = allocator;
+	GraphicsFamily = graphicsFamily;
+	Dedicated = transferFamily.has_value() && transferFamily.value() != graphicsFamily;
+	TransferFamily = Dedicated ? transferFamily.value() : graphicsFamily;
+
+	vkGetDeviceQueue(Device, TransferFamily, 0, &Queue);
+
+	VkCommandPoolCreateInfo poolInfo{ };
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = TransferFamily;
+
+	if (utils::FunctionFailed(vkCreateCommandPool(Device, &poolInfo, Allocator, &CommandPool))) {
+		throw std::runtime_error("Failed to create upload command pool!");
+	}
+
+	utils::CreateBuffer(PhysicalDevice, Device, STAGING_SIZE,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		StagingBuffer, StagingMemory, Allocator);
+
+	void* mapped = nullptr;
+	if (utils::FunctionFailed(vkMapMemory(Device, StagingMemory, 0, STAGING_SIZE, 0, &mapped))) {
+		throw std::runtime_error("Failed to map staging memory!");
+	}
+	StagingMapped = static_cast<uint8_t*>(mapped);
+}
+
+void UploadQueue::Destroy() {
+	std::lock_guard<std::mutex> guard(Lock);
+
+	auto destroyBatch = [this](Batch& batch) {
+		vkDestroySemaphore(Device, batch.Semaphore, Allocator);
+		vkDestroyFence(Device, batch.Fence, Allocator);
+	};
+
+	if (Recording) {
+		destroyBatch(*Recording);
+		Recording.reset();
+	}
+	for (auto& batch : InFlight) {
+		destroyBatch(batch);
+	}
+	InFlight.clear();
+
+	for (auto fence : FreeFences) {
+		vkDestroyFence(Device, fence, Allocator);
+	}
+	for (auto semaphore : FreeSemaphores) {
+		vkDestroySemaphore(Device, semaphore, Allocator);
+	}
+	FreeFences.clear();
+	FreeSemaphores.clear();
+	FreeCommandBuffers.clear();
+
+	vkDestroyCommandPool(Device, CommandPool, Allocator);
+
+	vkUnmapMemory(Device, StagingMemory);
+	vkDestroyBuffer(Device, StagingBuffer, Allocator);
+	vkFreeMemory(Device, StagingMemory, Allocator);
+}
+
+bool UploadQueue::IsDedicated() const {
+	return Dedicated;
+}
+
+void UploadQueue::UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+	std::lock_guard<std::mutex> guard(Lock);
+	Metrics::Add(UPLOADS);
+	Metrics::Add(UPLOAD_BYTES, size);
+
+	// Buffers larger than the ring are streamed through it in chunks.
+	const VkDeviceSize chunkSize = STAGING_SIZE / 4;
+	const uint8_t* src = static_cast<const uint8_t*>(data);
+
+	for (VkDeviceSize done = 0; done < size; done += chunkSize) {
+		VkDeviceSize copySize = std::min(chunkSize, size - done);
+		VkDeviceSize stagingOffset = AllocateStaging(copySize, 16);
+		std::memcpy(StagingMapped + stagingOffset, src + done, copySize);
+
+		Batch& batch = BeginBatch();
+
+		VkBufferCopy region{ };
+		region.srcOffset = stagingOffset;
+		region.dstOffset = dstOffset + done;
+		region.size = copySize;
+		vkCmdCopyBuffer(batch.CommandBuffer, StagingBuffer, dst, 1, &region);
+	}
+
+	Batch& batch = BeginBatch();
+
+	VkBufferMemoryBarrier barrier{ };
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.buffer = dst;
+	barrier.offset = dstOffset;
+	barrier.size = size;
+
+	if (Dedicated) {
+		// Release half of the ownership transfer; the graphics queue
+		// records the matching acquire in AcquireUploads.
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = TransferFamily;
+		barrier.dstQueueFamilyIndex = GraphicsFamily;
+		vkCmdPipelineBarrier(batch.CommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr, 1, &barrier, 0, nullptr);
+
+		VkBufferMemoryBarrier2 acquire{ };
+		acquire.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+		acquire.srcStageMask = CONSUMER_STAGES;
+		acquire.srcAccessMask = 0;
+		acquire.dstStageMask = CONSUMER_STAGES;
+		acquire.dstAccessMask = BUFFER_CONSUMER_ACCESS;
+		acquire.srcQueueFamilyIndex = TransferFamily;
+		acquire.dstQueueFamilyIndex = GraphicsFamily;
+		acquire.buffer = dst;
+		acquire.offset = dstOffset;
+		acquire.size = size;
+		batch.BufferAcquires.push_back(acquire);
+	}
+	else {
+		barrier.dstAccessMask = BUFFER_CONSUMER_ACCESS;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		vkCmdPipelineBarrier(batch.CommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, CONSUMER_STAGES, 0,
+			0, nullptr, 1, &barrier, 0, nullptr);
+	}
+}
+
+void UploadQueue::UploadImage(VkImage dst, VkExtent2D extent, uint32_t mipLevels,
+	uint32_t texelSize, const void* data) {
+	std::lock_guard<std::mutex> guard(Lock);
+
+	VkDeviceSize totalSize = 0;
+	for (uint32_t mip = 0; mip < mipLevels; ++mip) {
+		uint32_t width = std::max(extent.width >> mip, 1u);
+		uint32_t height = std::max(extent.height >> mip, 1u);
+		totalSize += static_cast<VkDeviceSize>(width) * height * texelSize;
+	}
+
+	if (totalSize > STAGING_SIZE) {
+		throw std::runtime_error("Image upload exceeds staging capacity!");
+	}
+
+	Metrics::Add(UPLOADS);
+	Metrics::Add(UPLOAD_BYTES, totalSize);
+
+	VkDeviceSize stagingOffset = AllocateStaging(totalSize, std::max<VkDeviceSize>(texelSize, 16));
+	std::memcpy(StagingMapped + stagingOffset, data, totalSize);
+
+	Batch& batch = BeginBatch();
+
+	VkImageMemoryBarrier barrier{ };
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.image = dst;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mipLevels;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(batch.CommandBuffer,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &barrier);
+
+	std::vector<VkBufferImageCopy> regions(mipLevels);
+	VkDeviceSize mipOffset = stagingOffset;
+	for (uint32_t mip = 0; mip < mipLevels; ++mip) {
+		uint32_t width = std::max(extent.width >> mip, 1u);
+		uint32_t height = std::max(extent.height >> mip, 1u);
+
+		VkBufferImageCopy& region = regions[mip];
+		region.bufferOffset = mipOffset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = mip;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { width, height, 1 };
+
+		mipOffset += static_cast<VkDeviceSize>(width) * height * texelSize;
+	}
+	vkCmdCopyBufferToImage(batch.CommandBuffer, StagingBuffer, dst,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(regions.size()), regions.data());
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	if (Dedicated) {
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = TransferFamily;
+		barrier.dstQueueFamilyIndex = GraphicsFamily;
+		vkCmdPipelineBarrier(batch.CommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkImageMemoryBarrier2 acquire{ };
+		acquire.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		acquire.srcStageMask = CONSUMER_STAGES;
+		acquire.srcAccessMask = 0;
+		acquire.dstStageMask = CONSUMER_STAGES;
+		acquire.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		acquire.oldLayout = barrier.oldLayout;
+		acquire.newLayout = barrier.newLayout;
+		acquire.srcQueueFamilyIndex = TransferFamily;
+		acquire.dstQueueFamilyIndex = GraphicsFamily;
+		acquire.image = dst;
+		acquire.subresourceRange = barrier.subresourceRange;
+		batch.ImageAcquires.push_back(acquire);
+	}
+	else {
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(batch.CommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, CONSUMER_STAGES, 0,
+			0, nullptr, 0, nullptr, 1, &barrier);
+	}
+}
+
+void UploadQueue::Flush() {
+	std::lock_guard<std::mutex> guard(Lock);
+	SubmitBatch();
+}
+
+void UploadQueue::AcquireUploads(uint64_t frameNumber, BarrierBatch& barriers,
+	std::vector<VkSemaphore>& waitSemaphores,
+	std::vector<VkPipelineStageFlags>& waitStages) {
+	std::lock_guard<std::mutex> guard(Lock);
+
+	for (auto& batch : InFlight) {
+		if (batch.Acquired) {
+			continue;
+		}
+
+		batch.Acquired = true;
+		batch.AcquireFrame = frameNumber;
+
+		waitSemaphores.push_back(batch.Semaphore);
+		waitStages.push_back(CONSUMER_STAGES);
+
+		// The source stages match the semaphore wait stages so the acquire
+		// chains with the transfer queue's signal.
+		for (const auto& acquire : batch.BufferAcquires) {
+			barriers.AddBuffer(acquire);
+		}
+		for (const auto& acquire : batch.ImageAcquires) {
+			barriers.AddImage(acquire);
+		}
+	}
+}
+
+void UploadQueue::CollectFinished(uint64_t completedFrame) {
+	std::lock_guard<std::mutex> guard(Lock);
+
+	ReleaseFinishedStaging();
+
+	// A batch's semaphore may only be reused once the frame that waited on
+	// it has finished executing.
+	while (!InFlight.empty()) {
+		Batch& batch = InFlight.front();
+		if (!batch.StagingReleased || !batch.Acquired || batch.AcquireFrame > completedFrame) {
+			break;
+		}
+
+		FreeCommandBuffers.push_back(batch.CommandBuffer);
+		FreeFences.push_back(batch.Fence);
+		FreeSemaphores.push_back(batch.Semaphore);
+		InFlight.pop_front();
+	}
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+UploadQueue::Batch& UploadQueue::BeginBatch() {
+	if (Recording) {
+		return *Recording;
+	}
+
+	Batch batch;
+
+	if (FreeCommandBuffers.empty()) {
+		VkCommandBufferAllocateInfo allocInfo{ };
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = CommandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		if (utils::FunctionFailed(vkAllocateCommandBuffers(Device, &allocInfo, &batch.CommandBuffer))) {
+			throw std::runtime_error("Failed to allocate upload command buffer!");
+		}
+	}
+	else {
+		batch.CommandBuffer = FreeCommandBuffers.back();
+		FreeCommandBuffers.pop_back();
+		vkResetCommandBuffer(batch.CommandBuffer, 0);
+	}
+
+	if (FreeFences.empty()) {
+		VkFenceCreateInfo fenceInfo{ };
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (utils::FunctionFailed(vkCreateFence(Device, &fenceInfo, Allocator, &batch.Fence))) {
+			throw std::runtime_error("Failed to create upload fence!");
+		}
+	}
+	else {
+		batch.Fence = FreeFences.back();
+		FreeFences.pop_back();
+		vkResetFences(Device, 1, &batch.Fence);
+	}
+
+	if (FreeSemaphores.empty()) {
+		VkSemaphoreCreateInfo semaphoreInfo{ };
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		if (utils::FunctionFailed(vkCreateSemaphore(Device, &semaphoreInfo, Allocator, &batch.Semaphore))) {
+			throw std::runtime_error("Failed to create upload semaphore!");
+		}
+	}
+	else {
+		batch.Semaphore = FreeSemaphores.back();
+		FreeSemaphores.pop_back();
+	}
+
+	VkCommandBufferBeginInfo beginInfo{ };
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (utils::FunctionFailed(vkBeginCommandBuffer(batch.CommandBuffer, &beginInfo))) {
+		throw std::runtime_error("Failed to begin upload command buffer!");
+	}
+
+	Recording = std::move(batch);
+	return *Recording;
+}
+
+void UploadQueue::SubmitBatch() {
+	if (!Recording) {
+		return;
+	}
+
+	Batch& batch = *Recording;
+
+	if (utils::FunctionFailed(vkEndCommandBuffer(batch.CommandBuffer))) {
+		throw std::runtime_error("Failed to record upload command buffer!");
+	}
+
+	VkSubmitInfo submitInfo{ };
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.CommandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &batch.Semaphore;
+
+	if (utils::FunctionFailed(vkQueueSubmit(Queue, 1, &submitInfo, batch.Fence))) {
+		throw std::runtime_error("Failed to submit upload batch!");
+	}
+
+	batch.Submitted = true;
+	batch.RingEnd = RingHead;
+	InFlight.push_back(std::move(batch));
+	Recording.reset();
+}
+
+VkDeviceSize UploadQueue::AllocateStaging(VkDeviceSize size, VkDeviceSize alignment) {
+	VkDeviceSize offset = 0;
+	while (!TryAllocateStaging(size, alignment, offset)) {
+		// Out of ring space: push what has been recorded so far and block
+		// on the oldest outstanding batch. This only happens when a load
+		// outpaces the transfer queue by a full ring.
+		SubmitBatch();
+		RetireOldest();
+	}
+	return offset;
+}
+
+bool UploadQueue::TryAllocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+	if (RingUsed == 0) {
+		RingHead = RingTail = 0;
+	}
+
+	VkDeviceSize aligned = utils::AlignUp(RingHead, alignment);
+	VkDeviceSize consumed = 0;
+
+	if (RingHead > RingTail || RingUsed == 0) {
+		if (aligned + size <= STAGING_SIZE) {
+			offset = aligned;
+			consumed = aligned + size - RingHead;
+		}
+		else if (size <= RingTail) {
+			offset = 0;
+			consumed = (STAGING_SIZE - RingHead) + size;
+		}
+		else {
+			return false;
+		}
+	}
+	else if (RingHead < RingTail && aligned + size <= RingTail) {
+		offset = aligned;
+		consumed = aligned + size - RingHead;
+	}
+	else {
+		return false;
+	}
+
+	RingHead = offset + size;
+	RingUsed += consumed;
+
+	Batch& batch = BeginBatch();
+	batch.RingBytes += consumed;
+	return true;
+}
+
+void UploadQueue::RetireOldest() {
+	for (auto& batch : InFlight) {
+		if (!batch.StagingReleased) {
+			vkWaitForFences(Device, 1, &batch.Fence, VK_TRUE, UINT64_MAX);
+			break;
+		}
+	}
+	ReleaseFinishedStaging();
+}
+
+void UploadQueue::ReleaseFinishedStaging() {
+	// Batches share one queue, so they complete in submission order.
+	for (auto& batch : InFlight) {
+		if (batch.StagingReleased) {
+			continue;
+		}
+		if (vkGetFenceStatus(Device, batch.Fence) != VK_SUCCESS) {
+			break;
+		}
+
+		batch.StagingReleased = true;
+		RingTail = batch.RingEnd;
+		RingUsed -= batch.RingBytes;
+	}
+}
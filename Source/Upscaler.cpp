@@ -0,0 +1,227 @@
+#include "Upscaler.h"
+
+#include "Metrics.h"
+
+static const uint32_t DRAW_CALLS = Metrics::Register("draw_calls", MetricType::Counter);
+static const uint32_t TRIANGLES = Metrics::Register("triangles", MetricType::Counter);
+static const uint32_t PIPELINE_BINDS = Metrics::Register("pipeline_binds", MetricType::Counter);
+
+// ------------------------
+// Public methods
+// ------------------------
+void Upscaler::Init(const VkDevice& device, const VkAllocationCallbacks* allocator, const PipelineTarget& target) {
+	Device = device;
+	Allocator = allocator;
+
+	CreateDescriptors();
+	CreatePipeline(target);
+}
+
+void Upscaler::Destroy() {
+	vkDestroyPipeline(Device, Pipeline, Allocator);
+	vkDestroyPipelineLayout(Device, Layout, Allocator);
+	UpscaleShader.DestroyShader(Device);
+	vkDestroyDescriptorPool(Device, DescriptorPool, Allocator);
+	vkDestroyDescriptorSetLayout(Device, SetLayout, Allocator);
+	vkDestroySampler(Device, Sampler, Allocator);
+}
+
+void Upscaler::SetSource(VkImageView view) {
+	VkDescriptorImageInfo imageInfo{ };
+	imageInfo.sampler = Sampler;
+	imageInfo.imageView = view;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write{ };
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = DescriptorSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(Device, 1, &write, 0, nullptr);
+}
+
+void Upscaler::Draw(VkCommandBuffer commandBuffer, VkExtent2D sourceArea, VkExtent2D sourceExtent) {
+	UpscaleStep step{ };
+	step.UvScale[0] = static_cast<float>(sourceArea.width) / sourceExtent.width;
+	step.UvScale[1] = static_cast<float>(sourceArea.height) / sourceExtent.height;
+	step.UvMax[0] = (sourceArea.width - 0.5f) / sourceExtent.width;
+	step.UvMax[1] = (sourceArea.height - 0.5f) / sourceExtent.height;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Layout,
+		0, 1, &DescriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, Layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(step), &step);
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	Metrics::Add(PIPELINE_BINDS);
+	Metrics::Add(DRAW_CALLS);
+	Metrics::Add(TRIANGLES);
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void Upscaler::CreateDescriptors() {
+	VkSamplerCreateInfo samplerInfo{ };
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 1.0f;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = 0.0f;
+
+	if (utils::FunctionFailed(vkCreateSampler(Device, &samplerInfo, Allocator, &Sampler))) {
+		throw std::runtime_error("Failed to create upscale sampler!");
+	}
+
+	VkDescriptorSetLayoutBinding binding{ };
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{ };
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	if (utils::FunctionFailed(vkCreateDescriptorSetLayout(Device, &layoutInfo, Allocator, &SetLayout))) {
+		throw std::runtime_error("Failed to create upscale descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{ };
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo{ };
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (utils::FunctionFailed(vkCreateDescriptorPool(Device, &poolInfo, Allocator, &DescriptorPool))) {
+		throw std::runtime_error("Failed to create upscale descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{ };
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = DescriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &SetLayout;
+
+	if (utils::FunctionFailed(vkAllocateDescriptorSets(Device, &allocInfo, &DescriptorSet))) {
+		throw std::runtime_error("Failed to allocate upscale descriptor set!");
+	}
+}
+
+void Upscaler::CreatePipeline(const PipelineTarget& target) {
+	UpscaleShader.SetVertShaderFilename("Shaders/upscale_vert.spv");
+	UpscaleShader.SetFragShaderFilename("Shaders/upscale_frag.spv");
+	UpscaleShader.CompileShader(Device, Allocator);
+
+	VkPipelineShaderStageCreateInfo shaderStages[2]{ };
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = UpscaleShader.GetVert();
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = UpscaleShader.GetFrag();
+	shaderStages[1].pName = "main";
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{ };
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{ };
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportState{ };
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{ };
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{ };
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = target.Samples;
+	multisampling.minSampleShading = 1.0f;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{ };
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_FALSE;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{ };
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	std::vector<VkDynamicState> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicState{ };
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkPushConstantRange pushConstantRange{ };
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(UpscaleStep);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{ };
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &SetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (utils::FunctionFailed(vkCreatePipelineLayout(Device, &pipelineLayoutInfo, Allocator, &Layout))) {
+		throw std::runtime_error("Failed to create upscale pipeline layout!");
+	}
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{ };
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = nullptr;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = Layout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkPipelineRenderingCreateInfo renderingInfo{ };
+	target.Apply(pipelineInfo, renderingInfo);
+
+	if (utils::FunctionFailed(
+		vkCreateGraphicsPipelines(
+			Device, VK_NULL_HANDLE, 1, &pipelineInfo, Allocator, &Pipeline))) {
+		throw std::runtime_error("Failed to create upscale pipeline!");
+	}
+}
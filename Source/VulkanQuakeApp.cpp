@@ -28,6 +28,10 @@
 struct QueueFamilyIndicies {
 	std::optional<uint32_t> GraphicsFamily;
 	std::optional<uint32_t> PresentFamily;
+	// Transfer-only family (no graphics or compute) for async uploads.
+	std::optional<uint32_t> TransferFamily;
+	// Compute family without graphics, for async compute.
+	std::optional<uint32_t> ComputeFamily;
 
 	inline bool isComplete() const {
 		return GraphicsFamily.has_value() && PresentFamily.has_value();
@@ -40,6 +44,49 @@ struct SwapChainSupportDetails {
 	std::vector<VkPresentModeKHR> presentModes;
 };
 
+// -----------------------
+// Metrics
+// -----------------------
+static const uint32_t FRAME_MS = Metrics::Register("frame_ms", MetricType::Histogram);
+static const uint32_t FENCE_WAIT_MS = Metrics::Register("fence_wait_ms", MetricType::Histogram);
+static const uint32_t SUBMIT_MS = Metrics::Register("submit_ms", MetricType::Histogram);
+static const uint32_t DRAW_CALLS = Metrics::Register("draw_calls", MetricType::Counter);
+static const uint32_t TRIANGLES = Metrics::Register("triangles", MetricType::Counter);
+static const uint32_t PIPELINE_BINDS = Metrics::Register("pipeline_binds", MetricType::Counter);
+static const uint32_t HOST_ALLOC_BYTES = Metrics::Register("host_alloc_bytes", MetricType::Gauge);
+static const uint32_t OVERDRAW = Metrics::Register("overdraw", MetricType::Gauge);
+static const uint32_t RENDER_SCALE = Metrics::Register("render_scale", MetricType::Gauge);
+
+// Vulkan 1.2 and VK_EXT_descriptor_indexing name these bits identically.
+template<typename Features>
+static bool SupportsBindlessTextures(const Features& features) {
+	return features.runtimeDescriptorArray &&
+		features.descriptorBindingPartiallyBound &&
+		features.descriptorBindingSampledImageUpdateAfterBind &&
+		features.descriptorBindingUpdateUnusedWhilePending &&
+		features.shaderSampledImageArrayNonUniformIndexing;
+}
+
+static const char* DepthFormatName(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_D32_SFLOAT: return "D32_SFLOAT";
+	case VK_FORMAT_D32_SFLOAT_S8_UINT: return "D32_SFLOAT_S8_UINT";
+	case VK_FORMAT_X8_D24_UNORM_PACK32: return "X8_D24_UNORM_PACK32";
+	case VK_FORMAT_D24_UNORM_S8_UINT: return "D24_UNORM_S8_UINT";
+	case VK_FORMAT_D16_UNORM: return "D16_UNORM";
+	default: return "unknown";
+	}
+}
+
+template<typename Features>
+static void EnableBindlessTextures(Features& features) {
+	features.runtimeDescriptorArray = VK_TRUE;
+	features.descriptorBindingPartiallyBound = VK_TRUE;
+	features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+}
+
 // --------------------------
 // Public Methods
 // --------------------------
@@ -55,7 +102,7 @@ void VulkanQuakeApp::Run() {
 // ------------------------
 void VulkanQuakeApp::InitWindow() {
 	if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-		std::cerr << "SDL failed to initialise: " << SDL_GetError() << std::endl;
+		Log::Writef(LogSeverity::Error, 0, "SDL failed to initialise: %s", SDL_GetError());
 		throw std::runtime_error("Failed to initialise SDL");
 	}
 
@@ -63,11 +110,12 @@ void VulkanQuakeApp::InitWindow() {
 		SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
 		WIDTH, HEIGHT, SDL_WINDOW_VULKAN);
 	if (Window == nullptr) {
-		std::cerr << "SDL failed to create window: " << SDL_GetError() << std::endl;
+		Log::Writef(LogSeverity::Error, 0, "SDL failed to create window: %s", SDL_GetError());
 		throw std::runtime_error("Failed to create SDL window");
 	}
 
 	SDL_SetWindowResizable(Window, SDL_FALSE);
+	Sound.Init();
 }
 
 void VulkanQuakeApp::InitVulkan() {
@@ -75,11 +123,28 @@ void VulkanQuakeApp::InitVulkan() {
 	SetUpDebugMessenger();
 	CreateSurface();
 	PickPhysicalDevice();
+	SelectRenderPath();
+	SelectDescriptorModel();
+	SelectWorldPath();
+	SelectAttachmentFormats();
 	CreateLogicialDevice();
 	CreateSwapchain();
 	CreateImageViews();
-	CreateRenderPass();
+	CreateRenderGraph();
+	CreateTextureDescriptors();
 	CreateGraphicsPipeline();
+	CreateCommandPool();
+	CreateCommandBuffers();
+	CreateSyncObjects();
+	CreateQueryPool();
+	CreateUploadQueue();
+	CreateDefaultTextures();
+	CreateWorldRenderer();
+	LoadLevel();
+	CreateParticleSystem();
+	CreateDynamicResolution();
+	CreateFrameCapture();
+	CreateStatsOverlay();
 }
 
 void VulkanQuakeApp::CreateInstance() {
@@ -89,13 +154,23 @@ void VulkanQuakeApp::CreateInstance() {
 
 	auto extensions = GetRequiredExtensions();
 
+	// A 1.0 loader does not export vkEnumerateInstanceVersion and rejects
+	// any higher apiVersion.
+	uint32_t loaderVersion = VK_API_VERSION_1_0;
+	auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(
+		nullptr, "vkEnumerateInstanceVersion");
+	if (enumerateInstanceVersion != nullptr) {
+		enumerateInstanceVersion(&loaderVersion);
+	}
+	InstanceApiVersion = ForceLegacyPath ? VK_API_VERSION_1_0 : std::min(loaderVersion, VK_API_VERSION_1_3);
+
 	VkApplicationInfo appInfo{ };
 	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
 	appInfo.pApplicationName = APP_NAME.c_str();
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = APP_NAME.c_str();
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	appInfo.apiVersion = InstanceApiVersion;
 
 	VkInstanceCreateInfo createInfo{ };
 	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -120,7 +195,7 @@ void VulkanQuakeApp::CreateInstance() {
 		createInfo.pNext = nullptr;
 	}
 
-	if (utils::FunctionFailed(vkCreateInstance(&createInfo, nullptr, &Instance))) {
+	if (utils::FunctionFailed(vkCreateInstance(&createInfo, Allocator, &Instance))) {
 		throw std::runtime_error("Failed to create instance!");
 	}
 }
@@ -148,6 +223,159 @@ void VulkanQuakeApp::PickPhysicalDevice() {
 	}
 }
 
+void VulkanQuakeApp::SelectRenderPath() {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(PhysicalDevice, &properties);
+	DeviceApiVersion = std::min(properties.apiVersion, InstanceApiVersion);
+
+	ModernPath = false;
+	if (!ForceLegacyPath && DeviceApiVersion >= VK_API_VERSION_1_3) {
+		VkPhysicalDeviceVulkan13Features supported13{ };
+		supported13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+		VkPhysicalDeviceVulkan12Features supported12{ };
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		supported12.pNext = &supported13;
+
+		VkPhysicalDeviceFeatures2 supported{ };
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(PhysicalDevice, &supported);
+
+		ModernPath = supported12.timelineSemaphore && supported13.synchronization2 && supported13.dynamicRendering;
+	}
+
+	DeviceFeatures12 = VkPhysicalDeviceVulkan12Features{ };
+	DeviceFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	DeviceFeatures13 = VkPhysicalDeviceVulkan13Features{ };
+	DeviceFeatures13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	if (ModernPath) {
+		DeviceFeatures12.timelineSemaphore = VK_TRUE;
+		DeviceFeatures13.synchronization2 = VK_TRUE;
+		DeviceFeatures13.dynamicRendering = VK_TRUE;
+	}
+
+	Log::Writef(LogSeverity::Info, 0, "Render path: %s", ModernPath ? "Vulkan 1.3 (dynamic rendering)" : "Vulkan 1.0 (render pass)");
+}
+
+void VulkanQuakeApp::SelectDescriptorModel() {
+	DescriptorIndexing = false;
+	DeviceIndexingFeatures = VkPhysicalDeviceDescriptorIndexingFeatures{ };
+	DeviceIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+	if (DeviceApiVersion >= VK_API_VERSION_1_2) {
+		VkPhysicalDeviceVulkan12Features supported12{ };
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		VkPhysicalDeviceFeatures2 supported{ };
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(PhysicalDevice, &supported);
+
+		DescriptorIndexing = SupportsBindlessTextures(supported12);
+		if (DescriptorIndexing) {
+			EnableBindlessTextures(DeviceFeatures12);
+		}
+	}
+	else if (DeviceApiVersion >= VK_API_VERSION_1_1 &&
+		HasDeviceExtension(PhysicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+		VkPhysicalDeviceDescriptorIndexingFeatures supportedIndexing{ };
+		supportedIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+		VkPhysicalDeviceFeatures2 supported{ };
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &supportedIndexing;
+		vkGetPhysicalDeviceFeatures2(PhysicalDevice, &supported);
+
+		DescriptorIndexing = SupportsBindlessTextures(supportedIndexing);
+		if (DescriptorIndexing) {
+			EnableBindlessTextures(DeviceIndexingFeatures);
+		}
+	}
+
+	Log::Writef(LogSeverity::Info, 0, "Texture descriptors: %s", DescriptorIndexing ? "bindless" : "per-material sets");
+}
+
+void VulkanQuakeApp::SelectWorldPath() {
+	// Indirect draws carry their surface index in firstInstance and the
+	// shaders fetch the material themselves, so they need bindless textures.
+	VkPhysicalDeviceFeatures supported;
+	vkGetPhysicalDeviceFeatures(PhysicalDevice, &supported);
+
+	IndirectWorld = DescriptorIndexing && supported.multiDrawIndirect && supported.drawIndirectFirstInstance;
+	IndirectCountWorld = false;
+	if (IndirectWorld) {
+		DeviceFeatures.multiDrawIndirect = VK_TRUE;
+		DeviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+
+		if (DeviceApiVersion >= VK_API_VERSION_1_2) {
+			VkPhysicalDeviceVulkan12Features supported12{ };
+			supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+			VkPhysicalDeviceFeatures2 supported2{ };
+			supported2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			supported2.pNext = &supported12;
+			vkGetPhysicalDeviceFeatures2(PhysicalDevice, &supported2);
+
+			IndirectCountWorld = supported12.drawIndirectCount;
+			if (IndirectCountWorld) {
+				DeviceFeatures12.drawIndirectCount = VK_TRUE;
+			}
+		}
+	}
+
+	Log::Writef(LogSeverity::Info, 0, "World culling: %s", IndirectCountWorld ? "GPU (indirect count)" : IndirectWorld ? "GPU (indirect)" : "CPU");
+}
+
+void VulkanQuakeApp::SelectAttachmentFormats() {
+	// Most precise first. D16_UNORM is always supported.
+	const VkFormat depthCandidates[] = {
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_D32_SFLOAT_S8_UINT,
+		VK_FORMAT_X8_D24_UNORM_PACK32,
+		VK_FORMAT_D24_UNORM_S8_UINT,
+		VK_FORMAT_D16_UNORM
+	};
+
+	DepthFormat = VK_FORMAT_UNDEFINED;
+	for (VkFormat format : depthCandidates) {
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(PhysicalDevice, format, &formatProperties);
+		if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+			DepthFormat = format;
+			break;
+		}
+	}
+	if (DepthFormat == VK_FORMAT_UNDEFINED) {
+		throw std::runtime_error("Failed to find a supported depth format!");
+	}
+
+	// The colour and depth attachments share a sample count, and each
+	// VkSampleCountFlagBits value is its count.
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(PhysicalDevice, &properties);
+	VkSampleCountFlags supportedCounts =
+		properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
+
+	SampleCount = VK_SAMPLE_COUNT_1_BIT;
+	for (uint32_t samples = 64; samples > 1; samples >>= 1) {
+		if (samples <= MsaaSamples && (supportedCounts & samples)) {
+			SampleCount = static_cast<VkSampleCountFlagBits>(samples);
+			break;
+		}
+	}
+
+	VkPhysicalDeviceFeatures supported;
+	vkGetPhysicalDeviceFeatures(PhysicalDevice, &supported);
+	PipelineStatistics = supported.pipelineStatisticsQuery;
+	if (PipelineStatistics) {
+		DeviceFeatures.pipelineStatisticsQuery = VK_TRUE;
+	}
+
+	Log::Writef(LogSeverity::Info, 0, "Attachments: depth %s, %ux MSAA, depth prepass %s",
+		DepthFormatName(DepthFormat), static_cast<uint32_t>(SampleCount), DepthPrepass ? "on" : "off");
+}
+
 void VulkanQuakeApp::CreateLogicialDevice() {
 	QueueFamilyIndicies indicies = FindQueueFamilies(PhysicalDevice);
 
@@ -155,6 +383,12 @@ void VulkanQuakeApp::CreateLogicialDevice() {
 	std::set<uint32_t> uniqueQueueFamilies = {
 		indicies.GraphicsFamily.value(), indicies.PresentFamily.value()
 	};
+	if (indicies.TransferFamily.has_value()) {
+		uniqueQueueFamilies.insert(indicies.TransferFamily.value());
+	}
+	if (indicies.ComputeFamily.has_value()) {
+		uniqueQueueFamilies.insert(indicies.ComputeFamily.value());
+	}
 
 	float queuePriority = 1.0f;
 
@@ -169,11 +403,33 @@ void VulkanQuakeApp::CreateLogicialDevice() {
 
 	VkDeviceCreateInfo createInfo{ };
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	createInfo.pEnabledFeatures = &DeviceFeatures;
+
+	std::vector<const char*> extensions = DeviceExtensions;
+
+	VkPhysicalDeviceFeatures2 features2{ };
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.features = DeviceFeatures;
+	if (DeviceApiVersion >= VK_API_VERSION_1_2) {
+		DeviceFeatures13.pNext = nullptr;
+		DeviceFeatures12.pNext = DeviceApiVersion >= VK_API_VERSION_1_3 ? &DeviceFeatures13 : nullptr;
+		features2.pNext = &DeviceFeatures12;
+		createInfo.pNext = &features2;
+		createInfo.pEnabledFeatures = nullptr;
+	}
+	else if (DescriptorIndexing) {
+		DeviceIndexingFeatures.pNext = nullptr;
+		features2.pNext = &DeviceIndexingFeatures;
+		createInfo.pNext = &features2;
+		createInfo.pEnabledFeatures = nullptr;
+		extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+	}
+	else {
+		createInfo.pEnabledFeatures = &DeviceFeatures;
+	}
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(DeviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = DeviceExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	createInfo.ppEnabledExtensionNames = extensions.data();
 	if (EnableValidationLayers) {
 		createInfo.enabledLayerCount = static_cast<uint32_t>(ValidationLayers.size());
 		createInfo.ppEnabledLayerNames = ValidationLayers.data();
@@ -181,7 +437,7 @@ void VulkanQuakeApp::CreateLogicialDevice() {
 		createInfo.enabledLayerCount = 0;
 	}
 
-	if (utils::FunctionFailed(vkCreateDevice(PhysicalDevice, &createInfo, nullptr, &Device))) {
+	if (utils::FunctionFailed(vkCreateDevice(PhysicalDevice, &createInfo, Allocator, &Device))) {
 		throw std::runtime_error("Failed to create Logical Device!");
 	}
 	vkGetDeviceQueue(Device, indicies.GraphicsFamily.value(), 0, &GraphicsQueue);
@@ -218,6 +474,11 @@ createInfo.imageColorSpace = surfaceFormat.colorSpace;
 createInfo.imageExtent = extent;
 createInfo.imageArrayLayers = 1;
 createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+// Frame capture copies straight out of the presented image.
+SwapchainCapture = (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0;
+if (SwapchainCapture) {
+	createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+}
 if (indicies.GraphicsFamily != indicies.PresentFamily) {
 	createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
 	createInfo.queueFamilyIndexCount = 2;
@@ -234,7 +495,7 @@ createInfo.presentMode = presentMode;
 createInfo.clipped = VK_TRUE;
 createInfo.oldSwapchain = VK_NULL_HANDLE;
 
-if (utils::FunctionFailed(vkCreateSwapchainKHR(Device, &createInfo, nullptr, &Swapchain))) {
+if (utils::FunctionFailed(vkCreateSwapchainKHR(Device, &createInfo, Allocator, &Swapchain))) {
 	throw std::runtime_error("Failed to create swap chain!");
 }
 
@@ -265,48 +526,79 @@ void VulkanQuakeApp::CreateImageViews() {
 		createInfo.subresourceRange.baseArrayLayer = 0;
 		createInfo.subresourceRange.layerCount = 1;
 		SwapchainImageViews[i] = VkImageView{ };
-		if (utils::FunctionFailed(vkCreateImageView(Device, &createInfo, nullptr, &SwapchainImageViews[i]))) {
+		if (utils::FunctionFailed(vkCreateImageView(Device, &createInfo, Allocator, &SwapchainImageViews[i]))) {
 			throw std::runtime_error("Failed to create Image Views!");
 		}
 	}
 }
 
-void VulkanQuakeApp::CreateRenderPass() {
-	VkAttachmentDescription colorAttachment{ };
-	colorAttachment.format = SwapchainImageFormat;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+void VulkanQuakeApp::CreateRenderGraph() {
+	Graph.Init(PhysicalDevice, Device, Allocator, ModernPath);
+	RenderExtent = SwapchainExtent;
+
+	// Acquired images are waited on at colour attachment output.
+	Backbuffer = Graph.ImportImage("backbuffer", SwapchainImageFormat, SwapchainExtent,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
 
-	VkAttachmentReference colorAttachmentRef{ };
-	colorAttachmentRef.attachment = 0;
-	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	// Both live only within the frame. The multisampled colour is resolved
+	// before the main pass ends, so it and (without a prepass) depth never
+	// leave tile memory.
+	SceneDepth = Graph.CreateImage("depth", DepthFormat, SwapchainExtent, SampleCount);
+	VkClearValue clearDepth{ };
+	clearDepth.depthStencil = { 1.0f, 0 };
+
+	if (DepthPrepass) {
+		DepthPass = Graph.AddPass("depth prepass", [this](VkCommandBuffer commandBuffer) { RecordDepthPrepass(commandBuffer); });
+		Graph.WriteDepth(DepthPass, SceneDepth, VK_ATTACHMENT_LOAD_OP_CLEAR, clearDepth);
+	}
+
+	// With dynamic resolution the scene goes to an image the upscale pass
+	// samples. It is allocated at full size and the scene passes shrink
+	// their render area instead, so resizing never recompiles the graph.
+	RenderResource sceneOutput = Backbuffer;
+	if (DynamicResolutionMs > 0.0f) {
+		SceneTarget = Graph.CreateImage("scene", SwapchainImageFormat, SwapchainExtent);
+		sceneOutput = SceneTarget;
+	}
 
-	VkSubpassDescription subpass{ };
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentRef;
+	MainPass = Graph.AddPass("main", [this](VkCommandBuffer commandBuffer) { RecordMainPass(commandBuffer); });
+	VkClearValue clearColor = { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
+	if (SampleCount != VK_SAMPLE_COUNT_1_BIT) {
+		SceneColor = Graph.CreateImage("scene colour", SwapchainImageFormat, SwapchainExtent, SampleCount);
+		Graph.WriteColor(MainPass, SceneColor, VK_ATTACHMENT_LOAD_OP_CLEAR, clearColor);
+		Graph.ResolveColor(MainPass, SceneColor, sceneOutput);
+	}
+	else {
+		Graph.WriteColor(MainPass, sceneOutput, VK_ATTACHMENT_LOAD_OP_CLEAR, clearColor);
+	}
+	if (DepthPrepass) {
+		Graph.Read(MainPass, SceneDepth, RenderAccess::DepthRead);
+	}
+	else {
+		Graph.WriteDepth(MainPass, SceneDepth, VK_ATTACHMENT_LOAD_OP_CLEAR, clearDepth);
+	}
 
-	VkRenderPassCreateInfo renderPassInfo{ };
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = &colorAttachment;
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpass;
+	if (DynamicResolutionMs > 0.0f) {
+		UpscalePass = Graph.AddPass("upscale", [this](VkCommandBuffer commandBuffer) { RecordUpscalePass(commandBuffer); });
+		Graph.Read(UpscalePass, SceneTarget, RenderAccess::ShaderRead);
+		Graph.WriteColor(UpscalePass, Backbuffer, VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+	}
 
-	if (utils::FunctionFailed(vkCreateRenderPass(Device, &renderPassInfo, nullptr, &RenderPass))) {
-		throw std::runtime_error("Failed to create render pass!");;
+	// Last, so it sees the finished frame. Optional, so frames that aren't
+	// captured go straight from colour output to present.
+	if (SwapchainCapture) {
+		CapturePass = Graph.AddPass("capture", [this](VkCommandBuffer commandBuffer) { RecordCapturePass(commandBuffer); });
+		Graph.Read(CapturePass, Backbuffer, RenderAccess::TransferRead);
+		Graph.SetOptional(CapturePass);
 	}
+
+	Graph.Compile();
 }
 
 void VulkanQuakeApp::CreateGraphicsPipeline() {
 	CurrentShader.SetVertShaderFilename("Shaders/vert.spv");
 	CurrentShader.SetFragShaderFilename("Shaders/frag.spv");
-	CurrentShader.CompileShader(Device);
+	CurrentShader.CompileShader(Device, Allocator);
 
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{ };
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -378,12 +670,19 @@ void VulkanQuakeApp::CreateGraphicsPipeline() {
 	VkPipelineMultisampleStateCreateInfo multisampling{ };
 	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampling.rasterizationSamples = GetPipelineTarget().Samples;
 	multisampling.minSampleShading = 1.0f;
 	multisampling.pSampleMask = nullptr;
 	multisampling.alphaToCoverageEnable = VK_FALSE;
 	multisampling.alphaToOneEnable = VK_FALSE;
 
+	// Drawn first as a backdrop, so it neither tests nor writes depth.
+	VkPipelineDepthStencilStateCreateInfo depthStencil{ };
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_FALSE;
+	depthStencil.depthWriteEnable = VK_FALSE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+
 	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
 	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 	colorBlendAttachment.blendEnable = VK_FALSE;
@@ -405,14 +704,22 @@ void VulkanQuakeApp::CreateGraphicsPipeline() {
 	colorBlending.blendConstants[2] = 0.0f;
 	colorBlending.blendConstants[3] = 0.0f;
 
+	// Set 0 holds the world textures; draws select theirs with MaterialIndices.
+	VkDescriptorSetLayout textureSetLayout = Textures.GetSetLayout();
+
+	VkPushConstantRange materialRange{ };
+	materialRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	materialRange.offset = 0;
+	materialRange.size = sizeof(MaterialIndices);
+
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 0;
-	pipelineLayoutInfo.pSetLayouts = nullptr;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = nullptr;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &textureSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &materialRange;
 
-	if (utils::FunctionFailed(vkCreatePipelineLayout(Device, &pipelineLayoutInfo, nullptr, &PipelineLayout))) {
+	if (utils::FunctionFailed(vkCreatePipelineLayout(Device, &pipelineLayoutInfo, Allocator, &PipelineLayout))) {
 		throw std::runtime_error("failed to create pipeline layout!");
 	}
 
@@ -425,54 +732,677 @@ void VulkanQuakeApp::CreateGraphicsPipeline() {
 	pipelineInfo.pViewportState = &viewportState;
 	pipelineInfo.pRasterizationState = &rasterizer;
 	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pDepthStencilState = nullptr;
+	pipelineInfo.pDepthStencilState = &depthStencil;
 	pipelineInfo.pColorBlendState = &colorBlending;
 	pipelineInfo.pDynamicState = &dynamicState;
 	pipelineInfo.layout = PipelineLayout;
-	pipelineInfo.renderPass = RenderPass;
-	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 	pipelineInfo.basePipelineIndex = -1;
 
+	VkPipelineRenderingCreateInfo renderingInfo{ };
+	GetPipelineTarget().Apply(pipelineInfo, renderingInfo);
+
 	if (utils::FunctionFailed(
 		vkCreateGraphicsPipelines(
-			Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &GraphicsPipeline))) {
+			Device, VK_NULL_HANDLE, 1, &pipelineInfo, Allocator, &GraphicsPipeline))) {
 		throw std::runtime_error("Failed to create graphics pipeline!");
 	}
 }
 
+void VulkanQuakeApp::CreateTextureDescriptors() {
+	Textures.Init(PhysicalDevice, Device, Allocator, MAX_FRAMES_IN_FLIGHT, DescriptorIndexing);
+}
+
+void VulkanQuakeApp::CreateCommandPool() {
+	QueueFamilyIndicies indicies = FindQueueFamilies(PhysicalDevice);
+
+	VkCommandPoolCreateInfo poolInfo{ };
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = indicies.GraphicsFamily.value();
+
+	if (utils::FunctionFailed(vkCreateCommandPool(Device, &poolInfo, Allocator, &CommandPool))) {
+		throw std::runtime_error("Failed to create command pool!");
+	}
+}
+
+void VulkanQuakeApp::CreateCommandBuffers() {
+	CommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+
+	VkCommandBufferAllocateInfo allocInfo{ };
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = CommandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = static_cast<uint32_t>(CommandBuffers.size());
+
+	if (utils::FunctionFailed(vkAllocateCommandBuffers(Device, &allocInfo, CommandBuffers.data()))) {
+		throw std::runtime_error("Failed to allocate command buffers!");
+	}
+}
+
+void VulkanQuakeApp::CreateSyncObjects() {
+	ImageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+	RenderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+
+	VkSemaphoreCreateInfo semaphoreInfo{ };
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+		if (utils::FunctionFailed(vkCreateSemaphore(Device, &semaphoreInfo, Allocator, &ImageAvailableSemaphores[i])) ||
+			utils::FunctionFailed(vkCreateSemaphore(Device, &semaphoreInfo, Allocator, &RenderFinishedSemaphores[i]))) {
+			throw std::runtime_error("Failed to create synchronization objects for a frame!");
+		}
+	}
+
+	if (ModernPath) {
+		VkSemaphoreTypeCreateInfo typeInfo{ };
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo timelineInfo{ };
+		timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		timelineInfo.pNext = &typeInfo;
+
+		if (utils::FunctionFailed(vkCreateSemaphore(Device, &timelineInfo, Allocator, &FrameTimeline))) {
+			throw std::runtime_error("Failed to create frame timeline semaphore!");
+		}
+		return;
+	}
+
+	InFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+
+	VkFenceCreateInfo fenceInfo{ };
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+		if (utils::FunctionFailed(vkCreateFence(Device, &fenceInfo, Allocator, &InFlightFences[i]))) {
+			throw std::runtime_error("Failed to create synchronization objects for a frame!");
+		}
+	}
+}
+
+void VulkanQuakeApp::CreateQueryPool() {
+	if (!PipelineStatistics) {
+		Log::Write(LogSeverity::Info, 0, "Fill statistics unavailable: no pipelineStatisticsQuery support");
+		return;
+	}
+
+	VkQueryPoolCreateInfo poolInfo{ };
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	poolInfo.queryCount = MAX_FRAMES_IN_FLIGHT;
+	poolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+	if (utils::FunctionFailed(vkCreateQueryPool(Device, &poolInfo, Allocator, &StatisticsQueries))) {
+		throw std::runtime_error("Failed to create statistics query pool!");
+	}
+}
+
+void VulkanQuakeApp::CreateUploadQueue() {
+	QueueFamilyIndicies indicies = FindQueueFamilies(PhysicalDevice);
+	Uploads.Init(PhysicalDevice, Device, Allocator, indicies.GraphicsFamily.value(), indicies.TransferFamily);
+}
+
+void VulkanQuakeApp::CreateDefaultTextures() {
+	// Surfaces whose texture or lightmap is missing still have valid indices to sample.
+	const uint32_t size = 16;
+	std::vector<uint32_t> checker(size * size);
+	for (uint32_t y = 0; y < size; ++y) {
+		for (uint32_t x = 0; x < size; ++x) {
+			checker[y * size + x] = ((x / 4 + y / 4) & 1) ? 0xFFFF00FF : 0xFF000000;
+		}
+	}
+	const uint32_t white = 0xFFFFFFFF;
+
+	MissingTexture = CreateTexture({ size, size }, 1, VK_FORMAT_R8G8B8A8_UNORM, checker.data(), VK_FILTER_NEAREST);
+	FullbrightLightmap = CreateTexture({ 1, 1 }, 1, VK_FORMAT_R8G8B8A8_UNORM, &white, VK_FILTER_LINEAR);
+	Uploads.Flush();
+}
+
+uint32_t VulkanQuakeApp::CreateTexture(VkExtent2D extent, uint32_t mipLevels, VkFormat format,
+	const void* pixels, VkFilter filter) {
+	VkImage image;
+	VkDeviceMemory memory;
+	utils::CreateImage(PhysicalDevice, Device, extent, mipLevels, format,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, image, memory, Allocator);
+	const uint32_t texelSize = format == VK_FORMAT_R8_UNORM ? 1 : 4;
+	Uploads.UploadImage(image, extent, mipLevels, texelSize, pixels);
+
+	VkImageView view = utils::CreateImageView(Device, image, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, Allocator);
+
+	TextureImages.push_back(image);
+	TextureMemory.push_back(memory);
+	TextureViews.push_back(view);
+	return Textures.Register(view, filter);
+}
+
+void VulkanQuakeApp::CreateWorldRenderer() {
+	std::optional<PipelineTarget> prepassTarget;
+	if (DepthPrepass) {
+		prepassTarget = Graph.GetPipelineTarget(DepthPass);
+	}
+	World.Init(PhysicalDevice, Device, Allocator, Textures, GetPipelineTarget(), prepassTarget,
+		MAX_FRAMES_IN_FLIGHT, IndirectWorld, IndirectCountWorld);
+}
+
+void VulkanQuakeApp::LoadLevel() {
+	if (LevelPath.empty()) {
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	LevelPackage level;
+	level.Open(LevelPath);
+
+	// Everything is already in its GPU layout, so loading is creating the
+	// images and copying each section from the mapping into staging.
+	size_t imageCount;
+	const PackageImage* images = level.GetImages(imageCount);
+	std::vector<uint32_t> textures(imageCount);
+	for (size_t i = 0; i < imageCount; ++i) {
+		const PackageImage& image = images[i];
+		const bool lightmap = image.Format == PackageImageFormat::R8;
+		textures[i] = CreateTexture({ image.Width, image.Height }, image.MipLevels,
+			lightmap ? VK_FORMAT_R8_UNORM : VK_FORMAT_R8G8B8A8_UNORM, level.GetImageData(image),
+			lightmap ? VK_FILTER_LINEAR : VK_FILTER_NEAREST);
+	}
+
+	// Surfaces index the package's images; point them at descriptors.
+	size_t vertexCount, indexCount, surfaceCount;
+	const WorldVertex* vertices = level.GetVertices(vertexCount);
+	const uint32_t* indices = level.GetIndices(indexCount);
+	const WorldSurface* packageSurfaces = level.GetSurfaces(surfaceCount);
+	std::vector<WorldSurface> surfaces(packageSurfaces, packageSurfaces + surfaceCount);
+	for (WorldSurface& surface : surfaces) {
+		surface.Texture = surface.Texture != PACKAGE_NO_IMAGE ? textures[surface.Texture] : MissingTexture;
+		surface.Lightmap = surface.Lightmap != PACKAGE_NO_IMAGE ? textures[surface.Lightmap] : FullbrightLightmap;
+	}
+	World.SetWorldGeometry(Uploads, vertices, vertexCount, indices, indexCount, surfaces);
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	Log::Writef(LogSeverity::Info, 0, "Loaded %s: %zu surfaces, %zu images in %.1f ms",
+		LevelPath.c_str(), surfaceCount, imageCount, ms);
+}
+
+void VulkanQuakeApp::CreateParticleSystem() {
+	QueueFamilyIndicies indicies = FindQueueFamilies(PhysicalDevice);
+	Particles.Init(PhysicalDevice, Device, Allocator, indicies.GraphicsFamily.value(), indicies.ComputeFamily,
+		GetPipelineTarget(), MAX_FRAMES_IN_FLIGHT);
+}
+
+void VulkanQuakeApp::CreateDynamicResolution() {
+	if (DynamicResolutionMs <= 0.0f) {
+		return;
+	}
+
+	QueueFamilyIndicies indicies = FindQueueFamilies(PhysicalDevice);
+	Resolution.Init(PhysicalDevice, Device, Allocator, indicies.GraphicsFamily.value(), MAX_FRAMES_IN_FLIGHT,
+		SwapchainExtent, DynamicResolutionMs);
+	Upscale.Init(Device, Allocator, Graph.GetPipelineTarget(UpscalePass));
+	Upscale.SetSource(Graph.GetImageView(SceneTarget));
+}
+
+void VulkanQuakeApp::CreateFrameCapture() {
+	if (!SwapchainCapture) {
+		Log::Write(LogSeverity::Warning, 0, "Frame capture unavailable: swapchain images can't be copied from");
+		return;
+	}
+
+	Capture.Init(PhysicalDevice, Device, Allocator, SwapchainImageFormat, SwapchainExtent,
+		MAX_FRAMES_IN_FLIGHT, "screenshots");
+	if (!CaptureDirectory.empty()) {
+		Capture.StartSequence(CaptureDirectory, CaptureFrames);
+	}
+}
+
+void VulkanQuakeApp::CreateStatsOverlay() {
+	if (!MetricsPath.empty()) {
+		Metrics::StartExport(MetricsPath, MetricsIntervalMs);
+	}
+	if (!ShowStats) {
+		return;
+	}
+
+	PipelineTarget target = DynamicResolutionMs > 0.0f ? Graph.GetPipelineTarget(UpscalePass) : GetPipelineTarget();
+	Overlay.Init(PhysicalDevice, Device, Allocator, target, MAX_FRAMES_IN_FLIGHT);
+}
+
 void VulkanQuakeApp::MainLoop() {
-	while (true) {
+	StartTime = LastFrameTime = std::chrono::steady_clock::now();
+
+	const vec3_t spawnOrigin = { 0.0f, 0.0f, 0.0f };
+	Sim.Start(spawnOrigin, ViewAngles);
+	// PutClientInServer's spawn_tfog.
+	Particles.TeleportSplash(spawnOrigin, 0.0f);
+	if (!SoundPath.empty()) {
+		SoundStart ambient{ };
+		ambient.Sample = Sound.LoadSound(SoundPath, true);
+		ambient.Entity = WORLD_ENTITY;
+		VectorCopy(spawnOrigin, ambient.Origin);
+		ambient.Volume = 1.0f;
+		ambient.Attenuation = SoundMixer::ATTN_NORM;
+		Sound.StartSound(ambient);
+	}
+
+	bool running = true;
+	while (running) {
 		SDL_Event event;
-		if (SDL_PollEvent(&event)) {
+		while (SDL_PollEvent(&event)) {
 			if (event.type == SDL_QUIT) {
-				break;
+				running = false;
+			}
+			else if (event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_F12 && !event.key.repeat) {
+				Capture.RequestScreenshot();
 			}
 		}
+		if (Capture.SequenceFinished()) {
+			running = false;
+		}
+
+		SendUserCommand();
+		DrawFrame();
+	}
+
+	Sim.Stop();
+	vkDeviceWaitIdle(Device);
+}
+
+void VulkanQuakeApp::SendUserCommand() {
+	// Quake's cl_forwardspeed, cl_sidespeed, cl_upspeed, cl_yawspeed and cl_pitchspeed.
+	const float forwardSpeed = 200.0f;
+	const float sideSpeed = 350.0f;
+	const float upSpeed = 200.0f;
+	const float yawSpeed = 140.0f;
+	const float pitchSpeed = 150.0f;
+
+	const Uint8* keys = SDL_GetKeyboardState(nullptr);
+	// Turning uses the previous frame's time, as this frame's isn't known yet.
+	ViewAngles[YAW] += FrameTime * yawSpeed * (keys[SDL_SCANCODE_LEFT] - keys[SDL_SCANCODE_RIGHT]);
+	ViewAngles[YAW] = std::fmod(ViewAngles[YAW], 360.0f);
+	ViewAngles[PITCH] += FrameTime * pitchSpeed * (keys[SDL_SCANCODE_DOWN] - keys[SDL_SCANCODE_UP]);
+	ViewAngles[PITCH] = std::clamp(ViewAngles[PITCH], -70.0f, 80.0f);
+
+	UserCommand command{ };
+	VectorCopy(ViewAngles, command.ViewAngles);
+	command.ForwardMove = forwardSpeed * (keys[SDL_SCANCODE_W] - keys[SDL_SCANCODE_S]);
+	command.SideMove = sideSpeed * (keys[SDL_SCANCODE_D] - keys[SDL_SCANCODE_A]);
+	command.UpMove = upSpeed * (keys[SDL_SCANCODE_SPACE] - keys[SDL_SCANCODE_C]);
+	Sim.SubmitCommand(command);
+}
+
+void VulkanQuakeApp::UpdateView() {
+	vec3_t origin;
+	Sim.SampleView(origin);
+	Sound.SetListener(origin, ViewAngles, PLAYER_ENTITY);
+
+	float aspect = static_cast<float>(SwapchainExtent.width) / static_cast<float>(SwapchainExtent.height);
+	ViewProjection = Mat4Multiply(PerspectiveMatrix(90.0f, aspect, 4.0f, 4096.0f), ViewMatrix(origin, ViewAngles));
+}
+
+void VulkanQuakeApp::DrawFrame() {
+	auto waitStart = std::chrono::steady_clock::now();
+	if (ModernPath) {
+		// The last frame that used this slot signalled FrameNumber + 1 - MAX_FRAMES_IN_FLIGHT.
+		if (FrameNumber >= MAX_FRAMES_IN_FLIGHT) {
+			uint64_t waitValue = FrameNumber + 1 - MAX_FRAMES_IN_FLIGHT;
+
+			VkSemaphoreWaitInfo waitInfo{ };
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &FrameTimeline;
+			waitInfo.pValues = &waitValue;
+			vkWaitSemaphores(Device, &waitInfo, UINT64_MAX);
+		}
+	}
+	else {
+		vkWaitForFences(Device, 1, &InFlightFences[CurrentFrame], VK_TRUE, UINT64_MAX);
+	}
+	Metrics::Record(FENCE_WAIT_MS,
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count());
+
+	// Every frame up to the last one that used this slot has now retired.
+	if (FrameNumber >= MAX_FRAMES_IN_FLIGHT) {
+		Uploads.CollectFinished(FrameNumber - MAX_FRAMES_IN_FLIGHT);
+		Capture.Collect(FrameNumber - MAX_FRAMES_IN_FLIGHT);
+	}
+	CollectFrameStatistics();
+	if (DynamicResolutionMs > 0.0f) {
+		Resolution.BeginFrame(CurrentFrame);
+		RenderExtent = Resolution.GetRenderExtent();
+		Graph.SetRenderArea(MainPass, RenderExtent);
+		if (DepthPrepass) {
+			Graph.SetRenderArea(DepthPass, RenderExtent);
+		}
+	}
+	Textures.BeginFrame(CurrentFrame);
+	HostAllocations.BeginFrame();
+
+	uint32_t imageIndex;
+	VkResult result = vkAcquireNextImageKHR(Device, Swapchain, UINT64_MAX,
+		ImageAvailableSemaphores[CurrentFrame], VK_NULL_HANDLE, &imageIndex);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+		return;
+	}
+	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+		throw std::runtime_error("Failed to acquire swap chain image!");
+	}
+
+	if (!ModernPath) {
+		vkResetFences(Device, 1, &InFlightFences[CurrentFrame]);
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	Time = std::chrono::duration<float>(now - StartTime).count();
+	FrameTime = std::chrono::duration<float>(now - LastFrameTime).count();
+	LastFrameTime = now;
+	// The first frame's time runs from startup, so it would only skew the
+	// tail.
+	if (FrameNumber > 0) {
+		Metrics::Record(FRAME_MS, FrameTime * 1000.0);
+	}
+	UpdateView();
+
+	auto recordStart = std::chrono::steady_clock::now();
+
+	VkCommandBuffer commandBuffer = CommandBuffers[CurrentFrame];
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo{ };
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+	if (utils::FunctionFailed(vkBeginCommandBuffer(commandBuffer, &beginInfo))) {
+		throw std::runtime_error("Failed to begin recording command buffer!");
+	}
+	Resolution.WriteStart(commandBuffer, CurrentFrame);
+
+	std::vector<VkSemaphore> waitSemaphores = { ImageAvailableSemaphores[CurrentFrame] };
+	std::vector<VkPipelineStageFlags> waitStages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	Uploads.AcquireUploads(FrameNumber, FrameBarriers, waitSemaphores, waitStages);
+	Particles.Simulate(CurrentFrame, Time, FrameTime, waitSemaphores, waitStages);
+	World.Cull(commandBuffer, CurrentFrame, ViewProjection, FrameBarriers, ModernPath);
+
+	RecordCommandBuffer(commandBuffer, imageIndex);
+	Resolution.WriteEnd(commandBuffer, CurrentFrame);
+
+	if (utils::FunctionFailed(vkEndCommandBuffer(commandBuffer))) {
+		throw std::runtime_error("Failed to record command buffer!");
+	}
+
+	SubmitFrame(commandBuffer, waitSemaphores, waitStages);
+
+	auto submitTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - recordStart);
+	SubmitTotal += submitTime;
+	SubmitMax = std::max(SubmitMax, submitTime);
+	++SubmitSamples;
+	Metrics::Record(SUBMIT_MS, std::chrono::duration<double, std::milli>(submitTime).count());
+
+	VkPresentInfoKHR presentInfo{ };
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = &RenderFinishedSemaphores[CurrentFrame];
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = &Swapchain;
+	presentInfo.pImageIndices = &imageIndex;
+
+	vkQueuePresentKHR(PresentQueue, &presentInfo);
+
+	Metrics::Set(HOST_ALLOC_BYTES, static_cast<double>(HostAllocations.GetLiveBytes()));
+	if (DynamicResolutionMs > 0.0f) {
+		Metrics::Set(RENDER_SCALE, static_cast<double>(RenderExtent.width) / SwapchainExtent.width);
+	}
+	Metrics::EndFrame();
+
+	CurrentFrame = (CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	++FrameNumber;
+}
+
+void VulkanQuakeApp::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+	// Resets have to be outside a render pass.
+	if (StatisticsQueries != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, StatisticsQueries, CurrentFrame, 1);
+	}
+
+	Graph.SetImportedImage(Backbuffer, SwapchainImages[imageIndex], SwapchainImageViews[imageIndex]);
+	Graph.SetOptionalPassesEnabled(Capture.IsPending());
+	// Any upload acquires and cull barriers already queued go out with the
+	// first pass's barriers.
+	Graph.Execute(commandBuffer, FrameBarriers);
+}
+
+void VulkanQuakeApp::RecordDepthPrepass(VkCommandBuffer commandBuffer) {
+	SetViewportAndScissor(commandBuffer, RenderExtent);
+	World.DrawDepth(commandBuffer, CurrentFrame, ViewProjection);
+}
+
+void VulkanQuakeApp::RecordMainPass(VkCommandBuffer commandBuffer) {
+	if (StatisticsQueries != VK_NULL_HANDLE) {
+		vkCmdBeginQuery(commandBuffer, StatisticsQueries, CurrentFrame, 0);
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GraphicsPipeline);
+	SetViewportAndScissor(commandBuffer, RenderExtent);
+
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	Metrics::Add(PIPELINE_BINDS);
+	Metrics::Add(DRAW_CALLS);
+	Metrics::Add(TRIANGLES);
+
+	World.Draw(commandBuffer, CurrentFrame, ViewProjection, Textures);
+	Particles.Draw(commandBuffer, CurrentFrame, ViewProjection, Time);
+
+	if (StatisticsQueries != VK_NULL_HANDLE) {
+		vkCmdEndQuery(commandBuffer, StatisticsQueries, CurrentFrame);
+		StatisticsPending[CurrentFrame] = true;
+		StatisticsPixels[CurrentFrame] = static_cast<uint64_t>(RenderExtent.width) * RenderExtent.height;
+		StatisticsFrameTime[CurrentFrame] = FrameTime;
+	}
+
+	// After the query, so the overdraw stays the scene's.
+	if (ShowStats && DynamicResolutionMs <= 0.0f) {
+		Overlay.Draw(commandBuffer, CurrentFrame, RenderExtent, Metrics::GetOverlayText());
+	}
+}
+
+void VulkanQuakeApp::RecordUpscalePass(VkCommandBuffer commandBuffer) {
+	// Anything drawn after this, like 2D overlays, is at native resolution.
+	SetViewportAndScissor(commandBuffer, SwapchainExtent);
+	Upscale.Draw(commandBuffer, RenderExtent, SwapchainExtent);
+	if (ShowStats) {
+		Overlay.Draw(commandBuffer, CurrentFrame, SwapchainExtent, Metrics::GetOverlayText());
+	}
+}
+
+void VulkanQuakeApp::RecordCapturePass(VkCommandBuffer commandBuffer) {
+	Capture.Record(commandBuffer, Graph.GetImage(Backbuffer), FrameNumber, FrameBarriers);
+}
+
+void VulkanQuakeApp::SetViewportAndScissor(VkCommandBuffer commandBuffer, VkExtent2D extent) {
+	VkViewport viewport{ };
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(extent.width);
+	viewport.height = static_cast<float>(extent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{ };
+	scissor.offset = { 0, 0 };
+	scissor.extent = extent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void VulkanQuakeApp::CollectFrameStatistics() {
+	// Called once this slot's previous frame has retired, so its query is
+	// available without waiting.
+	if (!StatisticsPending[CurrentFrame]) {
+		return;
+	}
+	StatisticsPending[CurrentFrame] = false;
+
+	uint64_t fragments = 0;
+	if (vkGetQueryPoolResults(Device, StatisticsQueries, CurrentFrame, 1, sizeof(fragments), &fragments,
+		sizeof(fragments), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+		return;
+	}
+	uint64_t pixels = StatisticsPixels[CurrentFrame];
+	FragmentTotal += fragments;
+	FragmentPixels += pixels;
+	FragmentPeak = std::max(FragmentPeak, static_cast<double>(fragments) / pixels);
+	FragmentSeconds += StatisticsFrameTime[CurrentFrame];
+	++FragmentSamples;
+	Metrics::Set(OVERDRAW, static_cast<double>(fragments) / pixels);
+}
+
+void VulkanQuakeApp::SubmitFrame(VkCommandBuffer commandBuffer,
+	const std::vector<VkSemaphore>& waitSemaphores,
+	const std::vector<VkPipelineStageFlags>& waitStages) {
+	if (ModernPath) {
+		std::vector<VkSemaphoreSubmitInfo> waitInfos(waitSemaphores.size());
+		for (size_t i = 0; i < waitSemaphores.size(); ++i) {
+			waitInfos[i] = VkSemaphoreSubmitInfo{ };
+			waitInfos[i].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+			waitInfos[i].semaphore = waitSemaphores[i];
+			waitInfos[i].stageMask = waitStages[i];
+		}
+
+		VkSemaphoreSubmitInfo signalInfos[2]{ };
+		signalInfos[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		signalInfos[0].semaphore = RenderFinishedSemaphores[CurrentFrame];
+		// The backbuffer's last use may be a copy rather than a colour
+		// write, and its transition to PRESENT_SRC waits on nothing after
+		// it, so only all commands cover both before present.
+		signalInfos[0].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		signalInfos[1].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		signalInfos[1].semaphore = FrameTimeline;
+		signalInfos[1].value = FrameNumber + 1;
+		signalInfos[1].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+		VkCommandBufferSubmitInfo commandBufferInfo{ };
+		commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+		commandBufferInfo.commandBuffer = commandBuffer;
+
+		VkSubmitInfo2 submitInfo{ };
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+		submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(waitInfos.size());
+		submitInfo.pWaitSemaphoreInfos = waitInfos.data();
+		submitInfo.commandBufferInfoCount = 1;
+		submitInfo.pCommandBufferInfos = &commandBufferInfo;
+		submitInfo.signalSemaphoreInfoCount = 2;
+		submitInfo.pSignalSemaphoreInfos = signalInfos;
+
+		if (utils::FunctionFailed(vkQueueSubmit2(GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE))) {
+			throw std::runtime_error("Failed to submit draw command buffer!");
+		}
+		return;
+	}
+
+	VkSubmitInfo submitInfo{ };
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &RenderFinishedSemaphores[CurrentFrame];
+
+	if (utils::FunctionFailed(vkQueueSubmit(GraphicsQueue, 1, &submitInfo, InFlightFences[CurrentFrame]))) {
+		throw std::runtime_error("Failed to submit draw command buffer!");
 	}
 }
 
 void VulkanQuakeApp::Cleanup() {
-	vkDestroyPipeline(Device, GraphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(Device, PipelineLayout, nullptr);
-	vkDestroyRenderPass(Device, RenderPass, nullptr);
+	Metrics::StopExport();
+	ReportSubmitTiming();
+	ReportFillStatistics();
+	if (DynamicResolutionMs > 0.0f) {
+		Resolution.Report();
+		Resolution.Destroy();
+		Upscale.Destroy();
+	}
+	if (ShowStats) {
+		Overlay.Destroy();
+	}
+	// The device is idle, so every frame has retired.
+	Capture.Collect(FrameNumber);
+	Capture.Destroy();
+	Capture.Report();
+
+	Particles.Destroy();
+	Uploads.Destroy();
+	for (size_t i = 0; i < TextureImages.size(); ++i) {
+		vkDestroyImageView(Device, TextureViews[i], Allocator);
+		vkDestroyImage(Device, TextureImages[i], Allocator);
+		vkFreeMemory(Device, TextureMemory[i], Allocator);
+	}
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+		vkDestroySemaphore(Device, RenderFinishedSemaphores[i], Allocator);
+		vkDestroySemaphore(Device, ImageAvailableSemaphores[i], Allocator);
+	}
+	for (auto& fence : InFlightFences) {
+		vkDestroyFence(Device, fence, Allocator);
+	}
+	vkDestroySemaphore(Device, FrameTimeline, Allocator);
+	vkDestroyQueryPool(Device, StatisticsQueries, Allocator);
+	vkDestroyCommandPool(Device, CommandPool, Allocator);
+	vkDestroyPipeline(Device, GraphicsPipeline, Allocator);
+	vkDestroyPipelineLayout(Device, PipelineLayout, Allocator);
+	World.Destroy();
+	Textures.Destroy();
+	Graph.Destroy();
 	for (auto& imageView : SwapchainImageViews) {
-		vkDestroyImageView(Device, imageView, nullptr);
+		vkDestroyImageView(Device, imageView, Allocator);
 	}
 	CurrentShader.DestroyShader(Device);
-	vkDestroySwapchainKHR(Device, Swapchain, nullptr);
-	vkDestroyDevice(Device, nullptr);
+	vkDestroySwapchainKHR(Device, Swapchain, Allocator);
+	vkDestroyDevice(Device, Allocator);
 	if (EnableValidationLayers) {
-		DestroyDebugUtilsMessengerEXT(Instance, DebugMessenger, nullptr);
+		DestroyDebugUtilsMessengerEXT(Instance, DebugMessenger, Allocator);
 	}
+	// SDL creates the surface without allocation callbacks.
 	vkDestroySurfaceKHR(Instance, Surface, nullptr);
-	vkDestroyInstance(Instance, nullptr);
+	vkDestroyInstance(Instance, Allocator);
+	// Anything still live here was leaked by us or the driver.
+	HostAllocations.Report();
+	Sound.Destroy();
+	Sound.Report();
 	if (Window != nullptr) {
 		SDL_DestroyWindow(Window);
 	}
 	SDL_Quit();
 }
 
+void VulkanQuakeApp::ReportSubmitTiming() const {
+	if (SubmitSamples == 0) {
+		return;
+	}
+
+	double average = std::chrono::duration<double, std::micro>(SubmitTotal).count() / SubmitSamples;
+	double worst = std::chrono::duration<double, std::micro>(SubmitMax).count();
+	Log::Writef(LogSeverity::Info, 0, "Frame record + submit (%s path): %.1f us avg, %.1f us max over %llu frames",
+		ModernPath ? "Vulkan 1.3" : "Vulkan 1.0", average, worst, static_cast<unsigned long long>(SubmitSamples));
+}
+
+void VulkanQuakeApp::ReportFillStatistics() const {
+	if (FragmentSamples == 0) {
+		return;
+	}
+
+	// Without sample shading a fragment is shaded once per pixel it covers
+	// whatever the sample count, so shaded fragments per pixel is overdraw.
+	double overdraw = static_cast<double>(FragmentTotal) / FragmentPixels;
+	double perFrame = static_cast<double>(FragmentTotal) / FragmentSamples;
+	double fillRate = FragmentSeconds > 0.0 ? FragmentTotal / FragmentSeconds / 1.0e6 : 0.0;
+	Log::Writef(LogSeverity::Info, 0,
+		"Main pass shading (%ux MSAA, prepass %s): %.2f fragments/pixel avg, %.2f max, %.0f fragments/frame, %.1f Mfragments/s over %llu frames",
+		static_cast<uint32_t>(SampleCount), DepthPrepass ? "on" : "off", overdraw, FragmentPeak,
+		perFrame, fillRate, static_cast<unsigned long long>(FragmentSamples));
+}
+
 // --------------------------------
 // Util Methods
 // --------------------------------
@@ -496,7 +1426,7 @@ bool VulkanQuakeApp::CheckExtensionsAvailable(const std::vector<const char*>& ex
 	
 	for (const char* name : extensionNames) {
 		if (!std::any_of(std::begin(extensions), std::end(extensions), IsExtensionProp(name))) {
-			std::cerr << "Extension: \"" << name << "\" not found.\n";
+			Log::Writef(LogSeverity::Error, 0, "Extension: \"%s\" not found.", name);
 			foundAll = false;
 		}
 	}
@@ -522,7 +1452,7 @@ bool VulkanQuakeApp::CheckValidaitonLayerSupport() const {
 
 	for (const char* name : ValidationLayers) {
 		if (!std::any_of(std::begin(availableLayers), std::end(availableLayers), IsLayerProp(name))) {
-			std::cerr << "Layer: \"" << name << "\" not found\n";
+			Log::Writef(LogSeverity::Error, 0, "Layer: \"%s\" not found", name);
 			return false;
 		}
 	}
@@ -547,6 +1477,10 @@ std::vector<const char*> VulkanQuakeApp::GetRequiredExtensions() const {
 	return extensionNames;
 }
 
+PipelineTarget VulkanQuakeApp::GetPipelineTarget() const {
+	return Graph.GetPipelineTarget(MainPass);
+}
+
 bool VulkanQuakeApp::IsDeviceSuitable(const VkPhysicalDevice& device) const {
 	QueueFamilyIndicies indicies = FindQueueFamilies(device);
 
@@ -572,19 +1506,27 @@ QueueFamilyIndicies VulkanQuakeApp::FindQueueFamilies(const VkPhysicalDevice& de
 
 	int i = 0;
 	for (const auto& queueFamily : queueFamilies) {
-		if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+		if (!indicies.GraphicsFamily.has_value() && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
 			indicies.GraphicsFamily = i;
 		}
 
 		VkBool32 presentSupport = false;
 		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, Surface, &presentSupport);
 
-		if (presentSupport) {
+		if (presentSupport && !indicies.PresentFamily.has_value()) {
 			indicies.PresentFamily = i;
 		}
 
-		if (indicies.isComplete()) {
-			break;
+		if (!indicies.TransferFamily.has_value() &&
+			(queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+			!(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+			indicies.TransferFamily = i;
+		}
+
+		if (!indicies.ComputeFamily.has_value() &&
+			(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+			!(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+			indicies.ComputeFamily = i;
 		}
 
 		++i;
@@ -608,6 +1550,16 @@ bool VulkanQuakeApp::CheckDeviceExtensionSupport(const VkPhysicalDevice& device)
 	return requiredExtensions.empty();
 }
 
+bool VulkanQuakeApp::HasDeviceExtension(const VkPhysicalDevice& device, const char* name) const {
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+	return std::any_of(std::begin(availableExtensions), std::end(availableExtensions), IsExtensionProp(name));
+}
+
 SwapChainSupportDetails VulkanQuakeApp::QuerySwapChainSupport(const VkPhysicalDevice& device) const {
 	SwapChainSupportDetails details;
 
@@ -679,7 +1631,7 @@ void VulkanQuakeApp::SetUpDebugMessenger() {
 	VkDebugUtilsMessengerCreateInfoEXT createInfo{};
 	PopulateDebugMessengerCreateInfo(createInfo);
 
-	if (utils::FunctionFailed(CreateDebugUtilsMessengerEXT(Instance, &createInfo, nullptr, &DebugMessenger))) {
+	if (utils::FunctionFailed(CreateDebugUtilsMessengerEXT(Instance, &createInfo, Allocator, &DebugMessenger))) {
 		throw std::runtime_error("Failed to set up debug messenger!");
 	}
 }
@@ -687,7 +1639,15 @@ void VulkanQuakeApp::SetUpDebugMessenger() {
 void VulkanQuakeApp::PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
 	createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-	createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	// Severities the log would filter anyway are never requested, so the
+	// layers don't spend time formatting them.
+	createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	if (Log::GetMinSeverity() <= LogSeverity::Info) {
+		createInfo.messageSeverity |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+	}
+	if (Log::GetMinSeverity() <= LogSeverity::Verbose) {
+		createInfo.messageSeverity |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+	}
 	createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
 	createInfo.pfnUserCallback = DebugCallback;
 }
@@ -0,0 +1,112 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+// ------------------------
+// Public methods
+// ------------------------
+WorkerPool::~WorkerPool() {
+	Stop();
+}
+
+void WorkerPool::Start(uint32_t threadCount) {
+	if (Running) {
+		return;
+	}
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+	}
+
+	Running = true;
+	Threads.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		Threads.emplace_back(&WorkerPool::Run, this);
+	}
+}
+
+void WorkerPool::Stop() {
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Running = false;
+	}
+	WorkReady.notify_all();
+
+	for (std::thread& thread : Threads) {
+		thread.join();
+	}
+	Threads.clear();
+}
+
+uint32_t WorkerPool::GetThreadCount() const {
+	return static_cast<uint32_t>(Threads.size()) + 1;
+}
+
+void WorkerPool::ParallelFor(uint32_t count, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& body) {
+	if (count == 0) {
+		return;
+	}
+	grain = std::max(grain, 1u);
+
+	Job job;
+	job.Body = &body;
+	job.Count = count;
+	job.Grain = grain;
+
+	// Not worth waking anyone for a single range.
+	if (Threads.empty() || count <= grain) {
+		RunRanges(job);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		CurrentJob = &job;
+		++Generation;
+	}
+	WorkReady.notify_all();
+
+	RunRanges(job);
+
+	// Every range has been claimed; stop late wakers from joining and wait
+	// for those still running theirs.
+	std::unique_lock<std::mutex> lock(Mutex);
+	CurrentJob = nullptr;
+	WorkDone.wait(lock, [&job]() { return job.Workers == 0; });
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void WorkerPool::Run() {
+	uint64_t seen = 0;
+	std::unique_lock<std::mutex> lock(Mutex);
+	while (true) {
+		WorkReady.wait(lock, [this, seen]() { return !Running || Generation != seen; });
+		if (!Running) {
+			return;
+		}
+		seen = Generation;
+		Job* job = CurrentJob;
+		if (job == nullptr) {
+			continue;
+		}
+
+		++job->Workers;
+		lock.unlock();
+		RunRanges(*job);
+		lock.lock();
+		if (--job->Workers == 0) {
+			WorkDone.notify_all();
+		}
+	}
+}
+
+void WorkerPool::RunRanges(Job& job) {
+	while (true) {
+		uint32_t begin = job.Next.fetch_add(job.Grain, std::memory_order_relaxed);
+		if (begin >= job.Count) {
+			return;
+		}
+		(*job.Body)(begin, std::min(begin + job.Grain, job.Count));
+	}
+}
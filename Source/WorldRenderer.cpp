@@ -0,0 +1,571 @@
+#include "WorldRenderer.h"
+
+#include <cstddef>
+
+#include "Metrics.h"
+
+static const uint32_t WORKGROUP_SIZE = 64;
+
+static const uint32_t DRAW_CALLS = Metrics::Register("draw_calls", MetricType::Counter);
+static const uint32_t TRIANGLES = Metrics::Register("triangles", MetricType::Counter);
+static const uint32_t PIPELINE_BINDS = Metrics::Register("pipeline_binds", MetricType::Counter);
+
+// ------------------------
+// Public methods
+// ------------------------
+void WorldRenderer::Init(const VkPhysicalDevice& physicalDevice, const VkDevice& device,
+	const VkAllocationCallbacks* allocator,
+	const TextureDescriptors& textures, const PipelineTarget& target,
+	const std::optional<PipelineTarget>& prepassTarget,
+	uint32_t framesInFlight, bool indirect, bool indirectCount) {
+	PhysicalDevice = physicalDevice;
+	Device = device;
+	Allocator = allocator;
+	FramesInFlight = framesInFlight;
+	Indirect = indirect && textures.IsBindless();
+	IndirectCount = Indirect && indirectCount;
+	DepthPrepass = prepassTarget.has_value();
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(PhysicalDevice, &properties);
+	MaxDrawIndirectCount = properties.limits.maxDrawIndirectCount;
+
+	CreateDescriptors();
+	if (Indirect) {
+		CreateCullPipeline();
+	}
+	CreateGraphicsPipelines(textures, target, prepassTarget);
+}
+
+void WorldRenderer::Destroy() {
+	DestroyGeometry();
+
+	vkDestroyPipeline(Device, DepthPipeline, Allocator);
+	vkDestroyPipeline(Device, IndirectPipeline, Allocator);
+	vkDestroyPipeline(Device, DrawPipeline, Allocator);
+	vkDestroyPipelineLayout(Device, DrawLayout, Allocator);
+	DrawShader.DestroyShader(Device);
+
+	vkDestroyPipeline(Device, CullPipeline, Allocator);
+	vkDestroyPipelineLayout(Device, CullLayout, Allocator);
+	CullShader.DestroyShader(Device);
+
+	vkDestroyDescriptorPool(Device, DescriptorPool, Allocator);
+	vkDestroyDescriptorSetLayout(Device, CullSetLayout, Allocator);
+}
+
+bool WorldRenderer::IsGpuDriven() const {
+	return Indirect && Surfaces.size() <= MaxDrawIndirectCount;
+}
+
+void WorldRenderer::SetWorldGeometry(UploadQueue& uploads,
+	const WorldVertex* vertices, size_t vertexCount,
+	const uint32_t* indices, size_t indexCount,
+	const std::vector<WorldSurface>& surfaces) {
+	vkDeviceWaitIdle(Device);
+	DestroyGeometry();
+
+	Surfaces = surfaces;
+	if (Surfaces.empty()) {
+		return;
+	}
+
+	const VkDeviceSize vertexSize = sizeof(WorldVertex) * vertexCount;
+	const VkDeviceSize indexSize = sizeof(uint32_t) * indexCount;
+	const VkDeviceSize surfaceSize = sizeof(WorldSurface) * surfaces.size();
+	const VkDeviceSize drawSize = sizeof(VkDrawIndexedIndirectCommand) * surfaces.size();
+
+	utils::CreateBuffer(PhysicalDevice, Device, vertexSize,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VertexBuffer, VertexMemory, Allocator);
+	utils::CreateBuffer(PhysicalDevice, Device, indexSize,
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, IndexBuffer, IndexMemory, Allocator);
+	utils::CreateBuffer(PhysicalDevice, Device, surfaceSize,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, SurfaceBuffer, SurfaceMemory, Allocator);
+
+	uploads.UploadBuffer(VertexBuffer, 0, vertices, vertexSize);
+	uploads.UploadBuffer(IndexBuffer, 0, indices, indexSize);
+	uploads.UploadBuffer(SurfaceBuffer, 0, surfaces.data(), surfaceSize);
+	uploads.Flush();
+
+	if (Indirect) {
+		DrawBuffers.resize(FramesInFlight);
+		DrawMemory.resize(FramesInFlight);
+		CountBuffers.resize(FramesInFlight);
+		CountMemory.resize(FramesInFlight);
+
+		for (uint32_t i = 0; i < FramesInFlight; ++i) {
+			utils::CreateBuffer(PhysicalDevice, Device, drawSize,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DrawBuffers[i], DrawMemory[i], Allocator);
+			utils::CreateBuffer(PhysicalDevice, Device, sizeof(uint32_t),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, CountBuffers[i], CountMemory[i], Allocator);
+		}
+	}
+
+	WriteDescriptors();
+}
+
+void WorldRenderer::Cull(VkCommandBuffer commandBuffer, uint32_t frame, const Mat4& viewProj,
+	BarrierBatch& barriers, bool synchronization2) {
+	if (Surfaces.empty() || !IsGpuDriven()) {
+		return;
+	}
+
+	CullStep step{ };
+	ExtractFrustumPlanes(viewProj, step.Planes);
+	step.SurfaceCount = static_cast<uint32_t>(Surfaces.size());
+	step.Compact = IndirectCount ? 1 : 0;
+
+	if (IndirectCount) {
+		vkCmdFillBuffer(commandBuffer, CountBuffers[frame], 0, sizeof(uint32_t), 0);
+		barriers.AddMemory(VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT);
+	}
+	// Also carries this frame's upload acquires, which the cull may read.
+	barriers.Flush(commandBuffer, synchronization2);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, CullPipeline);
+	Metrics::Add(PIPELINE_BINDS);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, CullLayout,
+		0, 1, &DescriptorSets[frame], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, CullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(step), &step);
+	vkCmdDispatch(commandBuffer, (step.SurfaceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	// Flushed with the frame's pre-render barriers.
+	barriers.AddMemory(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+}
+
+void WorldRenderer::DrawDepth(VkCommandBuffer commandBuffer, uint32_t frame, const Mat4& viewProj) {
+	if (Surfaces.empty() || !DepthPrepass) {
+		return;
+	}
+
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &VertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+	DrawStep step{ };
+	step.ViewProj = viewProj;
+
+	// Without a fragment shader set 0 is never read, so only the surfaces
+	// are bound.
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, DepthPipeline);
+	Metrics::Add(PIPELINE_BINDS);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, DrawLayout,
+		1, 1, &DescriptorSets[frame], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, DrawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(step), &step);
+
+	if (IsGpuDriven()) {
+		DrawIndirect(commandBuffer, frame);
+		return;
+	}
+
+	float planes[6][4];
+	ExtractFrustumPlanes(viewProj, planes);
+
+	uint32_t draws = 0;
+	uint32_t indices = 0;
+	for (uint32_t i = 0; i < Surfaces.size(); ++i) {
+		const WorldSurface& surface = Surfaces[i];
+		if (!BoxOutsideFrustum(planes, surface.Mins, surface.Maxs)) {
+			vkCmdDrawIndexed(commandBuffer, surface.IndexCount, 1, surface.FirstIndex, surface.VertexOffset, i);
+			++draws;
+			indices += surface.IndexCount;
+		}
+	}
+	Metrics::Add(DRAW_CALLS, draws);
+	Metrics::Add(TRIANGLES, indices / 3);
+}
+
+void WorldRenderer::Draw(VkCommandBuffer commandBuffer, uint32_t frame, const Mat4& viewProj,
+	TextureDescriptors& textures) {
+	if (Surfaces.empty()) {
+		return;
+	}
+
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &VertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+	DrawStep step{ };
+	step.ViewProj = viewProj;
+
+	if (IsGpuDriven()) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, IndirectPipeline);
+		Metrics::Add(PIPELINE_BINDS);
+		textures.BindArray(commandBuffer, DrawLayout);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, DrawLayout,
+			1, 1, &DescriptorSets[frame], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, DrawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(step), &step);
+		DrawIndirect(commandBuffer, frame);
+		return;
+	}
+
+	float planes[6][4];
+	ExtractFrustumPlanes(viewProj, planes);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, DrawPipeline);
+	Metrics::Add(PIPELINE_BINDS);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, DrawLayout,
+		1, 1, &DescriptorSets[frame], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, DrawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(step), &step);
+
+	uint32_t draws = 0;
+	uint32_t indices = 0;
+	for (uint32_t i = 0; i < Surfaces.size(); ++i) {
+		const WorldSurface& surface = Surfaces[i];
+		if (BoxOutsideFrustum(planes, surface.Mins, surface.Maxs)) {
+			continue;
+		}
+
+		MaterialIndices material = textures.BindMaterial(commandBuffer, DrawLayout, frame,
+			surface.Texture, surface.Lightmap);
+		vkCmdPushConstants(commandBuffer, DrawLayout, VK_SHADER_STAGE_VERTEX_BIT,
+			offsetof(DrawStep, Material), sizeof(material), &material);
+		vkCmdDrawIndexed(commandBuffer, surface.IndexCount, 1, surface.FirstIndex, surface.VertexOffset, i);
+		++draws;
+		indices += surface.IndexCount;
+	}
+	Metrics::Add(DRAW_CALLS, draws);
+	Metrics::Add(TRIANGLES, indices / 3);
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void WorldRenderer::CreateDescriptors() {
+	// 0: surfaces, 1: draw commands, 2: draw count. The vertex shader
+	// reads the surfaces through the same set.
+	VkDescriptorSetLayoutBinding bindings[3]{ };
+	for (uint32_t i = 0; i < 3; ++i) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{ };
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 3;
+	layoutInfo.pBindings = bindings;
+
+	if (utils::FunctionFailed(vkCreateDescriptorSetLayout(Device, &layoutInfo, Allocator, &CullSetLayout))) {
+		throw std::runtime_error("Failed to create world descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{ };
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = 3 * FramesInFlight;
+
+	VkDescriptorPoolCreateInfo poolInfo{ };
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = FramesInFlight;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (utils::FunctionFailed(vkCreateDescriptorPool(Device, &poolInfo, Allocator, &DescriptorPool))) {
+		throw std::runtime_error("Failed to create world descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(FramesInFlight, CullSetLayout);
+	DescriptorSets.resize(FramesInFlight);
+
+	VkDescriptorSetAllocateInfo allocInfo{ };
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = DescriptorPool;
+	allocInfo.descriptorSetCount = FramesInFlight;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (utils::FunctionFailed(vkAllocateDescriptorSets(Device, &allocInfo, DescriptorSets.data()))) {
+		throw std::runtime_error("Failed to allocate world descriptor sets!");
+	}
+}
+
+void WorldRenderer::CreateCullPipeline() {
+	CullShader.SetCompShaderFilename("Shaders/cull_comp.spv");
+	CullShader.CompileShader(Device, Allocator);
+
+	VkPushConstantRange pushConstantRange{ };
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullStep);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{ };
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &CullSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (utils::FunctionFailed(vkCreatePipelineLayout(Device, &pipelineLayoutInfo, Allocator, &CullLayout))) {
+		throw std::runtime_error("Failed to create cull pipeline layout!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{ };
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = CullShader.GetComp();
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = CullLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	if (utils::FunctionFailed(
+		vkCreateComputePipelines(
+			Device, VK_NULL_HANDLE, 1, &pipelineInfo, Allocator, &CullPipeline))) {
+		throw std::runtime_error("Failed to create cull pipeline!");
+	}
+}
+
+void WorldRenderer::CreateGraphicsPipelines(const TextureDescriptors& textures, const PipelineTarget& target,
+	const std::optional<PipelineTarget>& prepassTarget) {
+	DrawShader.SetVertShaderFilename("Shaders/world_vert.spv");
+	DrawShader.SetFragShaderFilename(textures.IsBindless() ? "Shaders/world_frag.spv" : "Shaders/world_fallback_frag.spv");
+	DrawShader.CompileShader(Device, Allocator);
+
+	// constant_id 0 selects where world.vert takes the material from.
+	VkSpecializationMapEntry specializationEntry{ };
+	specializationEntry.constantID = 0;
+	specializationEntry.offset = 0;
+	specializationEntry.size = sizeof(VkBool32);
+
+	VkBool32 surfaceMaterials = VK_FALSE;
+
+	VkSpecializationInfo specializationInfo{ };
+	specializationInfo.mapEntryCount = 1;
+	specializationInfo.pMapEntries = &specializationEntry;
+	specializationInfo.dataSize = sizeof(VkBool32);
+	specializationInfo.pData = &surfaceMaterials;
+
+	VkPipelineShaderStageCreateInfo shaderStages[2]{ };
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = DrawShader.GetVert();
+	shaderStages[0].pName = "main";
+	shaderStages[0].pSpecializationInfo = &specializationInfo;
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = DrawShader.GetFrag();
+	shaderStages[1].pName = "main";
+
+	VkVertexInputBindingDescription binding{ };
+	binding.binding = 0;
+	binding.stride = sizeof(WorldVertex);
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	VkVertexInputAttributeDescription attributes[3]{ };
+	attributes[0].location = 0;
+	attributes[0].binding = 0;
+	attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributes[0].offset = offsetof(WorldVertex, Position);
+	attributes[1].location = 1;
+	attributes[1].binding = 0;
+	attributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+	attributes[1].offset = offsetof(WorldVertex, TexCoord);
+	attributes[2].location = 2;
+	attributes[2].binding = 0;
+	attributes[2].format = VK_FORMAT_R32G32_SFLOAT;
+	attributes[2].offset = offsetof(WorldVertex, LightmapCoord);
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{ };
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.pVertexBindingDescriptions = &binding;
+	vertexInputInfo.vertexAttributeDescriptionCount = 3;
+	vertexInputInfo.pVertexAttributeDescriptions = attributes;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{ };
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportState{ };
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{ };
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{ };
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = target.Samples;
+	multisampling.minSampleShading = 1.0f;
+
+	// After a prepass the depth buffer already holds the nearest surface,
+	// so only fragments matching it exactly are shaded.
+	VkPipelineDepthStencilStateCreateInfo depthStencil{ };
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = DepthPrepass ? VK_FALSE : VK_TRUE;
+	depthStencil.depthCompareOp = DepthPrepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{ };
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_FALSE;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{ };
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	std::vector<VkDynamicState> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicState{ };
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkDescriptorSetLayout setLayouts[] = { textures.GetSetLayout(), CullSetLayout };
+
+	VkPushConstantRange pushConstantRange{ };
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(DrawStep);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{ };
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 2;
+	pipelineLayoutInfo.pSetLayouts = setLayouts;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (utils::FunctionFailed(vkCreatePipelineLayout(Device, &pipelineLayoutInfo, Allocator, &DrawLayout))) {
+		throw std::runtime_error("Failed to create world pipeline layout!");
+	}
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{ };
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = DrawLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkPipelineRenderingCreateInfo renderingInfo{ };
+	target.Apply(pipelineInfo, renderingInfo);
+
+	if (utils::FunctionFailed(
+		vkCreateGraphicsPipelines(
+			Device, VK_NULL_HANDLE, 1, &pipelineInfo, Allocator, &DrawPipeline))) {
+		throw std::runtime_error("Failed to create world pipeline!");
+	}
+
+	if (Indirect) {
+		surfaceMaterials = VK_TRUE;
+		if (utils::FunctionFailed(
+			vkCreateGraphicsPipelines(
+				Device, VK_NULL_HANDLE, 1, &pipelineInfo, Allocator, &IndirectPipeline))) {
+			throw std::runtime_error("Failed to create indirect world pipeline!");
+		}
+	}
+
+	if (!DepthPrepass) {
+		return;
+	}
+
+	// The depth pipeline only differs in its stages and target. Position
+	// doesn't depend on the material source, so one covers both draw paths.
+	surfaceMaterials = VK_FALSE;
+	multisampling.rasterizationSamples = prepassTarget->Samples;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+	colorBlending.attachmentCount = 0;
+	pipelineInfo.stageCount = 1;
+	pipelineInfo.pNext = nullptr;
+
+	VkPipelineRenderingCreateInfo depthRenderingInfo{ };
+	prepassTarget->Apply(pipelineInfo, depthRenderingInfo);
+
+	if (utils::FunctionFailed(
+		vkCreateGraphicsPipelines(
+			Device, VK_NULL_HANDLE, 1, &pipelineInfo, Allocator, &DepthPipeline))) {
+		throw std::runtime_error("Failed to create world depth pipeline!");
+	}
+}
+
+void WorldRenderer::DrawIndirect(VkCommandBuffer commandBuffer, uint32_t frame) {
+	// The surfaces drawn are only known to the GPU, so this counts as one
+	// draw call and its triangles aren't counted.
+	Metrics::Add(DRAW_CALLS);
+	uint32_t maxDraws = static_cast<uint32_t>(Surfaces.size());
+	if (IndirectCount) {
+		vkCmdDrawIndexedIndirectCount(commandBuffer, DrawBuffers[frame], 0, CountBuffers[frame], 0,
+			maxDraws, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else {
+		vkCmdDrawIndexedIndirect(commandBuffer, DrawBuffers[frame], 0,
+			maxDraws, sizeof(VkDrawIndexedIndirectCommand));
+	}
+}
+
+void WorldRenderer::WriteDescriptors() {
+	for (uint32_t i = 0; i < FramesInFlight; ++i) {
+		VkDescriptorBufferInfo bufferInfos[3]{ };
+		bufferInfos[0] = { SurfaceBuffer, 0, VK_WHOLE_SIZE };
+		uint32_t writeCount = 1;
+		if (Indirect) {
+			bufferInfos[1] = { DrawBuffers[i], 0, VK_WHOLE_SIZE };
+			bufferInfos[2] = { CountBuffers[i], 0, VK_WHOLE_SIZE };
+			writeCount = 3;
+		}
+
+		VkWriteDescriptorSet writes[3]{ };
+		for (uint32_t b = 0; b < writeCount; ++b) {
+			writes[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[b].dstSet = DescriptorSets[i];
+			writes[b].dstBinding = b;
+			writes[b].descriptorCount = 1;
+			writes[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[b].pBufferInfo = &bufferInfos[b];
+		}
+		vkUpdateDescriptorSets(Device, writeCount, writes, 0, nullptr);
+	}
+}
+
+void WorldRenderer::DestroyGeometry() {
+	for (size_t i = 0; i < DrawBuffers.size(); ++i) {
+		vkDestroyBuffer(Device, DrawBuffers[i], Allocator);
+		vkFreeMemory(Device, DrawMemory[i], Allocator);
+		vkDestroyBuffer(Device, CountBuffers[i], Allocator);
+		vkFreeMemory(Device, CountMemory[i], Allocator);
+	}
+	DrawBuffers.clear();
+	DrawMemory.clear();
+	CountBuffers.clear();
+	CountMemory.clear();
+
+	vkDestroyBuffer(Device, SurfaceBuffer, Allocator);
+	vkFreeMemory(Device, SurfaceMemory, Allocator);
+	vkDestroyBuffer(Device, IndexBuffer, Allocator);
+	vkFreeMemory(Device, IndexMemory, Allocator);
+	vkDestroyBuffer(Device, VertexBuffer, Allocator);
+	vkFreeMemory(Device, VertexMemory, Allocator);
+	SurfaceBuffer = IndexBuffer = VertexBuffer = VK_NULL_HANDLE;
+	SurfaceMemory = IndexMemory = VertexMemory = VK_NULL_HANDLE;
+
+	Surfaces.clear();
+}
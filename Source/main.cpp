@@ -20,20 +20,137 @@
  * SOFTWARE.
  */
 
-#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 
+#include "Benchmarks.h"
+#include "Log.h"
+#include "SoundMixer.h"
 #include "VulkanQuakeApp.h"
 
 int main(int argc, char **argv) {
     VulkanQuakeApp app;
+    uint32_t benchEntities = 0;
+    std::string benchTraces;
+    uint32_t benchMixer = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-vk10") == 0) {
+            app.ForceLegacyPath = true;
+        }
+        // -msaa=<samples>, 1 to disable; lowered to what the device supports.
+        else if (std::strncmp(argv[i], "-msaa=", 6) == 0) {
+            app.MsaaSamples = static_cast<uint32_t>(std::strtoul(argv[i] + 6, nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "-prepass") == 0) {
+            app.DepthPrepass = true;
+        }
+        // -dynres[=<GPU ms>] scales the scene's resolution to hold that frame time, 60 Hz by default.
+        else if (std::strncmp(argv[i], "-dynres", 7) == 0) {
+            app.DynamicResolutionMs = 1000.0f / 60.0f;
+            if (argv[i][7] == '=' && std::strtof(argv[i] + 8, nullptr) > 0.0f) {
+                app.DynamicResolutionMs = std::strtof(argv[i] + 8, nullptr);
+            }
+        }
+        // -level=<file.vqp>, cooked with QuakeCook.
+        else if (std::strncmp(argv[i], "-level=", 7) == 0) {
+            app.LevelPath = argv[i] + 7;
+        }
+        // -capture=<directory> saves every frame there; F12 takes single screenshots.
+        else if (std::strncmp(argv[i], "-capture=", 9) == 0) {
+            app.CaptureDirectory = argv[i] + 9;
+        }
+        // -capture-frames=<count> quits once that many frames are captured.
+        else if (std::strncmp(argv[i], "-capture-frames=", 16) == 0) {
+            app.CaptureFrames = std::strtoull(argv[i] + 16, nullptr, 10);
+        }
+        // -sound=<file.wav> loops a sound at the spawn point.
+        else if (std::strncmp(argv[i], "-sound=", 7) == 0) {
+            app.SoundPath = argv[i] + 7;
+        }
+        // -metrics=<file.jsonl> appends a line of frame metrics there every -metrics-interval=<ms>, 1000 by default.
+        else if (std::strncmp(argv[i], "-metrics=", 9) == 0) {
+            app.MetricsPath = argv[i] + 9;
+        }
+        else if (std::strncmp(argv[i], "-metrics-interval=", 18) == 0 && std::strtoul(argv[i] + 18, nullptr, 10) > 0) {
+            app.MetricsIntervalMs = static_cast<uint32_t>(std::strtoul(argv[i] + 18, nullptr, 10));
+        }
+        // -stats draws the frame metrics over the scene.
+        else if (std::strcmp(argv[i], "-stats") == 0) {
+            app.ShowStats = true;
+        }
+        // -loglevel=verbose|info|warning|error
+        else if (std::strncmp(argv[i], "-loglevel=", 10) == 0) {
+            const char* level = argv[i] + 10;
+            if (std::strcmp(level, "verbose") == 0) {
+                Log::SetMinSeverity(LogSeverity::Verbose);
+            }
+            else if (std::strcmp(level, "info") == 0) {
+                Log::SetMinSeverity(LogSeverity::Info);
+            }
+            else if (std::strcmp(level, "warning") == 0) {
+                Log::SetMinSeverity(LogSeverity::Warning);
+            }
+            else if (std::strcmp(level, "error") == 0) {
+                Log::SetMinSeverity(LogSeverity::Error);
+            }
+        }
+        // -logmute=<message id>, decimal or 0x hex, e.g. a validation messageIdNumber.
+        else if (std::strncmp(argv[i], "-logmute=", 9) == 0) {
+            Log::Mute(static_cast<int32_t>(std::strtoul(argv[i] + 9, nullptr, 0)));
+        }
+        // -bench-entities[=<count>] times the entity passes and exits.
+        else if (std::strncmp(argv[i], "-bench-entities", 15) == 0) {
+            benchEntities = 10000;
+            if (argv[i][15] == '=' && std::strtoul(argv[i] + 16, nullptr, 10) > 0) {
+                benchEntities = static_cast<uint32_t>(std::strtoul(argv[i] + 16, nullptr, 10));
+            }
+        }
+        // -bench-traces=<path to .bsp> times hull traces through that map and exits.
+        else if (std::strncmp(argv[i], "-bench-traces=", 14) == 0) {
+            benchTraces = argv[i] + 14;
+        }
+        // -bench-mixer[=<channels>] times the sound mixer without an audio device and exits.
+        else if (std::strncmp(argv[i], "-bench-mixer", 12) == 0) {
+            benchMixer = SoundMixer::MAX_CHANNELS;
+            if (argv[i][12] == '=' && std::strtoul(argv[i] + 13, nullptr, 10) > 0) {
+                benchMixer = static_cast<uint32_t>(std::strtoul(argv[i] + 13, nullptr, 10));
+            }
+        }
+    }
+
+    Log::Start();
+    if (benchEntities > 0 || !benchTraces.empty() || benchMixer > 0) {
+        try {
+            if (benchEntities > 0) {
+                benchmarks::RunEntityBenchmark(benchEntities);
+            }
+            if (!benchTraces.empty()) {
+                benchmarks::RunTraceBenchmark(benchTraces, 100000);
+            }
+            if (benchMixer > 0) {
+                benchmarks::RunMixerBenchmark(benchMixer);
+            }
+        }
+        catch (const std::exception& e) {
+            Log::Write(LogSeverity::Error, 0, e.what());
+            Log::Stop();
+            return EXIT_FAILURE;
+        }
+        Log::Stop();
+        return EXIT_SUCCESS;
+    }
 
     try {
         app.Run();
     }
     catch (const std::exception& e) {
-        std::cerr << e.what() << std::endl;
+        Log::Write(LogSeverity::Error, 0, e.what());
+        Log::Stop();
         return EXIT_FAILURE;
     }
+    Log::Stop();
 
     return EXIT_SUCCESS;
 }
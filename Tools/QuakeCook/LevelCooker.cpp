@@ -0,0 +1,414 @@
+#include "LevelCooker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "Align.h"
+#include "Log.h"
+
+// Lightmap samples are 16 texels apart.
+static const int32_t LIGHTMAP_STEP = 16;
+// GLQuake's limit: extents up to 512 units, (512 >> 4) + 1 samples.
+// WinQuake stops at 256 units, so this accepts every face either lights.
+static const uint32_t MAX_LIGHTMAP_SIZE = 33;
+
+// ------------------------
+// Public methods
+// ------------------------
+void LevelCooker::Cook(const BspFile& bsp, const std::vector<char>& palette) {
+	if (palette.size() < PALETTE_SIZE) {
+		throw std::runtime_error("Failed to cook level, palette is truncated!");
+	}
+
+	Vertices.clear();
+	Indices.clear();
+	Surfaces.clear();
+	Images.clear();
+	TextureImages.clear();
+	Atlases.clear();
+
+	CookTextures(bsp, palette);
+	CookFaces(bsp);
+	CookLightmaps();
+}
+
+void LevelCooker::Write(const std::string& filename, uint64_t sourceHash) const {
+	std::vector<PackageImage> images(Images.size());
+	uint64_t imageDataSize = 0;
+	for (size_t i = 0; i < Images.size(); ++i) {
+		imageDataSize = utils::AlignUp(imageDataSize, LevelPackage::IMAGE_ALIGNMENT);
+		images[i].Width = Images[i].Width;
+		images[i].Height = Images[i].Height;
+		images[i].MipLevels = Images[i].MipLevels;
+		images[i].Format = Images[i].Format;
+		images[i].DataOffset = imageDataSize;
+		images[i].DataSize = Images[i].Data.size();
+		imageDataSize += Images[i].Data.size();
+	}
+
+	PackageSection sections[static_cast<uint32_t>(PackageSectionType::Count)] = { };
+	const uint64_t sizes[] = {
+		Vertices.size() * sizeof(WorldVertex),
+		Indices.size() * sizeof(uint32_t),
+		Surfaces.size() * sizeof(WorldSurface),
+		images.size() * sizeof(PackageImage),
+		imageDataSize
+	};
+	uint64_t offset = sizeof(PackageHeader) + sizeof(sections);
+	for (uint32_t i = 0; i < static_cast<uint32_t>(PackageSectionType::Count); ++i) {
+		offset = utils::AlignUp(offset, LevelPackage::SECTION_ALIGNMENT);
+		sections[i].Type = static_cast<PackageSectionType>(i);
+		sections[i].Offset = offset;
+		sections[i].Size = sizes[i];
+		offset += sizes[i];
+	}
+
+	PackageHeader header{ };
+	std::memcpy(header.Magic, LevelPackage::MAGIC, sizeof(header.Magic));
+	header.Version = LevelPackage::VERSION;
+	header.SourceHash = sourceHash;
+	header.FileSize = offset;
+	header.SectionCount = static_cast<uint32_t>(PackageSectionType::Count);
+
+	const std::string temporary = filename + ".tmp";
+	std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to create " + temporary + "!");
+	}
+
+	uint64_t written = 0;
+	auto write = [&file, &written](const void* data, uint64_t size) {
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		written += size;
+	};
+	auto padTo = [&file, &written](uint64_t target) {
+		static const char zeros[LevelPackage::SECTION_ALIGNMENT] = { };
+		file.write(zeros, static_cast<std::streamsize>(target - written));
+		written = target;
+	};
+
+	write(&header, sizeof(header));
+	write(sections, sizeof(sections));
+	padTo(sections[0].Offset);
+	write(Vertices.data(), sizes[0]);
+	padTo(sections[1].Offset);
+	write(Indices.data(), sizes[1]);
+	padTo(sections[2].Offset);
+	write(Surfaces.data(), sizes[2]);
+	padTo(sections[3].Offset);
+	write(images.data(), sizes[3]);
+	padTo(sections[4].Offset);
+	for (size_t i = 0; i < Images.size(); ++i) {
+		padTo(sections[4].Offset + images[i].DataOffset);
+		write(Images[i].Data.data(), Images[i].Data.size());
+	}
+
+	file.close();
+	if (file.fail()) {
+		throw std::runtime_error("Failed to write " + temporary + "!");
+	}
+	std::filesystem::rename(temporary, filename);
+}
+
+void LevelCooker::Report(const std::string& name) const {
+	uint64_t imageBytes = 0;
+	for (const Image& image : Images) {
+		imageBytes += image.Data.size();
+	}
+	Log::Writef(LogSeverity::Info, 0,
+		"%s: %zu surfaces, %zu vertices, %zu indices, %zu textures, %zu lightmap atlases, %.1f MiB of texels",
+		name.c_str(), Surfaces.size(), Vertices.size(), Indices.size(), Images.size() - Atlases.size(),
+		Atlases.size(), imageBytes / (1024.0 * 1024.0));
+}
+
+// ------------------------
+// Private methods
+// ------------------------
+void LevelCooker::CookTextures(const BspFile& bsp, const std::vector<char>& palette) {
+	const std::vector<uint8_t>& lump = bsp.MipTextures;
+	int32_t count = 0;
+	if (lump.size() >= sizeof(count)) {
+		std::memcpy(&count, lump.data(), sizeof(count));
+	}
+	if (count < 0 || sizeof(int32_t) * (static_cast<size_t>(count) + 1) > lump.size()) {
+		count = 0;
+	}
+	TextureImages.assign(count, PACKAGE_NO_IMAGE);
+
+	for (int32_t i = 0; i < count; ++i) {
+		int32_t offset;
+		std::memcpy(&offset, lump.data() + sizeof(int32_t) * (i + 1), sizeof(offset));
+		// Missing textures are stored as -1; the renderer substitutes its own.
+		if (offset < 0 || static_cast<size_t>(offset) + sizeof(BspMipTex) > lump.size()) {
+			continue;
+		}
+
+		BspMipTex mipTex;
+		std::memcpy(&mipTex, lump.data() + offset, sizeof(mipTex));
+		const size_t texels = static_cast<size_t>(mipTex.Width) * mipTex.Height;
+		if (mipTex.Width == 0 || mipTex.Height == 0 || mipTex.Width > 4096 || mipTex.Height > 4096 ||
+			static_cast<size_t>(offset) + mipTex.Offsets[0] + texels > lump.size()) {
+			Log::Writef(LogSeverity::Warning, 0, "Skipping texture %d, it is out of bounds", i);
+			continue;
+		}
+
+		// Textures named {name use index 255 as a transparent colour.
+		const bool transparent = mipTex.Name[0] == '{';
+		const uint8_t* indices = lump.data() + offset + mipTex.Offsets[0];
+
+		Image image;
+		image.Width = mipTex.Width;
+		image.Height = mipTex.Height;
+		image.Format = PackageImageFormat::Rgba8;
+		image.Data.resize(texels * 4);
+		for (size_t t = 0; t < texels; ++t) {
+			const uint8_t index = indices[t];
+			const bool clear = transparent && index == 255;
+			image.Data[t * 4 + 0] = clear ? 0 : static_cast<uint8_t>(palette[index * 3 + 0]);
+			image.Data[t * 4 + 1] = clear ? 0 : static_cast<uint8_t>(palette[index * 3 + 1]);
+			image.Data[t * 4 + 2] = clear ? 0 : static_cast<uint8_t>(palette[index * 3 + 2]);
+			image.Data[t * 4 + 3] = clear ? 0 : 255;
+		}
+		BuildMipChain(image);
+
+		TextureImages[i] = static_cast<uint32_t>(Images.size());
+		Images.push_back(std::move(image));
+	}
+}
+
+void LevelCooker::CookFaces(const BspFile& bsp) {
+	// Brush entities move, so only the world model is static geometry.
+	const BspModel& world = bsp.Models[0];
+	if (world.FirstFace < 0 || world.NumFaces < 0 ||
+		static_cast<size_t>(world.FirstFace) + world.NumFaces > bsp.Faces.size()) {
+		throw std::runtime_error("Failed to cook level, world faces are out of bounds!");
+	}
+
+	std::vector<const float*> points;
+	for (int32_t f = world.FirstFace; f < world.FirstFace + world.NumFaces; ++f) {
+		const BspFace& face = bsp.Faces[f];
+		if (face.NumEdges < 3 || face.TexInfo < 0 || static_cast<size_t>(face.TexInfo) >= bsp.TexInfo.size() ||
+			face.FirstEdge < 0 || static_cast<size_t>(face.FirstEdge) + face.NumEdges > bsp.SurfEdges.size()) {
+			continue;
+		}
+		const BspTexInfo& texInfo = bsp.TexInfo[face.TexInfo];
+
+		points.clear();
+		for (int32_t e = 0; e < face.NumEdges; ++e) {
+			const int32_t surfEdge = bsp.SurfEdges[face.FirstEdge + e];
+			const uint32_t edge = static_cast<uint32_t>(surfEdge < 0 ? -static_cast<int64_t>(surfEdge) : surfEdge);
+			if (edge >= bsp.Edges.size()) {
+				break;
+			}
+			const uint16_t vertex = bsp.Edges[edge].V[surfEdge < 0 ? 1 : 0];
+			if (vertex >= bsp.Vertices.size()) {
+				break;
+			}
+			points.push_back(bsp.Vertices[vertex].Point);
+		}
+		if (points.size() != static_cast<size_t>(face.NumEdges)) {
+			continue;
+		}
+
+		// CalcSurfaceExtents, in double precision as modern ports do, to
+		// avoid lightmaps one sample off on large maps.
+		double mins[2] = { 1e30, 1e30 };
+		double maxs[2] = { -1e30, -1e30 };
+		for (const float* point : points) {
+			for (int axis = 0; axis < 2; ++axis) {
+				const float* vec = texInfo.Vecs[axis];
+				double value = static_cast<double>(point[0]) * vec[0] + static_cast<double>(point[1]) * vec[1] +
+					static_cast<double>(point[2]) * vec[2] + vec[3];
+				mins[axis] = std::min(mins[axis], value);
+				maxs[axis] = std::max(maxs[axis], value);
+			}
+		}
+		int32_t textureMins[2];
+		uint32_t lightmapSize[2];
+		for (int axis = 0; axis < 2; ++axis) {
+			const int32_t low = static_cast<int32_t>(std::floor(mins[axis] / LIGHTMAP_STEP));
+			const int32_t high = static_cast<int32_t>(std::ceil(maxs[axis] / LIGHTMAP_STEP));
+			textureMins[axis] = low * LIGHTMAP_STEP;
+			lightmapSize[axis] = static_cast<uint32_t>(high - low + 1);
+		}
+
+		uint32_t atlas = PACKAGE_NO_IMAGE;
+		uint32_t atlasX = 0, atlasY = 0;
+		const size_t samples = static_cast<size_t>(lightmapSize[0]) * lightmapSize[1];
+		if (!(texInfo.Flags & BspFile::TEX_SPECIAL) && face.LightOfs >= 0) {
+			if (lightmapSize[0] <= MAX_LIGHTMAP_SIZE && lightmapSize[1] <= MAX_LIGHTMAP_SIZE &&
+				static_cast<size_t>(face.LightOfs) + samples <= bsp.Lighting.size() &&
+				AllocateLightmap(lightmapSize[0], lightmapSize[1], atlas, atlasX, atlasY)) {
+				Atlas& target = Atlases[atlas];
+				for (uint32_t row = 0; row < lightmapSize[1]; ++row) {
+					std::memcpy(&target.Texels[(atlasY + row) * ATLAS_WIDTH + atlasX],
+						&bsp.Lighting[face.LightOfs + row * lightmapSize[0]], lightmapSize[0]);
+				}
+			}
+			else {
+				// The renderer draws it fullbright.
+				Log::Writef(LogSeverity::Warning, 0, "Dropping the %ux%u lightmap of face %d", lightmapSize[0],
+					lightmapSize[1], f);
+			}
+		}
+
+		uint32_t texture = PACKAGE_NO_IMAGE;
+		if (texInfo.MipTex >= 0 && static_cast<size_t>(texInfo.MipTex) < TextureImages.size()) {
+			texture = TextureImages[texInfo.MipTex];
+		}
+		// The renderer's stand-in for a missing texture is 16 texels square.
+		const float textureWidth = texture != PACKAGE_NO_IMAGE ? static_cast<float>(Images[texture].Width) : 16.0f;
+		const float textureHeight = texture != PACKAGE_NO_IMAGE ? static_cast<float>(Images[texture].Height) : 16.0f;
+
+		WorldSurface surface{ };
+		surface.FirstIndex = static_cast<uint32_t>(Indices.size());
+		surface.IndexCount = static_cast<uint32_t>((points.size() - 2) * 3);
+		surface.VertexOffset = static_cast<int32_t>(Vertices.size());
+		surface.Texture = texture;
+		// An atlas index until CookLightmaps() turns it into an image.
+		surface.Lightmap = atlas;
+		for (int axis = 0; axis < 3; ++axis) {
+			surface.Mins[axis] = 1e30f;
+			surface.Maxs[axis] = -1e30f;
+		}
+
+		for (const float* point : points) {
+			WorldVertex vertex{ };
+			float st[2];
+			for (int axis = 0; axis < 2; ++axis) {
+				const float* vec = texInfo.Vecs[axis];
+				st[axis] = point[0] * vec[0] + point[1] * vec[1] + point[2] * vec[2] + vec[3];
+			}
+			for (int axis = 0; axis < 3; ++axis) {
+				vertex.Position[axis] = point[axis];
+				surface.Mins[axis] = std::min(surface.Mins[axis], point[axis]);
+				surface.Maxs[axis] = std::max(surface.Maxs[axis], point[axis]);
+			}
+			vertex.TexCoord[0] = st[0] / textureWidth;
+			vertex.TexCoord[1] = st[1] / textureHeight;
+			// Atlas texels, centred on the samples; normalised once the
+			// atlas's final height is known.
+			vertex.LightmapCoord[0] = (st[0] - textureMins[0] + LIGHTMAP_STEP / 2) / LIGHTMAP_STEP + atlasX;
+			vertex.LightmapCoord[1] = (st[1] - textureMins[1] + LIGHTMAP_STEP / 2) / LIGHTMAP_STEP + atlasY;
+			Vertices.push_back(vertex);
+		}
+		for (uint32_t i = 1; i + 1 < points.size(); ++i) {
+			Indices.push_back(0);
+			Indices.push_back(i);
+			Indices.push_back(i + 1);
+		}
+		Surfaces.push_back(surface);
+	}
+}
+
+void LevelCooker::CookLightmaps() {
+	const uint32_t firstImage = static_cast<uint32_t>(Images.size());
+	std::vector<uint32_t> heights(Atlases.size());
+	for (size_t i = 0; i < Atlases.size(); ++i) {
+		Atlas& atlas = Atlases[i];
+		heights[i] = std::max(*std::max_element(atlas.Allocated.begin(), atlas.Allocated.end()), 1u);
+
+		Image image;
+		image.Width = ATLAS_WIDTH;
+		image.Height = heights[i];
+		image.MipLevels = 1;
+		image.Format = PackageImageFormat::R8;
+		image.Data.assign(atlas.Texels.begin(), atlas.Texels.begin() + ATLAS_WIDTH * heights[i]);
+		Images.push_back(std::move(image));
+	}
+
+	for (WorldSurface& surface : Surfaces) {
+		if (surface.Lightmap == PACKAGE_NO_IMAGE) {
+			continue;
+		}
+
+		const uint32_t atlas = surface.Lightmap;
+		const uint32_t vertexCount = surface.IndexCount / 3 + 2;
+		for (uint32_t v = 0; v < vertexCount; ++v) {
+			WorldVertex& vertex = Vertices[surface.VertexOffset + v];
+			vertex.LightmapCoord[0] /= ATLAS_WIDTH;
+			vertex.LightmapCoord[1] /= heights[atlas];
+		}
+		surface.Lightmap = firstImage + atlas;
+	}
+}
+
+bool LevelCooker::AllocateLightmap(uint32_t width, uint32_t height, uint32_t& atlas, uint32_t& x, uint32_t& y) {
+	// GLQuake's AllocBlock: the lowest spot along the skyline, leftmost on ties.
+	for (uint32_t a = 0; a <= Atlases.size(); ++a) {
+		if (a == Atlases.size()) {
+			Atlas fresh;
+			fresh.Allocated.assign(ATLAS_WIDTH, 0);
+			fresh.Texels.assign(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+			Atlases.push_back(std::move(fresh));
+		}
+		std::vector<uint32_t>& allocated = Atlases[a].Allocated;
+
+		uint32_t best = ATLAS_HEIGHT;
+		for (uint32_t i = 0; i + width <= ATLAS_WIDTH; ++i) {
+			uint32_t top = 0;
+			uint32_t j = 0;
+			for (; j < width; ++j) {
+				if (allocated[i + j] >= best) {
+					break;
+				}
+				top = std::max(top, allocated[i + j]);
+			}
+			if (j == width) {
+				x = i;
+				y = best = top;
+			}
+		}
+		if (best + height > ATLAS_HEIGHT) {
+			continue;
+		}
+
+		for (uint32_t i = 0; i < width; ++i) {
+			allocated[x + i] = best + height;
+		}
+		atlas = a;
+		return true;
+	}
+	return false;
+}
+
+void LevelCooker::BuildMipChain(Image& image) {
+	uint32_t width = image.Width;
+	uint32_t height = image.Height;
+	image.MipLevels = 1;
+	size_t source = 0;
+	while (width > 1 || height > 1) {
+		const uint32_t nextWidth = std::max(width / 2, 1u);
+		const uint32_t nextHeight = std::max(height / 2, 1u);
+		const size_t destination = image.Data.size();
+		image.Data.resize(destination + static_cast<size_t>(nextWidth) * nextHeight * 4);
+
+		// 2x2 box filter; a dimension already at 1 repeats its only texel.
+		for (uint32_t y = 0; y < nextHeight; ++y) {
+			const uint32_t y0 = std::min(y * 2, height - 1);
+			const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+			for (uint32_t x = 0; x < nextWidth; ++x) {
+				const uint32_t x0 = std::min(x * 2, width - 1);
+				const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+				for (uint32_t c = 0; c < 4; ++c) {
+					const uint32_t sum =
+						image.Data[source + (static_cast<size_t>(y0) * width + x0) * 4 + c] +
+						image.Data[source + (static_cast<size_t>(y0) * width + x1) * 4 + c] +
+						image.Data[source + (static_cast<size_t>(y1) * width + x0) * 4 + c] +
+						image.Data[source + (static_cast<size_t>(y1) * width + x1) * 4 + c];
+					image.Data[destination + (static_cast<size_t>(y) * nextWidth + x) * 4 + c] =
+						static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+
+		source = destination;
+		width = nextWidth;
+		height = nextHeight;
+		++image.MipLevels;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BspFile.h"
+#include "LevelPackage.h"
+#include "WorldGeometry.h"
+
+// Does the work a Quake renderer repeats on every level load, once,
+// offline.
+//
+// Each miptex is expanded through the palette to RGBA and given a full
+// box-filtered mip chain; Quake's own dithered palette mips are dropped.
+// Lightmaps (style 0) are packed into R8 atlases the way GLQuake's
+// AllocBlock does, with each atlas trimmed to the rows it uses. The world
+// model's faces become triangle fans with one WorldSurface each, so the
+// renderer can cull and draw them as they are.
+class LevelCooker {
+// ------------------------
+// Public members
+// ------------------------
+public:
+	static const uint32_t ATLAS_WIDTH = 1024;
+	static const uint32_t ATLAS_HEIGHT = 1024;
+	static const size_t PALETTE_SIZE = 768;
+
+// ------------------------
+// Private members
+// ------------------------
+private:
+	struct Image {
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t MipLevels = 0;
+		PackageImageFormat Format = PackageImageFormat::Rgba8;
+		std::vector<uint8_t> Data;
+	};
+
+	struct Atlas {
+		// Filled height of each column.
+		std::vector<uint32_t> Allocated;
+		std::vector<uint8_t> Texels;
+	};
+
+	std::vector<WorldVertex> Vertices;
+	std::vector<uint32_t> Indices;
+	std::vector<WorldSurface> Surfaces;
+	std::vector<Image> Images;
+	// Image for each miptex, or PACKAGE_NO_IMAGE.
+	std::vector<uint32_t> TextureImages;
+	std::vector<Atlas> Atlases;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	void Cook(const BspFile& bsp, const std::vector<char>& palette);
+	// Writes to a temporary file first, so an interrupted cook never
+	// leaves a package that looks up to date.
+	void Write(const std::string& filename, uint64_t sourceHash) const;
+	void Report(const std::string& name) const;
+
+// ------------------------
+// Private methods
+// ------------------------
+private:
+	void CookTextures(const BspFile& bsp, const std::vector<char>& palette);
+	void CookFaces(const BspFile& bsp);
+	void CookLightmaps();
+	bool AllocateLightmap(uint32_t width, uint32_t height, uint32_t& atlas, uint32_t& x, uint32_t& y);
+	static void BuildMipChain(Image& image);
+};
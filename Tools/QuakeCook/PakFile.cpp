@@ -0,0 +1,78 @@
+#include "PakFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static_assert(sizeof(PakHeader) == 12, "PakHeader must match dpackheader_t");
+static_assert(sizeof(PakEntry) == 64, "PakEntry must match dpackfile_t");
+
+// ------------------------
+// Public methods
+// ------------------------
+void PakFile::Open(const std::string& filename) {
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open " + filename + "!");
+	}
+	const std::streamoff fileSize = file.tellg();
+
+	PakHeader header;
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		std::memcmp(header.Id, "PACK", 4) != 0) {
+		throw std::runtime_error("Failed to open " + filename + ", it is not a pak file!");
+	}
+	if (header.DirOffset < 0 || header.DirLength < 0 || header.DirLength % sizeof(PakEntry) != 0 ||
+		static_cast<std::streamoff>(header.DirOffset) + header.DirLength > fileSize) {
+		throw std::runtime_error("Failed to open " + filename + ", directory is out of bounds!");
+	}
+
+	Entries.resize(header.DirLength / sizeof(PakEntry));
+	file.seekg(header.DirOffset);
+	if (!Entries.empty() && !file.read(reinterpret_cast<char*>(Entries.data()), header.DirLength)) {
+		throw std::runtime_error("Failed to read the directory of " + filename + "!");
+	}
+	for (PakEntry& entry : Entries) {
+		entry.Name[sizeof(entry.Name) - 1] = '\0';
+		if (entry.FilePos < 0 || entry.FileLength < 0 ||
+			static_cast<std::streamoff>(entry.FilePos) + entry.FileLength > fileSize) {
+			throw std::runtime_error("Failed to open " + filename + ", " + entry.Name + " is out of bounds!");
+		}
+	}
+	Filename = filename;
+}
+
+const std::string& PakFile::GetFilename() const {
+	return Filename;
+}
+
+bool PakFile::Read(const std::string& name, std::vector<char>& out) const {
+	for (const PakEntry& entry : Entries) {
+		if (name != entry.Name) {
+			continue;
+		}
+
+		std::ifstream file(Filename, std::ios::binary);
+		out.resize(entry.FileLength);
+		file.seekg(entry.FilePos);
+		if (!file.read(out.data(), entry.FileLength)) {
+			throw std::runtime_error("Failed to read " + name + " from " + Filename + "!");
+		}
+		return true;
+	}
+	return false;
+}
+
+std::vector<std::string> PakFile::List(const std::string& prefix, const std::string& suffix) const {
+	std::vector<std::string> names;
+	for (const PakEntry& entry : Entries) {
+		std::string name = entry.Name;
+		if (name.size() >= prefix.size() + suffix.size() &&
+			name.compare(0, prefix.size(), prefix) == 0 &&
+			name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+			names.push_back(name);
+		}
+	}
+	return names;
+}
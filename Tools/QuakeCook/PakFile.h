@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// dpackheader_t and dpackfile_t from Quake's common.c.
+struct PakHeader {
+	char Id[4];
+	int32_t DirOffset;
+	int32_t DirLength;
+};
+
+struct PakEntry {
+	char Name[56];
+	int32_t FilePos;
+	int32_t FileLength;
+};
+
+// A Quake PACK archive. Open() reads only the directory; file contents
+// are read on demand.
+class PakFile {
+// ------------------------
+// Private members
+// ------------------------
+private:
+	std::string Filename;
+	std::vector<PakEntry> Entries;
+
+// ------------------------
+// Public methods
+// ------------------------
+public:
+	void Open(const std::string& filename);
+
+	const std::string& GetFilename() const;
+	// False if the archive has no such file. Names are as stored, e.g.
+	// "maps/e1m1.bsp".
+	bool Read(const std::string& name, std::vector<char>& out) const;
+	// Every stored name starting with prefix and ending with suffix.
+	std::vector<std::string> List(const std::string& prefix, const std::string& suffix) const;
+};
@@ -0,0 +1,156 @@
+// QuakeCook: turns Quake maps into level packages for VulkanQuake -level=.
+//
+//   QuakeCook [-pak=<file>]... [-out=<directory>] [-force] <map>... | all
+//
+// Maps ("maps/e1m1.bsp") and gfx/palette.lmp are looked up in the paks,
+// the last one given first as Quake does, then on disk. "all" cooks every
+// maps/*.bsp in the paks. Packages whose source hash already matches are
+// left alone unless -force is given.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "BspFile.h"
+#include "LevelCooker.h"
+#include "LevelPackage.h"
+#include "Log.h"
+#include "PakFile.h"
+#include "Utils.h"
+
+static bool ReadFile(const std::vector<PakFile>& paks, const std::string& name, std::vector<char>& out) {
+	for (auto pak = paks.rbegin(); pak != paks.rend(); ++pak) {
+		if (pak->Read(name, out)) {
+			return true;
+		}
+	}
+	if (std::filesystem::is_regular_file(name)) {
+		out = utils::readFile(name);
+		return true;
+	}
+	return false;
+}
+
+static bool IsUpToDate(const std::string& filename, uint64_t sourceHash) {
+	if (!std::filesystem::exists(filename)) {
+		return false;
+	}
+	try {
+		LevelPackage package;
+		package.Open(filename);
+		return package.GetSourceHash() == sourceHash;
+	}
+	catch (const std::exception&) {
+		// Stale versions and damaged files are simply cooked again.
+		return false;
+	}
+}
+
+static void CookMap(const std::vector<PakFile>& paks, const std::vector<char>& palette,
+	const std::string& name, const std::string& outDirectory, bool force) {
+	std::vector<char> source;
+	if (!ReadFile(paks, name, source)) {
+		throw std::runtime_error("Failed to find " + name + "!");
+	}
+
+	const uint32_t version = LevelPackage::VERSION;
+	uint64_t sourceHash = LevelPackage::Hash(&version, sizeof(version));
+	sourceHash = LevelPackage::Hash(palette.data(), palette.size(), sourceHash);
+	sourceHash = LevelPackage::Hash(source.data(), source.size(), sourceHash);
+
+	const std::string output = (std::filesystem::path(outDirectory) /
+		std::filesystem::path(name).filename().replace_extension(".vqp")).string();
+	if (!force && IsUpToDate(output, sourceHash)) {
+		Log::Writef(LogSeverity::Info, 0, "%s is up to date", output.c_str());
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	BspFile bsp;
+	bsp.Parse(source);
+	LevelCooker cooker;
+	cooker.Cook(bsp, palette);
+	cooker.Write(output, sourceHash);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	cooker.Report(output);
+	Log::Writef(LogSeverity::Info, 0, "Cooked %s in %.1f ms", name.c_str(), ms);
+}
+
+int main(int argc, char** argv) {
+	std::vector<std::string> pakNames;
+	std::vector<std::string> maps;
+	std::string outDirectory = ".";
+	bool force = false;
+
+	for (int i = 1; i < argc; ++i) {
+		if (std::strncmp(argv[i], "-pak=", 5) == 0) {
+			pakNames.push_back(argv[i] + 5);
+		}
+		else if (std::strncmp(argv[i], "-out=", 5) == 0) {
+			outDirectory = argv[i] + 5;
+		}
+		else if (std::strcmp(argv[i], "-force") == 0) {
+			force = true;
+		}
+		else {
+			maps.push_back(argv[i]);
+		}
+	}
+
+	Log::Start();
+	if (maps.empty()) {
+		Log::Write(LogSeverity::Error, 0, "Usage: QuakeCook [-pak=<file>]... [-out=<directory>] [-force] <map>... | all");
+		Log::Stop();
+		return EXIT_FAILURE;
+	}
+
+	std::vector<PakFile> paks;
+	std::vector<char> palette;
+	try {
+		for (const std::string& pakName : pakNames) {
+			paks.emplace_back();
+			paks.back().Open(pakName);
+		}
+		if (!ReadFile(paks, "gfx/palette.lmp", palette)) {
+			throw std::runtime_error("Failed to find gfx/palette.lmp!");
+		}
+		std::filesystem::create_directories(outDirectory);
+	}
+	catch (const std::exception& e) {
+		Log::Write(LogSeverity::Error, 0, e.what());
+		Log::Stop();
+		return EXIT_FAILURE;
+	}
+
+	if (maps.size() == 1 && maps[0] == "all") {
+		maps.clear();
+		for (const PakFile& pak : paks) {
+			for (const std::string& name : pak.List("maps/", ".bsp")) {
+				if (std::find(maps.begin(), maps.end(), name) == maps.end()) {
+					maps.push_back(name);
+				}
+			}
+		}
+	}
+
+	// A bad map is reported and skipped so the rest still cook.
+	int failures = 0;
+	for (const std::string& map : maps) {
+		try {
+			CookMap(paks, palette, map, outDirectory, force);
+		}
+		catch (const std::exception& e) {
+			Log::Writef(LogSeverity::Error, 0, "%s: %s", map.c_str(), e.what());
+			++failures;
+		}
+	}
+
+	Log::Stop();
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}